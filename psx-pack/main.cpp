@@ -0,0 +1,66 @@
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+
+#include "psx/cdpack.h"
+#include "psx/util/cue.h"
+
+// Converts a cue sheet and its .bin files into packed images (see psx/cdpack.h)
+// and writes a cue sheet that refers to them. The emulator loads the result like any other cue sheet.
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        std::cerr << std::format("Usage: {:s} <input.cue> <output.cue>", argv[0]) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::filesystem::path input(argv[1]);
+    std::filesystem::path output(argv[2]);
+
+    try {
+        util::cue::Sheet sheet = util::cue::Parser::parse(input.string());
+
+        uint64_t input_size = 0;
+        uint64_t output_size = 0;
+        for (util::cue::File &file : sheet.files) {
+            std::filesystem::path bin = input.parent_path() / file.filename;
+            std::filesystem::path packed = std::filesystem::path(file.filename).replace_extension(".pxp");
+
+            std::cout << std::format("Packing \"{:s}\" into \"{:s}\"", bin.string(), packed.string()) << std::endl;
+            PSX::CDPackWriter::Statistics statistics = PSX::CDPackWriter::pack(bin, output.parent_path() / packed);
+
+            using Type = PSX::CDPack::SectorType;
+            std::cout << std::format("  {:d} sectors: {:d} raw, {:d} zero, {:d} mode 1, {:d} mode 2 form 1, {:d} mode 2 form 2",
+                                     statistics.sectors,
+                                     statistics.sectors_of_type[static_cast<uint8_t>(Type::RAW)],
+                                     statistics.sectors_of_type[static_cast<uint8_t>(Type::ZERO)],
+                                     statistics.sectors_of_type[static_cast<uint8_t>(Type::MODE1)],
+                                     statistics.sectors_of_type[static_cast<uint8_t>(Type::MODE2_FORM1)],
+                                     statistics.sectors_of_type[static_cast<uint8_t>(Type::MODE2_FORM2)]
+                                     + statistics.sectors_of_type[static_cast<uint8_t>(Type::MODE2_FORM2_NO_EDC)]) << std::endl;
+            std::cout << std::format("  {:d} -> {:d} bytes ({:.1f}%)", statistics.input_size, statistics.output_size,
+                                     100.0 * statistics.output_size / statistics.input_size) << std::endl;
+
+            input_size += statistics.input_size;
+            output_size += statistics.output_size;
+            file.filename = packed.string();
+        }
+
+        std::ofstream cue(output);
+        cue << sheet << std::endl;
+        if (!cue.good()) {
+            throw std::runtime_error(std::format("Failed to write \"{:s}\"", output.string()));
+        }
+
+        std::cout << std::format("Total: {:d} -> {:d} bytes ({:.1f}%)", input_size, output_size,
+                                 input_size ? 100.0 * output_size / input_size : 0.0) << std::endl;
+
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,19 +1,12 @@
 #include "emuthread.h"
 
 #include <QDebug>
-#include <QOpenGLContext>
-#include <QSurfaceFormat>
 
 #include "mainwindow.h"
-#include "openglwindow.h"
 #include "psx/core.h"
-#include "psx/renderer/software/softwarerenderer.h"
 
 EmuThread::EmuThread(QObject *parent)
     : QThread(parent),
-      initialized(false),
-      openGLWindow(nullptr),
-      vramOpenGLWindow(nullptr),
       paused(true),
       justOneStep(false) {
 }
@@ -33,28 +26,13 @@ void EmuThread::setJustOneStep(bool justOneStep) {
     this->justOneStep = justOneStep;
 }
 
-void EmuThread::setOpenGLWindow(OpenGLWindow *window) {
-    this->openGLWindow = window;
-}
-
-void EmuThread::setVRAMOpenGLWindow(OpenGLWindow *window) {
-    this->vramOpenGLWindow = window;
-}
-
 void EmuThread::openGLWindowClosed() {
     emit emulationShouldStop();
 }
 
 void EmuThread::run() {
-    if (!initialized) {
-        initialize();
-    }
-
-    openGLWindow->show();
-    QOpenGLContext *context = openGLWindow->getContext();
-    context->makeCurrent(openGLWindow);
-
-
+    // The OpenGL context is owned by the presentation thread,
+    // finished frames are handed over by the renderer without blocking
     if (justOneStep) {
         justOneStep = false;
         core->emulateStep();
@@ -65,13 +43,5 @@ void EmuThread::run() {
             core->emulateUntilVBLANK();
         }
     }
-
-    context->doneCurrent();
-}
-
-void EmuThread::initialize() {
-    openGLWindow->createContext();
-    renderer->initialize();
-    initialized = true;
 }
 
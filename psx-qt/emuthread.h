@@ -4,8 +4,6 @@
 #include <atomic>
 #include <QThread>
 
-class OpenGLWindow;
-
 class EmuThread : public QThread {
     Q_OBJECT
 
@@ -18,9 +16,6 @@ public:
 
     void setJustOneStep(bool justOneStep);
 
-    void setOpenGLWindow(OpenGLWindow *window);
-    void setVRAMOpenGLWindow(OpenGLWindow *window);
-
 public slots:
     void openGLWindowClosed();
 
@@ -31,11 +26,6 @@ protected:
     void run();
 
 private:
-    void initialize();
-    bool initialized;
-    OpenGLWindow *openGLWindow;
-    OpenGLWindow *vramOpenGLWindow;
-
     std::atomic<bool> paused;
     bool justOneStep;
 };
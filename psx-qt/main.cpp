@@ -4,6 +4,8 @@
 #include <QCommandLineParser>
 #include <QTimer>
 
+#include "psx/core.h"
+
 int main(int argc, char *argv[]) {
     QApplication app(argc, argv);
     QApplication::setApplicationName("PSX");
@@ -40,6 +42,36 @@ int main(int argc, char *argv[]) {
                                       "Open debugger window on startup.");
     parser.addOption(debuggerOption);
 
+    QCommandLineOption skipRasterizationOption(QStringList() << "skip-rasterization",
+                                               "Do not rasterize frames that are skipped while fast-forwarding.");
+    parser.addOption(skipRasterizationOption);
+
+    QCommandLineOption unthrottledOption(QStringList() << "unthrottled",
+                                         "Do not limit emulation speed to the video mode's frame rate.");
+    parser.addOption(unthrottledOption);
+
+    QCommandLineOption audioClockOption(QStringList() << "audio-clock",
+                                        "Throttle emulation to the audio output instead of the host clock.");
+    parser.addOption(audioClockOption);
+
+    QCommandLineOption prefetchOption(QStringList() << "prefetch",
+                                      "Read <sectors> CD sectors ahead on a background thread (for images on slow storage).",
+                                      "sectors");
+    parser.addOption(prefetchOption);
+
+    QCommandLineOption preloadOption(QStringList() << "preload",
+                                     "Read the whole CD image into memory in the background.");
+    parser.addOption(preloadOption);
+
+    QCommandLineOption cdSpeedOption(QStringList() << "cd-speed",
+                                     "Speed up CD-ROM data reads and seeks by <factor>, or \"instant\" (audio keeps normal speed).",
+                                     "factor");
+    parser.addOption(cdSpeedOption);
+
+    QCommandLineOption fastBootOption(QStringList() << "fast-boot",
+                                      "Skip the BIOS intro and boot the CD's executable directly.");
+    parser.addOption(fastBootOption);
+
     parser.process(app);
 
 
@@ -59,6 +91,43 @@ int main(int argc, char *argv[]) {
         mainWindow.setCDImageFileName(parser.value(cdOption));
     }
 
+    if (parser.isSet(prefetchOption)) {
+        mainWindow.setCDPrefetchWindow(parser.value(prefetchOption).toUInt());
+    }
+
+    if (parser.isSet(preloadOption)) {
+        mainWindow.setCDPreload(true);
+    }
+
+    if (parser.isSet(fastBootOption)) {
+        mainWindow.setFastBoot(true);
+    }
+
+    if (parser.isSet(cdSpeedOption)) {
+        QString speed = parser.value(cdSpeedOption);
+        uint32_t factor = CDROM_SPEED_UP_INSTANT;
+        if (speed != "instant") {
+            bool valid = false;
+            factor = speed.toUInt(&valid);
+            if (!valid || factor == 0) {
+                parser.showHelp(1);
+            }
+        }
+        core->bus.cdrom.set_speed_up(factor);
+    }
+
+    if (parser.isSet(skipRasterizationOption)) {
+        core->frameSkipper.setSkipRasterization(true);
+    }
+
+    if (parser.isSet(unthrottledOption)) {
+        core->framePacer.setEnabled(false);
+    }
+
+    if (parser.isSet(audioClockOption)) {
+        core->framePacer.setClock(PSX::FramePacer::Clock::AUDIO);
+    }
+
     mainWindow.show();
 
     if (parser.isSet(startOption)) {
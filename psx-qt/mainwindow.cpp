@@ -1,21 +1,26 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
+#include <format>
 #include <limits>
+#include <QApplication>
 #include <QDir>
 #include <QFileDialog>
 #include <QFileSystemModel>
 #include <QOpenGLContext>
 #include <QOverload>
 #include <QScrollBar>
+#include <QTimer>
 
 #include "debuggerwindow.h"
 #include "emuthread.h"
 #include "openglwindow.h"
+#include "presentationthread.h"
 #include "vramviewerwindow.h"
 
 #include "psx/core.h"
 #include "psx/cd.h"
+#include "psx/exceptions/exceptions.h"
 #include "psx/gamepad.h"
 #include "psx/renderer/software/softwarerenderer.h"
 #include "psx/util/log.h"
@@ -24,6 +29,7 @@ bool running = false;
 PSX::Core *core = nullptr;
 PSX::SoftwareRenderer *renderer = nullptr;
 EmuThread *emuThread = nullptr;
+PresentationThread *presentationThread = nullptr;
 
 PlainTextEditLog::PlainTextEditLog(QPlainTextEdit *plainTextEdit)
     : Log(true),
@@ -42,6 +48,9 @@ MainWindow::MainWindow(const QString &biosPath, QWidget *parent)
     : QMainWindow(parent),
       ui(new Ui::MainWindow),
       biosFSModel(nullptr),
+      cdPrefetchWindow(0),
+      cdPreload(false),
+      fastBoot(false),
       vramViewerWindow(nullptr) {
     ui->setupUi(this);
 
@@ -106,8 +115,10 @@ MainWindow::MainWindow(const QString &biosPath, QWidget *parent)
 
     // Emulation thread
     emuThread = new EmuThread(this);
-    emuThread->setOpenGLWindow(openGLWindow);
-    emuThread->setVRAMOpenGLWindow(vramViewerWindow->getOpenGLWindow());
+
+    // Presentation thread
+    presentationThread = new PresentationThread(this);
+    presentationThread->setOpenGLWindow(openGLWindow);
 
     // Logging
     std::shared_ptr<PlainTextEditLog> plainTextEditLog = std::make_shared<PlainTextEditLog>(ui->plainTextEditLog);
@@ -115,6 +126,10 @@ MainWindow::MainWindow(const QString &biosPath, QWidget *parent)
     connect(plainTextEditLog.get(), &PlainTextEditLog::moveScrollBar, ui->plainTextEditLog->verticalScrollBar(), &QScrollBar::setValue);
     util::logPack.installAdditionalLog(plainTextEditLog);
 
+    // Statistics
+    statisticsTimer = new QTimer(this);
+    statisticsTimer->setInterval(1000);
+
     // Connections
     makeConnections();
 
@@ -161,6 +176,9 @@ void MainWindow::makeConnections() {
     connect(emuThread, &EmuThread::emulationShouldStop,
             this, &MainWindow::stopEmulation);
 
+    connect(statisticsTimer, &QTimer::timeout,
+            this, &MainWindow::updateStatistics);
+
     // Debugger window
     connect(ui->actionDebugger, &QAction::toggled,
             debuggerWindow, &QWidget::setVisible);
@@ -190,6 +208,18 @@ void MainWindow::setCDImageFileName(const QString &fileName) {
     cdImageFileName = fileName;
 }
 
+void MainWindow::setCDPrefetchWindow(uint32_t sectors) {
+    cdPrefetchWindow = sectors;
+}
+
+void MainWindow::setCDPreload(bool preload) {
+    cdPreload = preload;
+}
+
+void MainWindow::setFastBoot(bool enabled) {
+    fastBoot = enabled;
+}
+
 void MainWindow::startPauseEmulation() {
     if (!running) {
         core->reset();
@@ -201,7 +231,23 @@ void MainWindow::startPauseEmulation() {
         }
 
         if (!cdImageFileName.isEmpty()) {
-            core->bus.cdrom.setCD(std::make_unique<PSX::CD>(cdImageFileName.toStdString()));
+            std::unique_ptr<PSX::CD> cd = std::make_unique<PSX::CD>(cdImageFileName.toStdString());
+            if (cdPrefetchWindow > 0) {
+                cd->enable_prefetching(cdPrefetchWindow);
+            }
+            if (cdPreload) {
+                cd->start_preload();
+            }
+            core->bus.cdrom.setCD(std::move(cd));
+
+            // An executable given explicitly takes precedence
+            if (fastBoot && executableFileName.isEmpty()) {
+                try {
+                    core->bus.executable.readFromDisc(core->bus.cdrom.getCD());
+                } catch (const exceptions::FileReadError &e) {
+                    LOGW_MISC(std::format("Booting through the BIOS, fast boot failed: {:s}", e.what()));
+                }
+            }
         }
 
         ui->treeView->setHidden(true);
@@ -229,7 +275,9 @@ void MainWindow::continueEmulation() {
     ui->actionStop->setEnabled(true);
     ui->actionStep->setEnabled(false);
 
+    presentationThread->startPresentation();
     emuThread->start();
+    statisticsTimer->start();
 }
 
 void MainWindow::pauseEmulation() {
@@ -239,6 +287,9 @@ void MainWindow::pauseEmulation() {
     ui->actionStep->setEnabled(true);
 
     emuThread->pauseEmulation();
+    presentationThread->stopPresentation();
+    presentationThread->wait();
+    statisticsTimer->stop();
     debuggerWindow->jumpToState();
     debuggerWindow->update();
 }
@@ -254,8 +305,13 @@ void MainWindow::stopEmulation() {
 
         emuThread->pauseEmulation();
         emuThread->wait();
+        presentationThread->stopPresentation();
+        presentationThread->wait();
         running = false;
 
+        statisticsTimer->stop();
+        setWindowTitle(QApplication::applicationName());
+
         openGLWindowWidget->hide();
         ui->treeView->setHidden(false);
         LOG_MISC("Stopped emulation");
@@ -280,6 +336,29 @@ void MainWindow::triggerDebuggerWindow() {
     ui->actionDebugger->trigger();
 }
 
+void MainWindow::updateStatistics() {
+    PSX::FramePacer::Statistics statistics = core->framePacer.getStatistics();
+
+    QString title = QString("%1 - %2% (%3 ms, jitter %4 ms)")
+                    .arg(QApplication::applicationName())
+                    .arg(statistics.speed * 100.0, 0, 'f', 0)
+                    .arg(statistics.average_frame_time, 0, 'f', 2)
+                    .arg(statistics.jitter, 0, 'f', 3);
+
+    if (core->bus.cdrom.hasCD()) {
+        double progress = core->bus.cdrom.getCD().get_preload_progress();
+        if (progress < 1.0) {
+            title += QString(" - CD preloaded %1%").arg(progress * 100.0, 0, 'f', 0);
+        }
+    }
+
+    setWindowTitle(title);
+
+#ifdef GTE_PROFILE
+    LOG_GTE(core->bus.cpu.gte.get_profile().report());
+#endif
+}
+
 void MainWindow::closeEvent(QCloseEvent *event) {
     stopEmulation();
     vramViewerWindow->close();
@@ -338,6 +417,10 @@ bool MainWindow::handleKeyEvent(QKeyEvent *event, bool pressed) {
         case Qt::Key_V:
             pad.setStart(pressed);
             break;
+        case Qt::Key_Space:
+            // Fast-forward while held
+            core->frameSkipper.setFastForward(pressed);
+            break;
         default:
             return false;
         }
@@ -18,11 +18,13 @@ class MainWindow;
 class QFileSystemModel;
 class QCloseEvent;
 class QKeyEvent;
+class QTimer;
 QT_END_NAMESPACE
 
 class DebuggerWindow;
 class EmuThread;
 class OpenGLWindow;
+class PresentationThread;
 class VRAMViewerWindow;
 
 namespace PSX {
@@ -35,6 +37,7 @@ extern bool running;
 extern PSX::Core *core;
 extern PSX::SoftwareRenderer *renderer;
 extern EmuThread *emuThread;
+extern PresentationThread *presentationThread;
 
 class PlainTextEditLog : public QObject, public util::Log {
     Q_OBJECT
@@ -63,6 +66,9 @@ public slots:
     void setExecutableFileName(const QString &fileName);
     void loadCDImage();
     void setCDImageFileName(const QString &fileName);
+    void setCDPrefetchWindow(uint32_t sectors);
+    void setCDPreload(bool preload);
+    void setFastBoot(bool enabled);
 
     void startPauseEmulation();
     void continueEmulation();
@@ -73,6 +79,8 @@ public slots:
     void triggerVRAMViewerWindow();
     void triggerDebuggerWindow();
 
+    void updateStatistics();
+
     bool handleKeyEvent(QKeyEvent *event, bool pressed);
 
 protected:
@@ -89,6 +97,9 @@ private:
     QFileSystemModel *biosFSModel;
     QString executableFileName;
     QString cdImageFileName;
+    uint32_t cdPrefetchWindow;
+    bool cdPreload;
+    bool fastBoot;
 
     // Debugger window
     DebuggerWindow *debuggerWindow;
@@ -99,6 +110,9 @@ private:
     // OpenGL windows
     OpenGLWindow *openGLWindow;
     QWidget *openGLWindowWidget;
+
+    // Periodically shows emulation speed and frame pacing in the window title
+    QTimer *statisticsTimer;
 };
 
 #endif
@@ -0,0 +1,61 @@
+#include "presentationthread.h"
+
+#include <QOpenGLContext>
+
+#include "mainwindow.h"
+#include "openglwindow.h"
+#include "psx/renderer/software/softwarerenderer.h"
+
+PresentationThread::PresentationThread(QObject *parent)
+    : QThread(parent),
+      initialized(false),
+      openGLWindow(nullptr),
+      stopped(true) {
+}
+
+PresentationThread::~PresentationThread() {
+}
+
+void PresentationThread::startPresentation() {
+    stopped.store(false);
+    start();
+}
+
+void PresentationThread::stopPresentation() {
+    stopped.store(true);
+    renderer->wakeUpPresentation();
+}
+
+void PresentationThread::setOpenGLWindow(OpenGLWindow *window) {
+    this->openGLWindow = window;
+}
+
+void PresentationThread::run() {
+    if (!initialized) {
+        initialize();
+    }
+
+    openGLWindow->show();
+    QOpenGLContext *context = openGLWindow->getContext();
+    context->makeCurrent(openGLWindow);
+
+    while (true) {
+        // Obtain the sequence before checking for a stop request such that
+        // the wake-up in stopPresentation cannot get lost
+        uint32_t seenSequence = renderer->getFrameSequence();
+        if (stopped.load()) {
+            break;
+        }
+
+        renderer->presentFrame();
+        renderer->waitForFrame(seenSequence);
+    }
+
+    context->doneCurrent();
+}
+
+void PresentationThread::initialize() {
+    openGLWindow->createContext();
+    renderer->initialize();
+    initialized = true;
+}
@@ -0,0 +1,33 @@
+#ifndef PRESENTATIONTHREAD_H
+#define PRESENTATIONTHREAD_H
+
+#include <atomic>
+#include <QThread>
+
+class OpenGLWindow;
+
+// Owns the OpenGL context and presents the newest frame produced by the emulation thread
+class PresentationThread : public QThread {
+    Q_OBJECT
+
+public:
+    PresentationThread(QObject *parent = nullptr);
+    virtual ~PresentationThread();
+
+    void startPresentation();
+    void stopPresentation();
+
+    void setOpenGLWindow(OpenGLWindow *window);
+
+protected:
+    void run();
+
+private:
+    void initialize();
+    bool initialized;
+    OpenGLWindow *openGLWindow;
+
+    std::atomic<bool> stopped;
+};
+
+#endif
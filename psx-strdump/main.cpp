@@ -0,0 +1,314 @@
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <numbers>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "psx/cd.h"
+#include "psx/iso9660.h"
+#include "psx/mdec.h"
+#include "psx/strvideo.h"
+#include "psx/xaadpcm.h"
+
+namespace {
+
+// The channel number in the sub-header of XA sectors is 0...31
+const uint32_t XA_MAX_CHANNEL = 31;
+
+// MDEC registers
+const uint32_t MDEC_COMMAND = 0x1F80'1820;
+const uint32_t MDEC_CONTROL = 0x1F80'1824;
+// The parameter word count of an MDEC command has 16 bits
+const uint32_t MDEC_MAX_PARAMETER_WORDS = 0xFFFF;
+
+// Quantization table as uploaded by the PsyQ libraries (zigzag order): the MPEG-1 intra matrix with a DC entry of 2
+const uint8_t QUANTIZATION_TABLE[64] = {
+    0x02, 0x10, 0x10, 0x13, 0x10, 0x13, 0x16, 0x16, 0x16, 0x16, 0x16, 0x16, 0x1A, 0x18, 0x1A, 0x1B,
+    0x1B, 0x1B, 0x1A, 0x1A, 0x1A, 0x1A, 0x1B, 0x1B, 0x1B, 0x1D, 0x1D, 0x1D, 0x22, 0x22, 0x22, 0x1D,
+    0x1D, 0x1D, 0x1B, 0x1B, 0x1D, 0x1D, 0x20, 0x20, 0x22, 0x22, 0x25, 0x26, 0x25, 0x23, 0x23, 0x22,
+    0x23, 0x26, 0x26, 0x28, 0x28, 0x28, 0x30, 0x30, 0x2E, 0x2E, 0x38, 0x38, 0x3A, 0x45, 0x45, 0x53
+};
+
+struct Options {
+    std::string cue_sheet;
+    std::string output;
+    std::string file; // empty: the whole disc
+    std::optional<uint8_t> channel;
+    bool y4m = false;
+    uint32_t repeat = 1;
+};
+
+void print_usage(const char *program) {
+    std::cerr << std::format("Usage: {:s} [options] <disc.cue> [<output>]\n"
+                             "Decodes the STR videos of a disc image with the MDEC and writes the frames as raw RGB24 or Y4M.\n"
+                             "Without output, the frames are only decoded (e.g., for benchmarking).\n"
+                             "  --file <path>     only the sectors of this file, e.g., \\MOVIE\\INTRO.STR\n"
+                             "  --channel <n>     only the video sectors of this channel (0...31)\n"
+                             "  --y4m             write YUV4MPEG2 (4:4:4) instead of raw RGB24\n"
+                             "  --repeat <n>      decode the frames n times", program) << std::endl;
+}
+
+// A whole argument as a decimal number, std::nullopt if it is not one or does not fit
+std::optional<uint32_t> parse_number(const std::string &argument) {
+    if (argument.empty() || !std::isdigit(static_cast<unsigned char>(argument[0]))) {
+        return std::nullopt;
+    }
+    try {
+        size_t length;
+        unsigned long value = std::stoul(argument, &length);
+        if (length == argument.size() && value <= UINT32_MAX) {
+            return value;
+        }
+    } catch (const std::logic_error &) {
+        // std::invalid_argument or std::out_of_range
+    }
+    return std::nullopt;
+}
+
+std::optional<Options> parse_options(int argc, char *argv[]) {
+    Options options;
+    std::vector<std::string> positional;
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool has_value = i + 1 < argc;
+        if (argument == "--file" && has_value) {
+            options.file = argv[++i];
+        } else if (argument == "--channel" && has_value) {
+            std::optional<uint32_t> channel = parse_number(argv[++i]);
+            if (!channel || *channel > XA_MAX_CHANNEL) {
+                return std::nullopt;
+            }
+            options.channel = *channel;
+        } else if (argument == "--y4m") {
+            options.y4m = true;
+        } else if (argument == "--repeat" && has_value) {
+            std::optional<uint32_t> repeat = parse_number(argv[++i]);
+            if (!repeat) {
+                return std::nullopt;
+            }
+            options.repeat = std::max(1u, *repeat);
+        } else if (argument.starts_with("--")) {
+            return std::nullopt;
+        } else {
+            positional.push_back(argument);
+        }
+    }
+
+    if (positional.empty() || positional.size() > 2) {
+        return std::nullopt;
+    }
+    options.cue_sheet = positional[0];
+    if (positional.size() == 2) {
+        options.output = positional[1];
+    }
+    return options;
+}
+
+// Feeds frames through the MDEC register interface, the same way the emulated CPU and DMA do
+class FrameDecoder {
+private:
+    PSX::MacroblockDecoder mdec;
+    std::vector<uint16_t> input;
+
+public:
+    FrameDecoder() : mdec(nullptr) {
+        // Reset and enable both DMA requests
+        mdec.write<uint32_t>(MDEC_CONTROL, 0xE000'0000);
+
+        // set_iqtab with luminance and color table
+        mdec.write<uint32_t>(MDEC_COMMAND, (2u << 29) | 1);
+        for (uint32_t table = 0; table < 2; ++table) {
+            for (uint32_t i = 0; i < 64; i += 4) {
+                mdec.write<uint32_t>(MDEC_COMMAND, QUANTIZATION_TABLE[i] | (QUANTIZATION_TABLE[i + 1] << 8)
+                                     | (QUANTIZATION_TABLE[i + 2] << 16) | (QUANTIZATION_TABLE[i + 3] << 24));
+            }
+        }
+
+        // set_scale with the IDCT matrix of the PsyQ libraries: the DCT basis in 1.15 fixed point, rounded down
+        mdec.write<uint32_t>(MDEC_COMMAND, 3u << 29);
+        uint16_t scale[64];
+        for (uint32_t i = 0; i < 8; ++i) {
+            for (uint32_t j = 0; j < 8; ++j) {
+                double c = i == 0 ? std::sqrt(0.5) : 1.0;
+                scale[i * 8 + j] = static_cast<int16_t>(std::floor(c * std::cos((2 * j + 1) * i * std::numbers::pi / 16) * 0x8000));
+            }
+        }
+        for (uint32_t i = 0; i < 64; i += 2) {
+            mdec.write<uint32_t>(MDEC_COMMAND, scale[i] | (scale[i + 1] << 16));
+        }
+    }
+
+    // Returns false if the bitstream cannot be decoded, the time is split into bitstream and MDEC decoding
+    bool decode(const PSX::STRDemuxer::Frame &frame, std::vector<uint8_t> &rgb,
+                std::chrono::steady_clock::duration &bitstream_time, std::chrono::steady_clock::duration &mdec_time) {
+        auto start = std::chrono::steady_clock::now();
+        uint32_t macroblocks = PSX::STRBitstream::get_macroblocks(frame.width, frame.height);
+        input.clear();
+        if (!PSX::STRBitstream::decode(frame.bitstream, macroblocks, input)) {
+            return false;
+        }
+        if (input.size() & 1) {
+            input.push_back(MDEC_END_OF_BLOCK);
+        }
+        // A frame that does not fit into a single command would be cut off by the MDEC
+        if (input.size() / 2 > MDEC_MAX_PARAMETER_WORDS) {
+            return false;
+        }
+        auto decoded = std::chrono::steady_clock::now();
+        bitstream_time += decoded - start;
+
+        // decode_macroblock, 24 bit unsigned
+        mdec.write<uint32_t>(MDEC_COMMAND, (1u << 29) | (2u << 27) | (static_cast<uint32_t>(input.size() / 2) & MDEC_MAX_PARAMETER_WORDS));
+        for (size_t i = 0; i < input.size(); i += 2) {
+            mdec.write<uint32_t>(MDEC_COMMAND, input[i] | (input[i + 1] << 16));
+        }
+
+        // Macroblocks are 16 * 16 pixels of 3 bytes, column by column
+        uint32_t rows = (frame.height + 15) / 16;
+        rgb.assign(frame.width * frame.height * 3, 0);
+        for (uint32_t m = 0; m < macroblocks; ++m) {
+            uint32_t x0 = m / rows * 16;
+            uint32_t y0 = m % rows * 16;
+            for (uint32_t y = 0; y < 16; ++y) {
+                for (uint32_t i = 0; i < 24; ++i) {
+                    uint16_t halfword = mdec.read();
+                    uint8_t bytes[2] = {static_cast<uint8_t>(halfword), static_cast<uint8_t>(halfword >> 8)};
+                    for (uint32_t b = 0; b < 2; ++b) {
+                        uint32_t x = x0 + (2 * i + b) / 3;
+                        if (x < frame.width && y0 + y < frame.height) {
+                            rgb[((y0 + y) * frame.width + x) * 3 + (2 * i + b) % 3] = bytes[b];
+                        }
+                    }
+                }
+            }
+        }
+        mdec_time += std::chrono::steady_clock::now() - decoded;
+
+        return true;
+    }
+};
+
+// Full-range RGB to limited-range BT.601 YCbCr, planar
+void write_y4m_frame(std::ofstream &out, const std::vector<uint8_t> &rgb) {
+    size_t pixels = rgb.size() / 3;
+    std::vector<uint8_t> planes(3 * pixels);
+    for (size_t p = 0; p < pixels; ++p) {
+        int32_t r = rgb[3 * p], g = rgb[3 * p + 1], b = rgb[3 * p + 2];
+        planes[p] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+        planes[pixels + p] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+        planes[2 * pixels + p] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+    }
+    out << "FRAME\n";
+    out.write(reinterpret_cast<const char*>(planes.data()), planes.size());
+}
+
+}
+
+// Demuxes the STR videos of a disc image and decodes them with the emulator's MDEC, outside the emulated machine.
+// Reports the decoding speed and a hash of all frames, so that MDEC changes can be checked to be bit-exact.
+int main(int argc, char *argv[]) {
+    std::optional<Options> options = parse_options(argc, argv);
+    if (!options) {
+        print_usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        PSX::CD cd(options->cue_sheet);
+
+        // Sectors to look at
+        uint32_t first = 0;
+        uint32_t end = UINT32_MAX;
+        if (!options->file.empty()) {
+            PSX::ISO9660 iso9660(cd);
+            PSX::ISO9660::Extent extent;
+            if (!iso9660.open(options->file, extent)) {
+                throw std::runtime_error(std::format("\"{:s}\" not found", options->file));
+            }
+            first = PSX::ISO9660::lba_to_position(extent.lba);
+            end = first + (extent.size + ISO9660_BLOCK_SIZE - 1) / ISO9660_BLOCK_SIZE;
+        }
+
+        // Demux everything first, so that decoding can be timed (and repeated) on its own
+        std::vector<PSX::STRDemuxer::Frame> frames;
+        PSX::STRDemuxer demuxer;
+        std::vector<uint8_t> sector(PSX::CD::SECTOR_SIZE);
+        for (uint32_t position = first; position < end && cd.copy_sector(position, sector.data()); ++position) {
+            if (options->channel && sector[XA_SUBHEADER_CHANNEL] != *options->channel) {
+                continue;
+            }
+            if (demuxer.push_sector(sector.data())) {
+                frames.push_back(demuxer.get_frame());
+            }
+        }
+        if (frames.empty()) {
+            throw std::runtime_error("No STR video frames found");
+        }
+        std::cout << std::format("Demuxed {:d} frames of {:d}x{:d}", frames.size(), frames[0].width, frames[0].height) << std::endl;
+
+        std::ofstream out;
+        if (!options->output.empty()) {
+            out.open(options->output, std::ios::binary);
+            if (options->y4m) {
+                out << std::format("YUV4MPEG2 W{:d} H{:d} F15:1 Ip A1:1 C444\n", frames[0].width, frames[0].height);
+            }
+        }
+
+        FrameDecoder decoder;
+        std::vector<uint8_t> rgb;
+        std::chrono::steady_clock::duration bitstream_time{};
+        std::chrono::steady_clock::duration mdec_time{};
+        uint64_t hash = 0xCBF2'9CE4'8422'2325; // FNV-1a
+        uint32_t decoded_frames = 0;
+        for (uint32_t pass = 0; pass < options->repeat; ++pass) {
+            for (const PSX::STRDemuxer::Frame &frame : frames) {
+                if (!decoder.decode(frame, rgb, bitstream_time, mdec_time)) {
+                    std::cerr << std::format("Skipping frame {:d}", frame.number) << std::endl;
+                    continue;
+                }
+                ++decoded_frames;
+
+                if (pass == 0) {
+                    for (uint8_t byte : rgb) {
+                        hash = (hash ^ byte) * 0x100'0000'01B3;
+                    }
+                    if (out.is_open()) {
+                        if (!options->y4m) {
+                            out.write(reinterpret_cast<const char*>(rgb.data()), rgb.size());
+                        } else if (frame.width == frames[0].width && frame.height == frames[0].height) {
+                            write_y4m_frame(out, rgb);
+                        } else {
+                            std::cerr << std::format("Not writing frame {:d}, it is {:d}x{:d}", frame.number, frame.width, frame.height) << std::endl;
+                        }
+                    }
+                }
+            }
+        }
+        if (out.is_open() && !out.good()) {
+            throw std::runtime_error(std::format("Failed to write \"{:s}\"", options->output));
+        }
+
+        auto fps = [&](std::chrono::steady_clock::duration time) {
+            double seconds = std::chrono::duration<double>(time).count();
+            return seconds > 0.0 ? decoded_frames / seconds : 0.0;
+        };
+        std::cout << std::format("Decoded {:d} frames: bitstream {:.1f} fps, MDEC {:.1f} fps, total {:.1f} fps",
+                                 decoded_frames, fps(bitstream_time), fps(mdec_time), fps(bitstream_time + mdec_time)) << std::endl;
+        std::cout << std::format("Frame hash: {:016x}", hash) << std::endl;
+
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
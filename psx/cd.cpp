@@ -1,12 +1,19 @@
 #include "cd.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cerrno>
+#include <chrono>
 #include <cstring>
 #include <filesystem>
 #include <format>
-#include <iostream>
 #include <limits>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
 #include "exceptions/exceptions.h"
 #include "util/cue.h"
 #include "util/log.h"
@@ -15,35 +22,117 @@ using namespace util;
 
 namespace PSX {
 
-CD::BinaryFile::BinaryFile(std::shared_ptr<std::ifstream> stream, uint32_t offset_in_stream, uint32_t total_sectors)
-    : SectorFile(total_sectors), stream(std::move(stream)), offset_in_stream(offset_in_stream) {
-    assert(offset_in_stream <= total_sectors);
+namespace {
+
+// Content of gaps and of reads past the end of the disc
+const std::array<uint8_t, CD::SECTOR_SIZE> ZERO_SECTOR{};
+
+static_assert(SectorCache::SECTOR_SIZE == CD::SECTOR_SIZE);
+static_assert(CDPack::SECTOR_SIZE == CD::SECTOR_SIZE);
+
+}
+
+CD::Mapping::Mapping(const std::filesystem::path &path, size_t size)
+    : data(nullptr), size(size) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw exceptions::FileReadError(std::format("Failed to open file for reading: {:s}", std::strerror(errno)));
+    }
+
+    void *address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps the file referenced
+    ::close(fd);
+
+    if (address == MAP_FAILED) {
+        throw exceptions::FileReadError(std::format("Failed to map file into memory: {:s}", std::strerror(errno)));
+    }
+    data = static_cast<const uint8_t*>(address);
+}
+
+CD::Mapping::~Mapping() {
+    munmap(const_cast<uint8_t*>(data), size);
+}
+
+void CD::Mapping::advise(size_t offset, size_t length, int advice) const {
+    static const size_t page_size = sysconf(_SC_PAGESIZE);
+
+    assert(offset + length <= size);
+    size_t begin = offset - offset % page_size;
+    if (madvise(const_cast<uint8_t*>(data) + begin, offset + length - begin, advice) != 0) {
+        LOGV_CDIMG(std::format("madvise failed: {:s}", std::strerror(errno)));
+    }
+}
+
+CD::MappedFile::MappedFile(std::shared_ptr<Mapping> mapping, uint32_t offset_in_mapping, uint32_t total_sectors)
+    : SectorFile(total_sectors), mapping(std::move(mapping)), offset_in_mapping(offset_in_mapping) {
+    assert((static_cast<size_t>(offset_in_mapping) + total_sectors) * SECTOR_SIZE <= this->mapping->get_size());
     reset();
 }
 
-void CD::BinaryFile::reset() {
-    stream->seekg(offset_in_stream * SECTOR_SIZE, std::ios::beg);
-    assert(stream->good());
+void CD::MappedFile::reset() {
+    read_sectors = 0;
 }
 
-void CD::BinaryFile::seek_by(uint32_t sectors) {
+void CD::MappedFile::seek_by(uint32_t sectors) {
     assert(sectors <= get_remaining_sectors());
-    stream->seekg(sectors * SECTOR_SIZE, std::ios::cur);
-    assert(stream->good());
+    read_sectors += sectors;
+}
+
+CD::Sector CD::MappedFile::read_sector() {
+    assert(read_sectors < get_total_sectors());
+    size_t offset = static_cast<size_t>(offset_in_mapping + read_sectors) * SECTOR_SIZE;
+    ++read_sectors;
+    return Sector(mapping->get_data() + offset, SECTOR_SIZE);
 }
 
-void CD::BinaryFile::read_sector(uint8_t* buffer) {
-    assert(stream->good());
-    stream->read(reinterpret_cast<char*>(buffer), SECTOR_SIZE);
+void CD::MappedFile::copy_sector(uint32_t sector, uint8_t *buffer) const {
+    assert(sector < get_total_sectors());
+    size_t offset = static_cast<size_t>(offset_in_mapping + sector) * SECTOR_SIZE;
+    std::memcpy(buffer, mapping->get_data() + offset, SECTOR_SIZE);
+}
+
+uint32_t CD::MappedFile::get_read_sectors() {
+    return read_sectors;
+}
+
+void CD::MappedFile::will_need(uint32_t first_sector, uint32_t sectors) {
+    assert(first_sector + sectors <= get_total_sectors());
+    mapping->advise(static_cast<size_t>(offset_in_mapping + first_sector) * SECTOR_SIZE,
+                    static_cast<size_t>(sectors) * SECTOR_SIZE, MADV_WILLNEED);
+}
+
+CD::PackedFile::PackedFile(std::shared_ptr<PackedImage> image, uint32_t offset_in_image, uint32_t total_sectors)
+    : SectorFile(total_sectors), image(std::move(image)), offset_in_image(offset_in_image) {
+    assert(offset_in_image + total_sectors <= this->image->reader.get_total_sectors());
+    reset();
 }
 
-uint32_t CD::BinaryFile::get_read_sectors() {
-    auto pos = stream->tellg();
-    assert(pos % SECTOR_SIZE == 0);
-    uint32_t read = pos / SECTOR_SIZE;
-    assert(read >= offset_in_stream);
-    assert(read - offset_in_stream <= get_total_sectors());
-    return read - offset_in_stream;
+void CD::PackedFile::reset() {
+    read_sectors = 0;
+}
+
+void CD::PackedFile::seek_by(uint32_t sectors) {
+    assert(sectors <= get_remaining_sectors());
+    read_sectors += sectors;
+}
+
+CD::Sector CD::PackedFile::read_sector() {
+    assert(read_sectors < get_total_sectors());
+    auto& sector = image->sectors[image->next_sector];
+    image->next_sector = (image->next_sector + 1) % CD_SECTOR_SPAN_LIFETIME;
+
+    image->reader.read_sector(offset_in_image + read_sectors, sector.data());
+    ++read_sectors;
+    return sector;
+}
+
+void CD::PackedFile::copy_sector(uint32_t sector, uint8_t *buffer) const {
+    assert(sector < get_total_sectors());
+    image->reader.read_sector(offset_in_image + sector, buffer);
+}
+
+uint32_t CD::PackedFile::get_read_sectors() {
+    return read_sectors;
 }
 
 CD::Gap::Gap(uint32_t sectors)
@@ -60,9 +149,14 @@ void CD::Gap::seek_by(uint32_t sectors) {
     read_sectors += sectors;
 }
 
-void CD::Gap::read_sector(uint8_t* buffer) {
+CD::Sector CD::Gap::read_sector() {
     assert(read_sectors < get_total_sectors());
     ++read_sectors;
+    return ZERO_SECTOR;
+}
+
+void CD::Gap::copy_sector(uint32_t sector, uint8_t *buffer) const {
+    assert(sector < get_total_sectors());
     std::memset(buffer, 0, SECTOR_SIZE);
 }
 
@@ -71,7 +165,8 @@ uint32_t CD::Gap::get_read_sectors() {
 }
 
 
-CD::CD(const std::string &cue_sheet_filename) {
+CD::CD(const std::string &cue_sheet_filename)
+    : total_sectors(0), streaming(false), read_ahead_end(0), prefetch_end(0), next_served_sector(0), seek_statistics{} {
     open_cue_sheet(cue_sheet_filename);
     reset();
 }
@@ -91,8 +186,9 @@ void CD::open_cue_sheet(const std::string &filename) {
 
     uint32_t expected_track_number = 1;
     for (const cue::File& file : cue_sheet.files) {
-        // Open stream for file
-        std::shared_ptr<std::ifstream> stream = std::make_shared<std::ifstream>();
+        // Map file into memory, or open it as packed image
+        std::shared_ptr<Mapping> mapping;
+        std::shared_ptr<PackedImage> packed_image;
         uint32_t sectors_in_stream = 0;
         if (file.type == cue::File::Type::BINARY) {
             std::filesystem::path path_to_file(path_to_cue_sheet.replace_filename(file.filename));
@@ -104,23 +200,38 @@ void CD::open_cue_sheet(const std::string &filename) {
             } catch (std::filesystem::filesystem_error &e) {
                 throw exceptions::FileReadError(std::format("Failed to determine size of file: {:s}", e.what()));
             }
-            if (size % CD::SECTOR_SIZE != 0) {
-                throw exceptions::FileReadError("File does not divide evenly into sectors of size " + CD::SECTOR_SIZE);
+
+            if (CDPack::is_packed(path_to_file)) {
+                packed_image = std::make_shared<PackedImage>(path_to_file);
+                sectors_in_stream = packed_image->reader.get_total_sectors();
+                LOG_CDIMG(std::format("Packed image with {:d} sectors in {:d} bytes", sectors_in_stream, size));
+            } else {
+                if (size % CD::SECTOR_SIZE != 0) {
+                    throw exceptions::FileReadError("File does not divide evenly into sectors of size " + CD::SECTOR_SIZE);
+                }
+                sectors_in_stream = size / CD::SECTOR_SIZE;
             }
-            sectors_in_stream = size / CD::SECTOR_SIZE;
+
             if (sectors_in_stream == 0) {
                 throw exceptions::FileReadError("File contains no sectors");
             }
 
-            stream->open(path_to_file.c_str(), std::ios::binary);
-            if (!stream->good()) {
-                throw exceptions::FileReadError("Failed to open file for reading");
+            if (!packed_image) {
+                mapping = std::make_shared<Mapping>(path_to_file, size);
+                mappings.push_back(mapping);
             }
 
         } else {
             throw exceptions::FileReadError(std::format("Unsupported type for file \"{:s}\": {:s}", file.filename, cue::File::type_to_string(file.type)));
         }
 
+        auto make_file = [&](uint32_t offset, uint32_t length) -> std::unique_ptr<SectorFile> {
+            if (packed_image) {
+                return std::make_unique<PackedFile>(packed_image, offset, length);
+            }
+            return std::make_unique<MappedFile>(mapping, offset, length);
+        };
+
         if (file.tracks.empty()) {
             throw exceptions::FileReadError(std::format("File \"{:s}\" has no tracks", file.filename));
         }
@@ -197,7 +308,7 @@ void CD::open_cue_sheet(const std::string &filename) {
                                      index_it->number,
                                      current_position_on_disc - track_on_disc.position_on_disc,
                                      index_length,
-                                     std::make_unique<BinaryFile>(stream, current_position_in_stream, index_length));
+                                     make_file(current_position_in_stream, index_length));
                 {
                     const auto& back = indexes.back();
                     LOG_CDIMG(std::format("Index {:d}: {:s} in track {:d}, length {:s} (File at {:s})", back.number, Index(back.position_in_track), back.track.number, Index(back.length), Index(current_position_in_stream)));
@@ -212,26 +323,145 @@ void CD::open_cue_sheet(const std::string &filename) {
             }
         }
     }
+    index_positions.clear();
+    index_positions.reserve(indexes.size());
+    for (const auto& index : indexes) {
+        index_positions.push_back(index.track.position_on_disc + index.position_in_track);
+    }
+    total_sectors = indexes.empty() ? 0 : index_positions.back() + indexes.back().length;
 }
 
-void CD::seek_to_bcd(uint8_t bcd_minutes, uint8_t bcd_seconds, uint8_t bcd_sectors) {
-    LOGV_CDIMG(std::format("Absolute seek to 0x{:02X},0x{:02X},0x{:02X} (BCD)", bcd_minutes, bcd_seconds, bcd_sectors));
+CD::Preload::Preload(uint32_t total_sectors)
+    : arena(std::make_unique_for_overwrite<uint8_t[]>(static_cast<size_t>(total_sectors) * SECTOR_SIZE)),
+      total_sectors(total_sectors),
+      loaded_sectors(0),
+      stopping(false) {
+}
+
+CD::Preload::~Preload() {
+    stopping.store(true);
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void CD::start_preload() {
+    LOG_CDIMG(std::format("Preloading {:d} sectors ({:d} MiB)", total_sectors, static_cast<size_t>(total_sectors) * SECTOR_SIZE >> 20));
+
+    preload = std::make_unique<Preload>(total_sectors);
+    preload->thread = std::thread(&CD::run_preload, this);
+}
+
+double CD::get_preload_progress() const {
+    if (!preload) {
+        return 1.0;
+    }
+
+    return static_cast<double>(preload->loaded_sectors.load()) / preload->total_sectors;
+}
+
+void CD::run_preload() {
+    auto start = std::chrono::steady_clock::now();
+    uint32_t position = 0;
+    uint32_t next_report = preload->total_sectors / 10;
+
+    // Indexes are consecutive on disc
+    for (const auto& index : indexes) {
+        for (uint32_t sector = 0; sector < index.length; ++sector) {
+            if (preload->stopping.load(std::memory_order_relaxed)) {
+                return;
+            }
+
+            index.file->copy_sector(sector, &preload->arena[static_cast<size_t>(position) * SECTOR_SIZE]);
+            ++position;
+            preload->loaded_sectors.store(position, std::memory_order_release);
+
+            if (position % CD_PRELOAD_NOTIFY_INTERVAL == 0) {
+                preload->loaded_sectors.notify_all();
+            }
+            if (position >= next_report) {
+                LOGV_CDIMG(std::format("Preloaded {:d}%", 100ULL * position / preload->total_sectors));
+                next_report += preload->total_sectors / 10;
+            }
+        }
+    }
+    preload->loaded_sectors.notify_all();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    LOG_CDIMG(std::format("Preloaded {:d} sectors in {:.2f} s", position, seconds));
+}
+
+CD::Sector CD::read_preloaded_sector(uint32_t position) {
+    assert(position < preload->total_sectors);
+
+    uint32_t loaded = preload->loaded_sectors.load(std::memory_order_acquire);
+    if (position >= loaded) {
+        LOGV_CDIMG(std::format("Waiting for preloading of sector {}", Index(position)));
+        while ((loaded = preload->loaded_sectors.load(std::memory_order_acquire)) <= position) {
+            preload->loaded_sectors.wait(loaded, std::memory_order_acquire);
+        }
+    }
 
+    return Sector(&preload->arena[static_cast<size_t>(position) * SECTOR_SIZE], SECTOR_SIZE);
+}
+
+void CD::enable_prefetching(uint32_t window) {
+    LOG_CDIMG(std::format("Prefetching {:d} sectors ahead", window));
+
+    cache = std::make_unique<SectorCache>([this](uint32_t lba, uint8_t *buffer) {
+        return copy_sector(lba, buffer);
+    }, window);
+    prefetch_end = 0;
+}
+
+uint32_t CD::bcd_to_sectors(uint8_t bcd_minutes, uint8_t bcd_seconds, uint8_t bcd_sectors) {
     uint8_t minutes = (bcd_minutes >> 4) * 10 + (bcd_minutes & 0x0F);
     uint8_t seconds = (bcd_seconds >> 4) * 10 + (bcd_seconds & 0x0F);
     uint8_t sectors = (bcd_sectors >> 4) * 10 + (bcd_sectors & 0x0F);
-    seek_to(Index(minutes, seconds, sectors).total_sectors());
+    return Index(minutes, seconds, sectors).total_sectors();
 }
 
-bool CD::read_sector_and_advance(uint8_t *buffer) {
-    LOGV_CDIMG(std::format("Reading sector into buffer"));
+void CD::seek_to_bcd(uint8_t bcd_minutes, uint8_t bcd_seconds, uint8_t bcd_sectors) {
+    LOGV_CDIMG(std::format("Absolute seek to 0x{:02X},0x{:02X},0x{:02X} (BCD)", bcd_minutes, bcd_seconds, bcd_sectors));
+
+    seek_to(bcd_to_sectors(bcd_minutes, bcd_seconds, bcd_sectors));
+}
+
+void CD::prefetch_bcd(uint8_t bcd_minutes, uint8_t bcd_seconds, uint8_t bcd_sectors) {
+    if (!cache) {
+        return;
+    }
+
+    uint32_t position = bcd_to_sectors(bcd_minutes, bcd_seconds, bcd_sectors);
+    LOGV_CDIMG(std::format("Prefetching from {}", Index(position)));
+    cache->prefetch(position);
+    prefetch_end = position + cache->get_window();
+}
+
+CD::Sector CD::read_sector_and_advance(TrackOnDisc::Mode &mode) {
+    LOGV_CDIMG(std::format("Reading sector"));
+
+    if (streaming) {
+        read_ahead();
+    }
 
     while (current_index != indexes.end()) {
         auto& file = current_index->file;
         if (file->get_remaining_sectors() > 0) {
-            file->read_sector(buffer);
+            mode = current_index->track.mode;
+            if (preload) {
+                uint32_t position = get_current_position_on_disc().total_sectors();
+                file->seek_by(1);
+                return read_preloaded_sector(position);
+            }
 
-            return true;
+            if (cache) {
+                uint32_t position = get_current_position_on_disc().total_sectors();
+                file->seek_by(1);
+                return read_cached_sector(position);
+            }
+
+            return file->read_sector();
         } else {
             LOGV_CDIMG(std::format("No remaining sectors for current index, moving to next one"));
             advance_to_next_index();
@@ -239,9 +469,64 @@ bool CD::read_sector_and_advance(uint8_t *buffer) {
     }
 
     LOGW_CDIMG(std::format("Read from end of disc"));
+    mode = TrackOnDisc::Mode::MODE2_2352;
+    return ZERO_SECTOR;
+}
+
+void CD::start_streaming() {
+    LOGV_CDIMG(std::format("Start streaming at {}", get_current_position_on_disc()));
+
+    if (!streaming) {
+        for (const auto& mapping : mappings) {
+            mapping->advise(0, mapping->get_size(), MADV_SEQUENTIAL);
+        }
+        streaming = true;
+    }
+
+    read_ahead_end = 0;
+    read_ahead();
+}
+
+void CD::stop_streaming() {
+    if (!streaming) {
+        return;
+    }
+
+    LOGV_CDIMG(std::format("Stop streaming at {}", get_current_position_on_disc()));
+    for (const auto& mapping : mappings) {
+        mapping->advise(0, mapping->get_size(), MADV_NORMAL);
+    }
+    streaming = false;
+}
+
+bool CD::seek_to_track(uint32_t number) {
+    for (size_t index = 0; index < indexes.size(); ++index) {
+        if (indexes[index].track.number == number && indexes[index].number >= 1) {
+            LOGV_CDIMG(std::format("Seeking to track {:d}", number));
+            seek_to(index_positions[index]);
+            return true;
+        }
+    }
+
+    LOGW_CDIMG(std::format("Seek to non-existent track {:d}", number));
     return false;
 }
 
+void CD::skip_sector() {
+    while (current_index != indexes.end()) {
+        auto& file = current_index->file;
+        if (file->get_remaining_sectors() > 0) {
+            file->seek_by(1);
+            // Move on right away so that the track of the next sector is reported
+            if (file->get_remaining_sectors() == 0) {
+                advance_to_next_index();
+            }
+            return;
+        }
+        advance_to_next_index();
+    }
+}
+
 bool CD::at_end_of_disc() const {
     return current_index == indexes.end();
 }
@@ -271,42 +556,60 @@ CD::Index CD::get_current_position_in_track() const {
 
 CD::Index CD::get_current_position_on_disc() const {
     if (current_index != indexes.end()) {
-        const auto& index = *current_index;
-        return Index(index.track.position_on_disc + index.position_in_track + index.file->get_read_sectors());
+        return Index(index_positions[current_index - indexes.begin()] + current_index->file->get_read_sectors());
     } else {
-        // Get total number of sectors from last index
-        const auto& index = indexes.back();
-        return Index(index.track.position_on_disc + index.position_in_track + index.length);
+        return Index(total_sectors);
     }
 }
 
-void CD::seek_to(uint32_t sectors) {
-    LOGV_CDIMG(std::format("Seek to {}", Index(sectors)));
+size_t CD::find_index(uint32_t position) const {
+    if (position >= total_sectors) {
+        return indexes.size();
+    }
 
-    reset_position();
-    seek_by(sectors);
+    // Last index starting at or before the position, skips empty indexes
+    auto it = std::upper_bound(index_positions.begin(), index_positions.end(), position);
+    assert(it != index_positions.begin());
+    return std::prev(it) - index_positions.begin();
 }
 
-void CD::seek_by(uint32_t sectors) {
-    LOGV_CDIMG(std::format("Seek by {}", Index(sectors)));
+void CD::seek_to(uint32_t sectors) {
+    LOGV_CDIMG(std::format("Seek to {}", Index(sectors)));
 
-    uint32_t remaining_sectors = sectors;
-    while (current_index != indexes.end() && remaining_sectors > 0) {
-        LOGV_CDIMG(std::format("At index {:d} of track {:d}", current_index->number, current_index->track.number));
-        if (current_index->file->get_remaining_sectors() > remaining_sectors) { // Target sector is in current index
-            current_index->file->seek_by(remaining_sectors);
-            break;
+    if (cache) {
+        uint32_t position = get_current_position_on_disc().total_sectors();
+        if (sectors != position) {
+            ++seek_statistics.seeks;
+            if (sectors < position) {
+                ++seek_statistics.seeks_backward;
+                seek_statistics.total_distance += position - sectors;
+            } else {
+                if (sectors - position < cache->get_window()) {
+                    ++seek_statistics.seeks_within_window;
+                }
+                seek_statistics.total_distance += sectors - position;
+            }
+        }
 
-        } else { // Target sector is in upcoming index
-            remaining_sectors -= current_index->file->get_remaining_sectors();
-            LOGV_CDIMG(std::format("Advancing to next index with {:d} sectors remaining", remaining_sectors));
-            advance_to_next_index();
+        if (sectors >= prefetch_end || sectors + cache->get_window() < prefetch_end) {
+            // Not covered by the current prefetch window
+            cache->prefetch(sectors);
+            prefetch_end = sectors + cache->get_window();
         }
     }
 
-    if (current_index == indexes.end() && remaining_sectors > 0) {
-        LOGW_CDIMG(std::format("Seek by {:d} sectors past end of disc", sectors));
+    read_ahead_end = 0;
+
+    size_t index = find_index(sectors);
+    current_index = indexes.begin() + index;
+    if (current_index == indexes.end()) {
+        LOGW_CDIMG(std::format("Seek to {} past end of disc", Index(sectors)));
+        return;
     }
+
+    LOGV_CDIMG(std::format("At index {:d} of track {:d}", current_index->number, current_index->track.number));
+    current_index->file->reset();
+    current_index->file->seek_by(sectors - index_positions[index]);
 }
 
 void CD::reset_position() {
@@ -324,5 +627,75 @@ void CD::advance_to_next_index() {
     }
 }
 
+void CD::read_ahead() {
+    if (current_index == indexes.end()) {
+        return;
+    }
+
+    // Only ask again once half of the window has been consumed to keep the number of syscalls low
+    uint32_t position = get_current_position_on_disc().total_sectors();
+    if (position + CD_READ_AHEAD_SECTORS / 2 < read_ahead_end) {
+        return;
+    }
+
+    uint32_t remaining = CD_READ_AHEAD_SECTORS;
+    uint32_t first_sector = current_index->file->get_read_sectors();
+    for (auto index = current_index; index != indexes.end() && remaining > 0; ++index) {
+        uint32_t sectors = std::min(remaining, index->file->get_total_sectors() - first_sector);
+        if (sectors > 0) {
+            index->file->will_need(first_sector, sectors);
+        }
+        remaining -= sectors;
+        first_sector = 0;
+    }
+
+    read_ahead_end = position + CD_READ_AHEAD_SECTORS;
+}
+
+bool CD::copy_sector(uint32_t position, uint8_t *buffer) const {
+    size_t index = find_index(position);
+    if (index == indexes.size()) {
+        return false;
+    }
+
+    indexes[index].file->copy_sector(position - index_positions[index], buffer);
+    return true;
+}
+
+CD::Sector CD::read_cached_sector(uint32_t position) {
+    // Keep the window ahead of the read position
+    if (position + cache->get_window() / 2 >= prefetch_end) {
+        cache->prefetch(position + 1);
+        prefetch_end = position + 1 + cache->get_window();
+    }
+
+    std::shared_ptr<const SectorCache::SectorData> data = cache->get(position);
+    if (!data) {
+        LOGW_CDIMG(std::format("Failed to read sector {} through cache", Index(position)));
+        return ZERO_SECTOR;
+    }
+
+    served_sectors[next_served_sector] = data;
+    next_served_sector = (next_served_sector + 1) % CD_SECTOR_SPAN_LIFETIME;
+
+    if (++seek_statistics.reads % CD_CACHE_STATISTICS_INTERVAL == 0) {
+        log_cache_statistics();
+    }
+
+    return Sector(data->data(), data->size());
 }
 
+void CD::log_cache_statistics() {
+    SectorCache::Statistics statistics = cache->get_statistics();
+    uint64_t lookups = statistics.hits + statistics.misses;
+    double hit_rate = lookups ? 100.0 * statistics.hits / lookups : 0.0;
+    double average_distance = seek_statistics.seeks ? static_cast<double>(seek_statistics.total_distance) / seek_statistics.seeks : 0.0;
+
+    LOG_CDIMG(std::format("Cache: {:.1f}% hits ({:d} hits, {:d} misses), {:d} prefetched, {:d} evicted",
+                          hit_rate, statistics.hits, statistics.misses, statistics.prefetched, statistics.evicted));
+    LOG_CDIMG(std::format("Seeks: {:d} in {:d} reads, {:d} within window, {:d} backward, average distance {:.1f} sectors",
+                          seek_statistics.seeks, seek_statistics.reads, seek_statistics.seeks_within_window,
+                          seek_statistics.seeks_backward, average_distance));
+}
+
+}
@@ -1,12 +1,20 @@
 #ifndef PSX_CD_H
 #define PSX_CD_H
 
+#include <array>
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
-#include <fstream>
+#include <filesystem>
 #include <list>
 #include <memory>
+#include <span>
 #include <string>
+#include <thread>
+#include <vector>
 
+#include "cdpack.h"
+#include "sectorcache.h"
 #include "util/cue.h"
 
 namespace PSX {
@@ -22,7 +30,25 @@ namespace PSX {
 #define CD_SECTORS_PER_SECOND 75
 #define CD_TWO_SECONDS 2 * CD_SECTORS_PER_SECOND
 
+// Sectors the host OS is asked to page in ahead of the read position while streaming
+#define CD_READ_AHEAD_SECTORS CD_SECTORS_PER_SECOND
+
+// Preloading wakes up readers waiting for sectors every this many sectors
+#define CD_PRELOAD_NOTIFY_INTERVAL 32
+
+// Log cache hit rate and seek pattern every this many sectors read through the cache
+#define CD_CACHE_STATISTICS_INTERVAL (10 * CD_SECTORS_PER_SECOND)
+
+// A sector returned by read_sector_and_advance() stays valid at least until
+// this many further sectors have been read (has to cover the sectors the CD-ROM controller holds)
+#define CD_SECTOR_SPAN_LIFETIME 16
+
 class CD {
+public:
+    static const uint32_t SECTOR_SIZE = 2352; // 0x930
+    using Index = util::cue::Index;
+    using Sector = std::span<const uint8_t>;
+
 private:
     class SectorFile {
     protected:
@@ -30,27 +56,78 @@ private:
 
     public:
         SectorFile(uint32_t total_sectors) : total_sectors(total_sectors) {}
+        virtual ~SectorFile() = default;
 
         virtual void reset() = 0;
         virtual void seek_by(uint32_t sectors) = 0;
         virtual void seek_to_end() { seek_by(get_remaining_sectors()); }
-        virtual void read_sector(uint8_t* buffer) = 0;
+        virtual Sector read_sector() = 0;
+        // Random access that does not change the position, safe to call from other threads
+        virtual void copy_sector(uint32_t sector, uint8_t *buffer) const = 0;
         virtual uint32_t get_read_sectors() = 0;
         uint32_t get_remaining_sectors() { return get_total_sectors() - get_read_sectors(); }
         uint32_t get_total_sectors() const { return total_sectors; }
+
+        // Hints that the given sectors (relative to the start of this file) will be read soon
+        virtual void will_need(uint32_t /* first_sector */, uint32_t /* sectors */) {}
     };
 
-    class BinaryFile : public SectorFile {
+    // A .bin file mapped read-only into memory, shared by all indexes located in it.
+    // Sectors are handed out as spans into the mapping, so reading does neither copy nor need syscalls.
+    class Mapping {
     private:
-        // The stream position is used to keep track of which sector we are currently at
-        std::shared_ptr<std::ifstream> stream;
-        const uint32_t offset_in_stream;
+        const uint8_t *data;
+        size_t size;
 
     public:
-        BinaryFile(std::shared_ptr<std::ifstream> stream, uint32_t offset_in_stream, uint32_t total_sectors);
+        Mapping(const std::filesystem::path &path, size_t size);
+        Mapping(const Mapping&) = delete;
+        ~Mapping();
+
+        const uint8_t* get_data() const { return data; }
+        size_t get_size() const { return size; }
+        // madvise() for the pages containing the given byte range
+        void advise(size_t offset, size_t length, int advice) const;
+    };
+
+    class MappedFile : public SectorFile {
+    private:
+        std::shared_ptr<Mapping> mapping;
+        const uint32_t offset_in_mapping; // in sectors
+        uint32_t read_sectors;
+
+    public:
+        MappedFile(std::shared_ptr<Mapping> mapping, uint32_t offset_in_mapping, uint32_t total_sectors);
         void reset() override;
         void seek_by(uint32_t sectors) override;
-        void read_sector(uint8_t* buffer) override;
+        Sector read_sector() override;
+        void copy_sector(uint32_t sector, uint8_t *buffer) const override;
+        uint32_t get_read_sectors() override;
+        void will_need(uint32_t first_sector, uint32_t sectors) override;
+    };
+
+    // A packed image (see cdpack.h), shared by all indexes located in it
+    struct PackedImage {
+        CDPackReader reader;
+        // Sectors handed out last, decoded chunks may be evicted (see CD_SECTOR_SPAN_LIFETIME)
+        std::array<std::array<uint8_t, SECTOR_SIZE>, CD_SECTOR_SPAN_LIFETIME> sectors;
+        uint32_t next_sector;
+
+        explicit PackedImage(const std::filesystem::path &path) : reader(path), next_sector(0) {}
+    };
+
+    class PackedFile : public SectorFile {
+    private:
+        std::shared_ptr<PackedImage> image;
+        const uint32_t offset_in_image; // in sectors
+        uint32_t read_sectors;
+
+    public:
+        PackedFile(std::shared_ptr<PackedImage> image, uint32_t offset_in_image, uint32_t total_sectors);
+        void reset() override;
+        void seek_by(uint32_t sectors) override;
+        Sector read_sector() override;
+        void copy_sector(uint32_t sector, uint8_t *buffer) const override;
         uint32_t get_read_sectors() override;
     };
 
@@ -62,7 +139,8 @@ private:
         Gap(uint32_t sectors);
         void reset() override;
         void seek_by(uint32_t sectors) override;
-        void read_sector(uint8_t* buffer) override;
+        Sector read_sector() override;
+        void copy_sector(uint32_t sector, uint8_t *buffer) const override;
         uint32_t get_read_sectors() override;
     };
 
@@ -84,22 +162,82 @@ private:
         std::unique_ptr<SectorFile> file;
     };
 
-    std::list<std::ifstream> streams;
+    std::list<std::shared_ptr<Mapping>> mappings;
     std::list<TrackOnDisc> tracks;
 
     std::vector<IndexOnDisc> indexes;
     std::vector<IndexOnDisc>::iterator current_index;
+    // Absolute position on disc (in sectors) of each index, ascending, for binary search
+    std::vector<uint32_t> index_positions;
+    uint32_t total_sectors;
 
-public:
-    static const uint32_t SECTOR_SIZE = 2352; // 0x930
-    using Index = util::cue::Index;
+    // Sequential reading (ReadN/ReadS) in progress
+    bool streaming;
+    // Position on disc (in sectors) up to which read-ahead has been requested
+    uint32_t read_ahead_end;
 
+    // The whole disc in one contiguous arena, filled by a background thread.
+    // Sectors are served from the arena if present, waiting only for sectors not loaded yet.
+    struct Preload {
+        std::unique_ptr<uint8_t[]> arena;
+        const uint32_t total_sectors;
+        // Sectors [0, loaded_sectors) are in the arena
+        std::atomic<uint32_t> loaded_sectors;
+        std::atomic<bool> stopping;
+        std::thread thread;
+
+        explicit Preload(uint32_t total_sectors);
+        ~Preload();
+    };
+    // Declared after the indexes since its thread reads from them
+    std::unique_ptr<Preload> preload;
+
+    // Optional prefetching into a sector cache, sectors are served from the cache if enabled.
+    // Declared after the indexes since its worker thread reads from them.
+    std::unique_ptr<SectorCache> cache;
+    // Position on disc (in sectors) up to which prefetching has been requested
+    uint32_t prefetch_end;
+    // Keeps the most recently served cached sectors alive (see CD_SECTOR_SPAN_LIFETIME)
+    std::array<std::shared_ptr<const SectorCache::SectorData>, CD_SECTOR_SPAN_LIFETIME> served_sectors;
+    uint32_t next_served_sector;
+
+    // Seek pattern, logged together with the cache statistics
+    struct SeekStatistics {
+        uint64_t reads;
+        uint64_t seeks;
+        uint64_t seeks_within_window; // forward by less than the prefetch window
+        uint64_t seeks_backward;
+        uint64_t total_distance; // in sectors
+    };
+    SeekStatistics seek_statistics;
+
+public:
     CD(const std::string &filename);
     void reset();
 
     void open_cue_sheet(const std::string &filename);
+    // Serve sectors from a cache that is filled window sectors ahead on a worker thread
+    void enable_prefetching(uint32_t window);
+    // Read the whole disc into memory in the background, sectors are served from memory afterwards
+    void start_preload();
+    // Fraction of the disc preloaded so far, 1.0 if not preloading
+    double get_preload_progress() const;
     void seek_to_bcd(uint8_t bcd_minutes, uint8_t bcd_seconds, uint8_t bcd_sectors);
-    bool read_sector_and_advance(uint8_t *buffer);
+    // Start reading the sectors at the given position in the background (if prefetching is enabled)
+    void prefetch_bcd(uint8_t bcd_minutes, uint8_t bcd_seconds, uint8_t bcd_sectors);
+    // Seek to index 1 of the given track, returns false if there is no such track
+    bool seek_to_track(uint32_t number);
+    // Returns an all-zero sector (of a data track) when reading past the end of the disc,
+    // mode is the one of the track the sector is in (the current one may already be the next track)
+    Sector read_sector_and_advance(TrackOnDisc::Mode &mode);
+    // Advance by one sector without reading it (e.g., while the sector is played back from elsewhere)
+    void skip_sector();
+    // Thread-safe random access to the sector at the given position on disc, false if past the end
+    bool copy_sector(uint32_t position, uint8_t *buffer) const;
+
+    // Access pattern hints for the host OS while the drive is reading data
+    void start_streaming();
+    void stop_streaming();
 
     bool at_end_of_disc() const;
     TrackOnDisc::Mode get_current_track_mode() const;
@@ -109,11 +247,19 @@ public:
     Index get_current_position_on_disc() const;
 
 private:
+    static uint32_t bcd_to_sectors(uint8_t bcd_minutes, uint8_t bcd_seconds, uint8_t bcd_sectors);
+    Sector read_cached_sector(uint32_t position);
+    void run_preload();
+    Sector read_preloaded_sector(uint32_t position);
+    void log_cache_statistics();
+
+    // Index containing the given position on disc, indexes.size() if past the end
+    size_t find_index(uint32_t position) const;
     void seek_to(uint32_t sectors);
-    void seek_by(uint32_t sectors);
 
     void reset_position();
     void advance_to_next_index();
+    void read_ahead();
 };
 
 }
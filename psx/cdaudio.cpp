@@ -0,0 +1,137 @@
+#include "cdaudio.h"
+
+#include <algorithm>
+#include <format>
+
+#include "util/log.h"
+
+#include "cd.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CDAUDIO_X86
+#include <immintrin.h>
+#endif
+
+using namespace util;
+
+namespace PSX {
+
+static_assert(sizeof(CDAudio::SectorSamples) == CD::SECTOR_SIZE);
+
+namespace {
+
+void apply_volume_scalar(const int16_t *in, int16_t *out, uint32_t frames, const uint8_t volume[4]) {
+    for (uint32_t i = 0; i < frames; ++i) {
+        int32_t left = in[2 * i];
+        int32_t right = in[2 * i + 1];
+        int32_t mixed_left = (left * volume[0] + right * volume[2]) >> 7;
+        int32_t mixed_right = (left * volume[1] + right * volume[3]) >> 7;
+        out[2 * i] = std::clamp<int32_t>(mixed_left, -0x8000, 0x7FFF);
+        out[2 * i + 1] = std::clamp<int32_t>(mixed_right, -0x8000, 0x7FFF);
+    }
+}
+
+#ifdef CDAUDIO_X86
+// Four frames at a time: each frame is a pair of 16-bit lanes,
+// multiplying the pairs with (LL, RL) and (LR, RR) and adding gives the new left and right samples
+__attribute__((target("sse2")))
+uint32_t apply_volume_sse2(const int16_t *in, int16_t *out, uint32_t frames, const uint8_t volume[4]) {
+    const __m128i to_left = _mm_set1_epi32(volume[0] | (volume[2] << 16));
+    const __m128i to_right = _mm_set1_epi32(volume[1] | (volume[3] << 16));
+
+    uint32_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128i samples = _mm_loadu_si128((const __m128i*)(in + 2 * i));
+        __m128i left = _mm_srai_epi32(_mm_madd_epi16(samples, to_left), 7);
+        __m128i right = _mm_srai_epi32(_mm_madd_epi16(samples, to_right), 7);
+        // Interleave again and saturate to 16 bits
+        __m128i mixed = _mm_packs_epi32(_mm_unpacklo_epi32(left, right), _mm_unpackhi_epi32(left, right));
+        _mm_storeu_si128((__m128i*)(out + 2 * i), mixed);
+    }
+    return i;
+}
+#endif
+
+}
+
+CDAudio::CDAudio()
+    : stopping(false),
+      playing(false),
+      underruns(0) {
+}
+
+CDAudio::~CDAudio() {
+    stop();
+}
+
+void CDAudio::start(const CD &cd, uint32_t position) {
+    stop();
+
+    LOGV_CDROM(std::format("Starting CD-DA playback at {}", CD::Index(position)));
+    ring.clear();
+    stopping.store(false);
+    playing = true;
+    worker = std::thread(&CDAudio::run, this, &cd, position);
+}
+
+void CDAudio::stop() {
+    if (!playing) {
+        return;
+    }
+
+    stopping.store(true);
+    // Wakes up the worker if it waits for space
+    ring.discard();
+    worker.join();
+    playing = false;
+
+    if (underruns > 0) {
+        LOGW_CDROM(std::format("CD-DA playback stopped, {:d} sectors were not read in time", underruns));
+        underruns = 0;
+    }
+}
+
+bool CDAudio::is_playing() const {
+    return playing;
+}
+
+const CDAudio::SectorSamples* CDAudio::read_sector() {
+    const SectorSamples *samples = ring.read_slot();
+    if (!samples) {
+        ++underruns;
+    }
+    return samples;
+}
+
+void CDAudio::pop_sector() {
+    ring.pop();
+}
+
+void CDAudio::apply_volume(const int16_t *in, int16_t *out, uint32_t frames, const uint8_t volume[4]) {
+    uint32_t done = 0;
+#ifdef CDAUDIO_X86
+    done = apply_volume_sse2(in, out, frames, volume);
+#endif
+    apply_volume_scalar(in + 2 * done, out + 2 * done, frames - done, volume);
+}
+
+void CDAudio::run(const CD *cd, uint32_t position) {
+    while (!stopping.load()) {
+        SectorSamples *samples = ring.write_slot();
+        if (!samples) {
+            ring.wait_for_space();
+            continue;
+        }
+
+        // Samples are stored little endian, just like on the host
+        if (!cd->copy_sector(position, reinterpret_cast<uint8_t*>(samples->data()))) {
+            LOGV_CDROM(std::format("CD-DA playback reached end of disc"));
+            return;
+        }
+
+        ring.push();
+        ++position;
+    }
+}
+
+}
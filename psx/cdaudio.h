@@ -0,0 +1,61 @@
+#ifndef PSX_CDAUDIO_H
+#define PSX_CDAUDIO_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+#include "util/spscring.h"
+
+namespace PSX {
+
+// A CD-DA sector holds 2352 bytes of 16-bit stereo samples at 44.1 kHz
+#define CDAUDIO_SECTOR_FRAMES 588
+// Sectors read ahead of the playback position (power of two)
+#define CDAUDIO_BUFFERED_SECTORS 16
+
+class CD;
+
+// CD-DA playback. A worker thread reads the audio sectors following the playback position
+// into a lock-free ring, the emulation thread takes one sector per sector time from it.
+class CDAudio {
+public:
+    // Interleaved left and right samples
+    using SectorSamples = std::array<int16_t, 2 * CDAUDIO_SECTOR_FRAMES>;
+
+private:
+    util::SPSCRing<SectorSamples, CDAUDIO_BUFFERED_SECTORS> ring;
+    std::thread worker;
+    std::atomic<bool> stopping;
+    bool playing;
+
+    // Sectors that were not read in time
+    uint64_t underruns;
+
+public:
+    CDAudio();
+    CDAudio(const CDAudio&) = delete;
+    ~CDAudio();
+
+    // Start reading at the given position on disc, the CD has to stay alive until stop()
+    void start(const CD &cd, uint32_t position);
+    void stop();
+    bool is_playing() const;
+
+    // Next sector in playback order, nullptr if it has not been read yet
+    const SectorSamples* read_sector();
+    // Release the sector returned by read_sector()
+    void pop_sector();
+
+    // Applies the CD-out to SPU-in volume matrix (left to left, left to right, right to left, right to right),
+    // 0x80 is 100%, results are saturated
+    static void apply_volume(const int16_t *in, int16_t *out, uint32_t frames, const uint8_t volume[4]);
+
+private:
+    void run(const CD *cd, uint32_t position);
+};
+
+}
+
+#endif
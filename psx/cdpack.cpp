@@ -0,0 +1,368 @@
+#include "cdpack.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <format>
+#include <limits>
+
+#include <zlib.h>
+
+#include "exceptions/exceptions.h"
+#include "util/edcecc.h"
+
+using namespace util;
+
+namespace PSX {
+
+namespace {
+
+void put_u32(uint8_t *destination, uint32_t value) {
+    for (uint32_t i = 0; i < 4; ++i) {
+        destination[i] = value >> (8 * i);
+    }
+}
+
+void put_u64(uint8_t *destination, uint64_t value) {
+    for (uint32_t i = 0; i < 8; ++i) {
+        destination[i] = value >> (8 * i);
+    }
+}
+
+uint32_t get_u32(const uint8_t *source) {
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(source[i]) << (8 * i);
+    }
+    return value;
+}
+
+uint64_t get_u64(const uint8_t *source) {
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < 8; ++i) {
+        value |= static_cast<uint64_t>(source[i]) << (8 * i);
+    }
+    return value;
+}
+
+bool has_sync(const uint8_t *sector) {
+    static const uint8_t sync[12] = { 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+    return std::memcmp(sector, sync, sizeof(sync)) == 0;
+}
+
+// Bytes of the type bytes and stored sectors of a chunk before compression
+uint32_t max_payload_size(uint32_t chunk_sectors) {
+    return chunk_sectors * (1 + CDPack::SECTOR_SIZE);
+}
+
+}
+
+uint32_t CDPack::get_stored_size(SectorType type) {
+    switch (type) {
+        case SectorType::RAW:
+            return SECTOR_SIZE;
+        case SectorType::ZERO:
+            return 0;
+        case SectorType::MODE1:
+            return 4 + 2048;
+        case SectorType::MODE2_FORM1:
+            return 4 + 8 + 2048;
+        case SectorType::MODE2_FORM2:
+        case SectorType::MODE2_FORM2_NO_EDC:
+            return 4 + 8 + 2324;
+        default:
+            throw exceptions::FileReadError(std::format("Invalid sector type {:d}", static_cast<uint8_t>(type)));
+    }
+}
+
+CDPack::SectorType CDPack::classify(const uint8_t *sector) {
+    if (std::all_of(sector, sector + SECTOR_SIZE, [](uint8_t byte) { return byte == 0; })) {
+        return SectorType::ZERO;
+    }
+
+    if (!has_sync(sector)) {
+        // Audio
+        return SectorType::RAW;
+    }
+
+    SectorType type = SectorType::RAW;
+    uint8_t mode = sector[0x00F];
+    if (mode == 1) {
+        type = SectorType::MODE1;
+    } else if (mode == 2) {
+        bool form2 = sector[0x012] & 0x20; // sub-mode
+        if (!form2) {
+            type = SectorType::MODE2_FORM1;
+        } else {
+            type = get_u32(&sector[0x92C]) == 0 ? SectorType::MODE2_FORM2_NO_EDC : SectorType::MODE2_FORM2;
+        }
+    }
+
+    if (type == SectorType::RAW) {
+        return type;
+    }
+
+    // Only use the compact type if regenerating reproduces the sector exactly
+    std::vector<uint8_t> stored;
+    store(type, sector, stored);
+    uint8_t restored[SECTOR_SIZE];
+    restore(type, stored.data(), restored);
+    return std::memcmp(sector, restored, SECTOR_SIZE) == 0 ? type : SectorType::RAW;
+}
+
+void CDPack::store(SectorType type, const uint8_t *sector, std::vector<uint8_t> &out) {
+    switch (type) {
+        case SectorType::RAW:
+            out.insert(out.end(), sector, sector + SECTOR_SIZE);
+            break;
+        case SectorType::ZERO:
+            break;
+        default:
+            // Everything from the header on, except EDC/ECC at the end
+            out.insert(out.end(), sector + 0x00C, sector + 0x00C + get_stored_size(type));
+            break;
+    }
+}
+
+void CDPack::restore(SectorType type, const uint8_t *stored, uint8_t *sector) {
+    switch (type) {
+        case SectorType::RAW:
+            std::memcpy(sector, stored, SECTOR_SIZE);
+            return;
+        case SectorType::ZERO:
+            std::memset(sector, 0, SECTOR_SIZE);
+            return;
+        default:
+            break;
+    }
+
+    uint32_t stored_size = get_stored_size(type);
+    std::memset(sector, 0, SECTOR_SIZE);
+    EDCECC::write_sync(sector);
+    std::memcpy(&sector[0x00C], stored, stored_size);
+
+    switch (type) {
+        case SectorType::MODE1:
+            EDCECC::write_mode1(sector);
+            break;
+        case SectorType::MODE2_FORM1:
+            EDCECC::write_mode2_form1(sector);
+            break;
+        case SectorType::MODE2_FORM2:
+            EDCECC::write_mode2_form2(sector);
+            break;
+        default:
+            break;
+    }
+}
+
+bool CDPack::is_packed(const std::filesystem::path &path) {
+    std::ifstream file(path, std::ios::binary);
+    char magic[sizeof(CDPACK_MAGIC)] = {};
+    file.read(magic, sizeof(magic));
+    return file.good() && std::memcmp(magic, CDPACK_MAGIC, sizeof(magic)) == 0;
+}
+
+CDPackWriter::Statistics CDPackWriter::pack(const std::filesystem::path &input, const std::filesystem::path &output) {
+    Statistics statistics = {};
+
+    std::ifstream in(input, std::ios::binary);
+    if (!in.good()) {
+        throw exceptions::FileReadError(std::format("Failed to open \"{:s}\" for reading", input.string()));
+    }
+    statistics.input_size = std::filesystem::file_size(input);
+    if (statistics.input_size % CDPack::SECTOR_SIZE != 0) {
+        throw exceptions::FileReadError(std::format("\"{:s}\" does not divide evenly into sectors", input.string()));
+    }
+    statistics.sectors = statistics.input_size / CDPack::SECTOR_SIZE;
+
+    std::ofstream out(output, std::ios::binary | std::ios::trunc);
+    if (!out.good()) {
+        throw exceptions::FileWriteError(std::format("Failed to open \"{:s}\" for writing", output.string()));
+    }
+
+    uint32_t chunk_count = (statistics.sectors + CDPACK_CHUNK_SECTORS - 1) / CDPACK_CHUNK_SECTORS;
+    std::vector<uint8_t> index(chunk_count * CDPACK_INDEX_ENTRY_SIZE);
+
+    // Header is written at the end when the index offset is known
+    uint8_t header[CDPACK_HEADER_SIZE] = {};
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    uint64_t offset = CDPACK_HEADER_SIZE;
+
+    std::vector<uint8_t> sectors(CDPACK_CHUNK_SECTORS * CDPack::SECTOR_SIZE);
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> compressed(compressBound(max_payload_size(CDPACK_CHUNK_SECTORS)));
+
+    for (uint32_t chunk = 0; chunk < chunk_count; ++chunk) {
+        uint32_t first_sector = chunk * CDPACK_CHUNK_SECTORS;
+        uint32_t sectors_in_chunk = std::min<uint32_t>(CDPACK_CHUNK_SECTORS, statistics.sectors - first_sector);
+        in.read(reinterpret_cast<char*>(sectors.data()), sectors_in_chunk * CDPack::SECTOR_SIZE);
+        if (!in.good()) {
+            throw exceptions::FileReadError(std::format("Failed to read sectors from \"{:s}\"", input.string()));
+        }
+
+        // Type bytes first, then the stored sectors
+        payload.assign(sectors_in_chunk, 0);
+        for (uint32_t i = 0; i < sectors_in_chunk; ++i) {
+            const uint8_t *sector = &sectors[i * CDPack::SECTOR_SIZE];
+            CDPack::SectorType type = CDPack::classify(sector);
+            payload[i] = static_cast<uint8_t>(type);
+            CDPack::store(type, sector, payload);
+            ++statistics.sectors_of_type[static_cast<uint8_t>(type)];
+        }
+
+        uLongf compressed_size = compressed.size();
+        int result = compress2(compressed.data(), &compressed_size, payload.data(), payload.size(), Z_BEST_COMPRESSION);
+        if (result != Z_OK) {
+            throw exceptions::FileWriteError(std::format("Failed to compress chunk {:d}: zlib error {:d}", chunk, result));
+        }
+
+        uint32_t flags = 0;
+        const uint8_t *stored = payload.data();
+        uint32_t stored_size = payload.size();
+        if (compressed_size < payload.size()) {
+            flags |= CDPACK_CHUNK_COMPRESSED;
+            stored = compressed.data();
+            stored_size = compressed_size;
+        }
+
+        out.write(reinterpret_cast<const char*>(stored), stored_size);
+
+        uint8_t *entry = &index[chunk * CDPACK_INDEX_ENTRY_SIZE];
+        put_u64(&entry[0], offset);
+        put_u32(&entry[8], stored_size);
+        put_u32(&entry[12], flags);
+        offset += stored_size;
+    }
+
+    out.write(reinterpret_cast<const char*>(index.data()), index.size());
+
+    std::memcpy(header, CDPACK_MAGIC, sizeof(CDPACK_MAGIC));
+    put_u32(&header[8], CDPACK_VERSION);
+    put_u32(&header[12], CDPACK_CHUNK_SECTORS);
+    put_u32(&header[16], statistics.sectors);
+    put_u32(&header[20], chunk_count);
+    put_u64(&header[24], offset);
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    out.close();
+    if (!out.good()) {
+        throw exceptions::FileWriteError(std::format("Failed to write \"{:s}\"", output.string()));
+    }
+
+    statistics.output_size = offset + index.size();
+    return statistics;
+}
+
+CDPackReader::CDPackReader(const std::filesystem::path &path)
+    : file(path, std::ios::binary) {
+    uint8_t header[CDPACK_HEADER_SIZE];
+    file.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!file.good() || std::memcmp(header, CDPACK_MAGIC, sizeof(CDPACK_MAGIC)) != 0) {
+        throw exceptions::FileReadError(std::format("\"{:s}\" is not a packed disc image", path.string()));
+    }
+
+    uint32_t version = get_u32(&header[8]);
+    if (version != CDPACK_VERSION) {
+        throw exceptions::FileReadError(std::format("Unsupported packed disc image version {:d}", version));
+    }
+
+    chunk_sectors = get_u32(&header[12]);
+    total_sectors = get_u32(&header[16]);
+    uint32_t chunk_count = get_u32(&header[20]);
+    uint64_t index_offset = get_u64(&header[24]);
+    if (chunk_sectors == 0 || chunk_count != (total_sectors + chunk_sectors - 1) / chunk_sectors) {
+        throw exceptions::FileReadError("Corrupt packed disc image header");
+    }
+
+    std::vector<uint8_t> entries(chunk_count * CDPACK_INDEX_ENTRY_SIZE);
+    file.seekg(index_offset);
+    file.read(reinterpret_cast<char*>(entries.data()), entries.size());
+    if (!file.good()) {
+        throw exceptions::FileReadError("Failed to read chunk index of packed disc image");
+    }
+
+    index.resize(chunk_count);
+    for (uint32_t chunk = 0; chunk < chunk_count; ++chunk) {
+        const uint8_t *entry = &entries[chunk * CDPACK_INDEX_ENTRY_SIZE];
+        index[chunk].offset = get_u64(&entry[0]);
+        index[chunk].stored_size = get_u32(&entry[8]);
+        index[chunk].flags = get_u32(&entry[12]);
+    }
+
+    payload_buffer.resize(max_payload_size(chunk_sectors));
+}
+
+uint32_t CDPackReader::get_total_sectors() const {
+    return total_sectors;
+}
+
+void CDPackReader::read_sector(uint32_t sector, uint8_t *buffer) {
+    assert(sector < total_sectors);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    const DecodedChunk &decoded = decode_chunk(sector / chunk_sectors);
+    std::memcpy(buffer, &decoded.sectors[(sector % chunk_sectors) * CDPack::SECTOR_SIZE], CDPack::SECTOR_SIZE);
+}
+
+const CDPackReader::DecodedChunk& CDPackReader::decode_chunk(uint32_t chunk) {
+    for (auto it = decoded_chunks.begin(); it != decoded_chunks.end(); ++it) {
+        if (it->chunk == chunk) {
+            decoded_chunks.splice(decoded_chunks.begin(), decoded_chunks, it);
+            return decoded_chunks.front();
+        }
+    }
+
+    // Reuse the least recently used chunk
+    if (decoded_chunks.size() < CDPACK_DECODED_CHUNKS) {
+        decoded_chunks.emplace_front();
+    } else {
+        decoded_chunks.splice(decoded_chunks.begin(), decoded_chunks, std::prev(decoded_chunks.end()));
+    }
+    DecodedChunk &decoded = decoded_chunks.front();
+    // Only valid once decoding has succeeded
+    decoded.chunk = std::numeric_limits<uint32_t>::max();
+    decoded.sectors.resize(chunk_sectors * CDPack::SECTOR_SIZE);
+
+    const IndexEntry &entry = index[chunk];
+    stored_buffer.resize(entry.stored_size);
+    file.seekg(entry.offset);
+    file.read(reinterpret_cast<char*>(stored_buffer.data()), entry.stored_size);
+    if (!file.good()) {
+        throw exceptions::FileReadError(std::format("Failed to read chunk {:d} of packed disc image", chunk));
+    }
+
+    const uint8_t *payload = stored_buffer.data();
+    size_t payload_size = entry.stored_size;
+    if (entry.flags & CDPACK_CHUNK_COMPRESSED) {
+        uLongf uncompressed_size = payload_buffer.size();
+        int result = uncompress(payload_buffer.data(), &uncompressed_size, stored_buffer.data(), entry.stored_size);
+        if (result != Z_OK) {
+            throw exceptions::FileReadError(std::format("Failed to decompress chunk {:d} of packed disc image: zlib error {:d}", chunk, result));
+        }
+        payload = payload_buffer.data();
+        payload_size = uncompressed_size;
+    }
+
+    uint32_t first_sector = chunk * chunk_sectors;
+    uint32_t sectors_in_chunk = std::min(chunk_sectors, total_sectors - first_sector);
+    if (payload_size < sectors_in_chunk) {
+        throw exceptions::FileReadError(std::format("Corrupt chunk {:d} in packed disc image", chunk));
+    }
+    size_t position = sectors_in_chunk; // after the type bytes
+    for (uint32_t i = 0; i < sectors_in_chunk; ++i) {
+        CDPack::SectorType type = static_cast<CDPack::SectorType>(payload[i]);
+        uint32_t stored_size = CDPack::get_stored_size(type);
+        if (position + stored_size > payload_size) {
+            throw exceptions::FileReadError(std::format("Corrupt chunk {:d} in packed disc image", chunk));
+        }
+        CDPack::restore(type, &payload[position], &decoded.sectors[i * CDPack::SECTOR_SIZE]);
+        position += stored_size;
+    }
+
+    decoded.chunk = chunk;
+    return decoded;
+}
+
+}
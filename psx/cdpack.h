@@ -0,0 +1,108 @@
+#ifndef PSX_CDPACK_H
+#define PSX_CDPACK_H
+
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace PSX {
+
+// Packed disc images store the sectors of a .bin file in independently compressed chunks.
+//
+// Layout (little endian):
+//   header    magic "PSXPACK\0", version, sectors per chunk, total sectors, chunk count, index offset
+//   chunks    deflate-compressed (or stored if that does not help): one type byte per sector, then the
+//             stored bytes of each sector; sync, EDC and ECC are not stored but regenerated on read
+//   index     per chunk: offset, stored size, flags
+#define CDPACK_MAGIC "PSXPACK"
+#define CDPACK_VERSION 1
+#define CDPACK_HEADER_SIZE 32
+#define CDPACK_INDEX_ENTRY_SIZE 16
+#define CDPACK_CHUNK_SECTORS 32
+#define CDPACK_CHUNK_COMPRESSED 0x1
+
+// Decoded chunks kept by the reader
+#define CDPACK_DECODED_CHUNKS 4
+
+class CDPack {
+public:
+    static const uint32_t SECTOR_SIZE = 2352;
+
+    // How a sector is stored
+    enum class SectorType : uint8_t {
+        RAW = 0, // all 2352 bytes
+        ZERO = 1, // nothing, e.g., gaps
+        MODE1 = 2, // header and 2048 bytes of data
+        MODE2_FORM1 = 3, // header, sub-header and 2048 bytes of data
+        MODE2_FORM2 = 4, // header, sub-header and 2324 bytes of data
+        MODE2_FORM2_NO_EDC = 5 // like MODE2_FORM2, but the (optional) EDC is zero
+    };
+
+    static uint32_t get_stored_size(SectorType type);
+    // Picks the most compact type that reproduces the sector exactly
+    static SectorType classify(const uint8_t *sector);
+    // Appends the stored bytes of the sector
+    static void store(SectorType type, const uint8_t *sector, std::vector<uint8_t> &out);
+    // Rebuilds the raw sector from its stored bytes
+    static void restore(SectorType type, const uint8_t *stored, uint8_t *sector);
+
+    static bool is_packed(const std::filesystem::path &path);
+};
+
+// Converts a .bin file into a packed image
+class CDPackWriter {
+public:
+    struct Statistics {
+        uint32_t sectors;
+        uint32_t sectors_of_type[6];
+        uint64_t input_size;
+        uint64_t output_size;
+    };
+
+    static Statistics pack(const std::filesystem::path &input, const std::filesystem::path &output);
+};
+
+// Random access to the sectors of a packed image, thread-safe
+class CDPackReader {
+private:
+    struct IndexEntry {
+        uint64_t offset;
+        uint32_t stored_size;
+        uint32_t flags;
+    };
+
+    struct DecodedChunk {
+        uint32_t chunk;
+        std::vector<uint8_t> sectors;
+    };
+
+    std::ifstream file;
+    uint32_t total_sectors;
+    uint32_t chunk_sectors;
+    std::vector<IndexEntry> index;
+
+    std::mutex mutex;
+    // Most recently used first
+    std::list<DecodedChunk> decoded_chunks;
+    std::vector<uint8_t> stored_buffer;
+    std::vector<uint8_t> payload_buffer;
+
+public:
+    explicit CDPackReader(const std::filesystem::path &path);
+    CDPackReader(const CDPackReader&) = delete;
+
+    uint32_t get_total_sectors() const;
+    void read_sector(uint32_t sector, uint8_t *buffer);
+
+private:
+    const DecodedChunk& decode_chunk(uint32_t chunk);
+};
+
+}
+
+#endif
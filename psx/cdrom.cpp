@@ -1,6 +1,9 @@
 #include "cdrom.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <format>
 
 #include "exceptions/exceptions.h"
@@ -14,6 +17,9 @@ using namespace util;
 
 namespace PSX {
 
+// The queued sectors and the one being transferred have to stay valid
+static_assert(CDROM_MAX_READ_SECTORS + 1 <= CD_SECTOR_SPAN_LIFETIME);
+
 std::string CDROM::prependState(const std::string &str) const {
     return std::format("[{:s}] {:s}", driveStateToString(drive_state), str);
 }
@@ -67,7 +73,8 @@ uint8_t CDROM::driveStateToStatByte(DriveState driveState) {
 }
 
 CDROM::CDROM(Bus *bus)
-    : bus(bus) {
+    : bus(bus),
+      speed_up(1) {
 
     reset();
     if (cd) {
@@ -85,6 +92,9 @@ void CDROM::reset() {
     audioVolumeCDOutToSPUIn[1] = 0x80;
     audioVolumeCDOutToSPUIn[2] = 0x80;
     audioVolumeCDOutToSPUIn[3] = 0x80;
+    std::copy(std::begin(audioVolumeCDOutToSPUIn), std::end(audioVolumeCDOutToSPUIn), applied_audio_volume);
+    muted = false;
+    xa_adpcm_muted = false;
 
     interruptEnableRegister = 0;
     interruptFlagRegister = 0;
@@ -102,20 +112,27 @@ void CDROM::reset() {
     cycles_left= 0;
     response_queue.clear();
 
-    current_sector_buffer.reset(nullptr);
-    read_sector_buffers.clear();
-    unused_sector_buffers.clear();
+    current_sector = {};
+    read_sectors.clear();
+    sectors_read = 0;
+    last_sector_is_audio = false;
+    last_sector_to_spu = false;
+    last_sector_on_audio_track = false;
+
+    xa_decoder.reset();
+    filter_file = 0;
+    filter_channel = 0;
 
-    // Let us start with three sector buffers
-    unused_sector_buffers.emplace_back(std::make_unique<uint8_t[]>(CD::SECTOR_SIZE));
-    unused_sector_buffers.emplace_back(std::make_unique<uint8_t[]>(CD::SECTOR_SIZE));
-    unused_sector_buffers.emplace_back(std::make_unique<uint8_t[]>(CD::SECTOR_SIZE));
+    cd_audio.stop();
+    play_cycles_left = 0;
+    play_report.fill(0);
 
     last_sector_header.reset();
 
     amm = 0;
     ass = 0;
     asect = 0;
+    set_loc_pending = false;
 
     mode = 0;
     sector_offset = 0;
@@ -123,15 +140,74 @@ void CDROM::reset() {
 }
 
 void CDROM::setCD(std::unique_ptr<CD> cd) {
+    // Playback reads from the old CD
+    cd_audio.stop();
+
+    // Sectors point into the image of the old CD
+    current_sector = {};
+    read_sectors.clear();
+    sector_offset = 0;
+    sector_end = 0;
+
     this->cd = std::move(cd);
     drive_state = MOTOR_ON;
 }
 
+void CDROM::set_booted_state() {
+    LOGV_CDROM(prependState("Skipping the BIOS boot"));
+
+    // Done reading, spinning and no interrupt left for the kernel to acknowledge
+    stop_playing();
+    if (cd) {
+        cd->stop_streaming();
+    }
+    current_sector = {};
+    read_sectors.clear();
+    sector_offset = 0;
+    sector_end = 0;
+
+    parameter_queue.clear();
+    response_queue.clear();
+    scheduled_responses.clear();
+    cycles_left = 0;
+    pending_command = false;
+    waiting_for_acknowledge = false;
+    interruptFlagRegister = 0;
+    requestRegister = 0;
+
+    muted = false;
+    mode = 0;
+    set_loc_pending = false;
+    drive_state = cd ? MOTOR_ON : MOTOR_OFF;
+
+    updateStatusRegister();
+}
+
+void CDROM::set_speed_up(uint32_t factor) {
+    speed_up.store(factor);
+}
+
+uint32_t CDROM::get_speed_up() const {
+    return speed_up.load();
+}
+
 CD& CDROM::getCD() {
     return *cd;
 }
 
+bool CDROM::hasCD() const {
+    return cd != nullptr;
+}
+
 void CDROM::catchUpToCPU(uint32_t cycles) {
+    if (cd_audio.is_playing()) {
+        play_cycles_left -= std::min(play_cycles_left, cycles);
+        if (play_cycles_left == 0) {
+            play_cycles_left = CDROM_AUDIO_SECTOR_CYCLES;
+            play_sector();
+        }
+    }
+
     cycles_left -= std::min(cycles_left, cycles);
     if (cycles_left > 0) {
         return;
@@ -149,10 +225,12 @@ void CDROM::deliver_response(ScheduledResponse &response) {
     // Save old drive state for logging purposes
     DriveState old_state = drive_state;
 
-    // Execute response function
+    // Execute response function, 0 means that nothing is reported to the CPU
     uint8_t interrupt = (this->*response.function)();
-    waiting_for_acknowledge = true;
-    notifyAboutINT1to7(interrupt);
+    if (interrupt != 0) {
+        waiting_for_acknowledge = true;
+        notifyAboutINT1to7(interrupt);
+    }
 
     // Executing the response function might have scheduled a new response
     // Or there might be some responses left
@@ -167,7 +245,7 @@ void CDROM::deliver_response(ScheduledResponse &response) {
 
 
 void CDROM::send_command() {
-    if (pending_command && (scheduled_responses.empty() || drive_state == READING)) { // Let Pause() get through
+    if (pending_command && (scheduled_responses.empty() || drive_state == READING || drive_state == PLAYING)) { // Let Pause() get through
         pending_command = false;
 
         LOGV_CDROM(prependState(std::format("Sending command 0x{:02X} to controller", command)));
@@ -285,13 +363,9 @@ void CDROM::write(uint32_t address, uint8_t value) {
                 if (Bit::getBit(value, CDROM_REQUEST_BFRD)) {
                     LOGV_CDROM(prependState(std::format("Serving data queue", value)));
                     if (cd) {
-                        if (!read_sector_buffers.empty()) {
-                            if (current_sector_buffer) {
-                                unused_sector_buffers.emplace_back(std::move(current_sector_buffer));
-                            }
-
-                            current_sector_buffer = std::move(read_sector_buffers.front());
-                            read_sector_buffers.pop_front();
+                        if (!read_sectors.empty()) {
+                            current_sector = read_sectors.front();
+                            read_sectors.pop_front();
 
                             bool large_sector_size = mode & (1U << CDROM_MODE_SECTOR_SIZE);
                             sector_offset = large_sector_size ? CD_MODE2_SYNC_BYTES : CD_MODE2_DATA_OFFSET;
@@ -315,8 +389,11 @@ void CDROM::write(uint32_t address, uint8_t value) {
                 audioVolumeCDOutToSPUIn[1] = value;
                 break;
             case 3: // Audio Volume Apply Changes
-                LOGW_CDROM(std::format("Unimplemented write to Audio Volume Apply Changes: 0x{:02X}", value));
-                // TODO Implement
+                LOGT_CDROM(std::format("0x{:02X} -> Audio Volume Apply Changes", value));
+                if (Bit::getBit(value, CDROM_AUDIO_APPLY_CHANGES)) {
+                    std::copy(std::begin(audioVolumeCDOutToSPUIn), std::end(audioVolumeCDOutToSPUIn), applied_audio_volume);
+                }
+                xa_adpcm_muted = Bit::getBit(value, CDROM_AUDIO_MUTE_XA_ADPCM);
                 break;
             default:
                 assert(false);
@@ -484,21 +561,29 @@ bool CDROM::has_data() {
 }
 
 uint8_t CDROM::read_byte() {
-    return current_sector_buffer[sector_offset++];
+    return current_sector.data[sector_offset++];
 }
 
 uint32_t CDROM::read_word() {
-    uint32_t value = *(reinterpret_cast<const uint32_t*>(&current_sector_buffer[sector_offset]));
+    uint32_t value;
+    std::memcpy(&value, &current_sector.data[sector_offset], sizeof(value));
     sector_offset += 4;
     return value;
 }
 
+std::span<const uint8_t> CDROM::read_data(uint32_t bytes) {
+    uint32_t available = has_data() ? sector_end - sector_offset : 0;
+    std::span<const uint8_t> data = current_sector.data.subspan(sector_offset, std::min(bytes, available));
+    sector_offset += data.size();
+    return data;
+}
+
 const CDROM::Command CDROM::commands[] = {
     // 0x00
     &CDROM::unknown,
     &CDROM::get_stat, // 0x01
     &CDROM::set_loc, // 0x02
-    &CDROM::unknown,
+    &CDROM::play, // 0x03
     &CDROM::unknown, &CDROM::unknown,
     &CDROM::read_n,
     &CDROM::unknown,
@@ -682,6 +767,64 @@ const CDROM::Command CDROM::sub_functions[] = {
     &CDROM::unknown_sf, &CDROM::unknown_sf, &CDROM::unknown_sf, &CDROM::unknown_sf
 };
 
+std::span<const uint8_t> CDROM::read_next_sector() {
+    LOGV_CDROM(prependState(std::format("CD is at {}", cd->get_current_position_on_disc())));
+
+    util::cue::Track::Mode track_mode;
+    std::span<const uint8_t> sector = cd->read_sector_and_advance(track_mode);
+    bool audio_track = track_mode == util::cue::Track::Mode::AUDIO;
+    ++sectors_read;
+    drop_expired_sectors();
+
+    bool xa_adpcm = !audio_track && Bit::getBit(mode, CDROM_MODE_XA_ADPCM)
+        && Bit::getBit(sector[XA_SUBHEADER_SUBMODE], CDROM_SUBMODE_AUDIO);
+    last_sector_is_audio = audio_track || xa_adpcm;
+    last_sector_to_spu = xa_adpcm;
+    last_sector_on_audio_track = audio_track;
+
+    if (xa_adpcm) {
+        play_xa_sector(sector);
+        return sector;
+    }
+
+    if (read_sectors.size() >= CDROM_MAX_READ_SECTORS) {
+        LOGW_CDROM(prependState(std::format("Too many unrequested sectors, dropping oldest!")));
+        read_sectors.pop_front();
+    }
+    read_sectors.push_back({sector, sectors_read});
+
+    return sector;
+}
+
+void CDROM::drop_expired_sectors() {
+    // XA-ADPCM sectors are not queued and the game may take its time draining a sector,
+    // so the queue length alone does not keep the spans within their lifetime
+    while (!read_sectors.empty() && sectors_read - read_sectors.front().number >= CD_SECTOR_SPAN_LIFETIME) {
+        LOGW_CDROM(prependState(std::format("Unrequested sector expired, dropping it!")));
+        read_sectors.pop_front();
+    }
+    if (has_data() && sectors_read - current_sector.number >= CD_SECTOR_SPAN_LIFETIME) {
+        LOGW_CDROM(prependState(std::format("Current sector was not drained in time, dropping the rest!")));
+        current_sector = {};
+        sector_offset = 0;
+        sector_end = 0;
+    }
+}
+
+uint32_t CDROM::drive_cycles(uint32_t cycles, bool real_time) const {
+    uint32_t factor = speed_up.load();
+    if (real_time || factor == 1) {
+        return cycles;
+    }
+
+    if (factor == CDROM_SPEED_UP_INSTANT) {
+        // Responses are only delivered after the previous one has been acknowledged
+        return CDROM_MIN_DRIVE_CYCLES;
+    }
+
+    return std::max<uint32_t>(cycles / factor, CDROM_MIN_DRIVE_CYCLES);
+}
+
 void CDROM::push_drive_state_to_response_queue() {
     response_queue.push(driveStateToStatByte(drive_state));
 }
@@ -692,6 +835,102 @@ uint8_t CDROM::no_disc_response() {
     return 5;
 }
 
+namespace {
+
+uint8_t to_bcd(uint32_t value) {
+    return (value / 10) * 0x10 + (value % 10);
+}
+
+}
+
+void CDROM::play_sector() {
+    if (cd->at_end_of_disc()) {
+        return;
+    }
+
+    // Position of the sector that is played now
+    uint32_t track = cd->get_current_track_number();
+    uint32_t index = cd->get_current_index_number();
+    auto disc_pos = cd->get_current_position_on_disc();
+    auto track_pos = cd->get_current_position_in_track();
+    bool audio_track = cd->get_current_track_mode() == util::cue::Track::Mode::AUDIO;
+
+    // Always hand samples to the SPU so that its output does not stall, silence if there is nothing to play
+    const CDAudio::SectorSamples *samples = cd_audio.read_sector();
+    if (samples) {
+        mix_audio(*samples, !audio_track);
+        cd_audio.pop_sector();
+    } else {
+        play_samples.fill(0);
+        bus->spu.mix_cd_audio(play_samples);
+    }
+
+    // Report every 10 sectors, alternating between absolute and relative position.
+    // Reports are dropped while an interrupt is pending.
+    if (Bit::getBit(mode, CDROM_MODE_REPORT) && disc_pos.sectors % 10 == 0
+        && !waiting_for_acknowledge && scheduled_responses.empty()) {
+        uint16_t peak = 0;
+        for (int16_t sample : play_samples) {
+            peak = std::max<uint16_t>(peak, std::min(std::abs(sample), 0x7FFF));
+        }
+
+        play_report[0] = driveStateToStatByte(drive_state);
+        play_report[1] = to_bcd(track);
+        play_report[2] = to_bcd(index);
+        if ((disc_pos.sectors / 10) % 2 == 0) {
+            play_report[3] = to_bcd(disc_pos.minutes);
+            play_report[4] = to_bcd(disc_pos.seconds);
+            play_report[5] = to_bcd(disc_pos.sectors);
+        } else {
+            play_report[3] = to_bcd(track_pos.minutes);
+            play_report[4] = to_bcd(track_pos.seconds) | 0x80;
+            play_report[5] = to_bcd(track_pos.sectors);
+        }
+        play_report[6] = peak & 0xFF;
+        play_report[7] = peak >> 8;
+        scheduled_responses.emplace_back(&CDROM::play_report_response, 0);
+    }
+
+    cd->skip_sector();
+    bool end_of_disc = cd->at_end_of_disc();
+    bool end_of_track = end_of_disc || cd->get_current_track_number() != track;
+    if (end_of_disc || (end_of_track && Bit::getBit(mode, CDROM_MODE_AUTO_PAUSE))) {
+        LOGV_CDROM(prependState(std::format("End of {:s} while playing", end_of_disc ? "disc" : "track")));
+        stop_playing();
+        drive_state = MOTOR_ON;
+        scheduled_responses.emplace_back(&CDROM::play_end_response, 0);
+    }
+}
+
+void CDROM::stop_playing() {
+    cd_audio.stop();
+}
+
+void CDROM::play_xa_sector(std::span<const uint8_t> sector) {
+    if (Bit::getBit(mode, CDROM_MODE_XA_FILTER)
+        && (sector[XA_SUBHEADER_FILE] != filter_file || sector[XA_SUBHEADER_CHANNEL] != filter_channel)) {
+        LOGT_CDROM(prependState(std::format("Skipping XA-ADPCM sector of file 0x{:02X}, channel 0x{:02X}", sector[XA_SUBHEADER_FILE], sector[XA_SUBHEADER_CHANNEL])));
+        return;
+    }
+
+    LOGT_CDROM(prependState(std::format("Playing XA-ADPCM sector with coding info 0x{:02X}", sector[XA_SUBHEADER_CODING])));
+    mix_audio(xa_decoder.decode_sector(sector.data()), xa_adpcm_muted);
+}
+
+void CDROM::mix_audio(std::span<const int16_t> samples, bool mute) {
+    // In chunks of the size of a CD-DA sector
+    for (size_t offset = 0; offset < samples.size(); offset += play_samples.size()) {
+        size_t count = std::min(play_samples.size(), samples.size() - offset);
+        std::span<int16_t> chunk(play_samples.data(), count);
+        if (mute || muted) {
+            std::fill(chunk.begin(), chunk.end(), 0);
+        } else {
+            CDAudio::apply_volume(&samples[offset], chunk.data(), count / 2, applied_audio_volume);
+        }
+        bus->spu.mix_cd_audio(chunk);
+    }
+}
+
 void CDROM::unknown() {
     throw exceptions::UnknownCDROMCommandError(std::format("Unknown command 0x{:02X}", command));
 }
@@ -748,19 +987,70 @@ uint8_t CDROM::set_loc_response() {
         return no_disc_response();
     }
 
+    // Most likely followed by a read
+    cd->prefetch_bcd(amm, ass, asect);
+    set_loc_pending = true;
+
     response_queue.push(0x02);
     return 3;
 }
 
+void CDROM::play() {
+    LOGV_CDROM(prependState(std::format("========> Play(): Command <========")));
+    scheduled_responses.emplace_back(&CDROM::play_response);
+}
+
+uint8_t CDROM::play_response() {
+    // The track parameter is optional
+    uint8_t track = parameter_queue.is_empty() ? 0 : parameter_queue.pop();
+    LOGV_CDROM(prependState(std::format("========> Play(0x{:02X}): Response <========", track)));
+
+    if (!cd) {
+        return no_disc_response();
+    }
+
+    // Without track, play from the Setloc() position or continue at the current position
+    if (track != 0) {
+        cd->seek_to_track((track >> 4) * 10 + (track & 0xF));
+    } else if (set_loc_pending) {
+        cd->seek_to_bcd(amm, ass, asect);
+    }
+    set_loc_pending = false;
+
+    if (cd->at_end_of_disc()) {
+        LOGW_CDROM(prependState(std::format("Play() at end of disc")));
+    } else {
+        drive_state = PLAYING;
+        play_cycles_left = CDROM_AUDIO_SECTOR_CYCLES;
+        cd_audio.start(*cd, cd->get_current_position_on_disc().total_sectors());
+    }
+
+    push_drive_state_to_response_queue();
+    return 3;
+}
+
+uint8_t CDROM::play_report_response() {
+    LOGV_CDROM(prependState(std::format("========> Play(): Report <========")));
+
+    for (uint8_t byte : play_report) {
+        response_queue.push(byte);
+    }
+    return 1;
+}
+
+uint8_t CDROM::play_end_response() {
+    LOGV_CDROM(prependState(std::format("========> Play(): Data End <========")));
+
+    push_drive_state_to_response_queue();
+    return 4;
+}
+
 void CDROM::read_n() {
     LOGV_CDROM(prependState(std::format("========> ReadN(): Command <========")));
     scheduled_responses.emplace_back(&CDROM::read_n_response);
 
     // Make sure we do not have any already read sectors remaining
-    while (!read_sector_buffers.empty()) {
-        unused_sector_buffers.emplace_back(std::move(read_sector_buffers.back()));
-        read_sector_buffers.pop_back();
-    }
+    read_sectors.clear();
 }
 
 uint8_t CDROM::read_n_response() {
@@ -776,10 +1066,14 @@ uint8_t CDROM::read_n_response() {
 
     // Read does also seek
     // TODO Move this to second response, separate spam response
+    stop_playing();
+    xa_decoder.reset();
     cd->seek_to_bcd(amm, ass, asect);
+    set_loc_pending = false;
+    cd->start_streaming();
 
     // Schedule second response
-    scheduled_responses.emplace_back(&CDROM::read_n_second_response, 0x36CD2);
+    scheduled_responses.emplace_back(&CDROM::read_n_second_response, drive_cycles(CDROM_SECTOR_CYCLES));
 
     return 3;
 }
@@ -787,28 +1081,19 @@ uint8_t CDROM::read_n_response() {
 uint8_t CDROM::read_n_second_response() {
     LOGV_CDROM(prependState(std::format("========> ReadN(): Second Response <========")));
 
-    // Read sector from CD
-    std::unique_ptr<uint8_t[]> buffer;
-    if (!unused_sector_buffers.empty()) {
-        buffer = std::move(unused_sector_buffers.front());
-        unused_sector_buffers.pop_front();
-
-    } else {
-        LOGW_CDROM(prependState(std::format("No unused sector buffer for read, allocating new buffer!")));
-        buffer = std::make_unique<uint8_t[]>(CD::SECTOR_SIZE);
-    }
-
-    LOGV_CDROM(prependState(std::format("CD is at {}", cd->get_current_position_on_disc())));
-    cd->read_sector_and_advance(buffer.get());
-    read_sector_buffers.emplace_back(std::move(buffer));
-
-    push_drive_state_to_response_queue();
+    read_next_sector();
 
     // Schedule reading of next sector (since we are automatically reading that)
     // Software has to be fast enough to keep up!
     // That is, the next_sector_buffer has to be read or we will overwrite it.
-    scheduled_responses.emplace_back(&CDROM::read_n_second_response, 0x36CD2);
+    scheduled_responses.emplace_back(&CDROM::read_n_second_response, drive_cycles(CDROM_SECTOR_CYCLES, last_sector_is_audio));
 
+    // XA-ADPCM sectors are not reported
+    if (last_sector_to_spu) {
+        return 0;
+    }
+
+    push_drive_state_to_response_queue();
     return 1;
 }
 
@@ -824,6 +1109,9 @@ uint8_t CDROM::stop_response() {
         return no_disc_response();
     }
 
+    stop_playing();
+    cd->stop_streaming();
+
     // Schedule second response
     scheduled_responses.emplace_back(&CDROM::stop_second_response);
 
@@ -853,8 +1141,11 @@ uint8_t CDROM::pause_response() {
         return no_disc_response();
     }
 
+    stop_playing();
+    cd->stop_streaming();
+
     // Schedule second response
-    scheduled_responses.emplace_back(&CDROM::pause_second_response, 0x10BD93);
+    scheduled_responses.emplace_back(&CDROM::pause_second_response, drive_cycles(CDROM_PAUSE_CYCLES));
 
     push_drive_state_to_response_queue(); // Respond with current state
     return 3;
@@ -877,6 +1168,10 @@ uint8_t CDROM::init_response() {
     LOGV_CDROM(prependState(std::format("========> Init(): Initial Response <========")));
 
     // TODO set mode to 0x20
+    stop_playing();
+    if (cd) {
+        cd->stop_streaming();
+    }
     scheduled_responses.emplace_back(&CDROM::init_second_response);
 
     push_drive_state_to_response_queue(); // Current/old state
@@ -899,8 +1194,7 @@ void CDROM::mute() {
 uint8_t CDROM::mute_response() {
     LOGV_CDROM(prependState(std::format("========> Mute(): Response <========")));
 
-    // TODO Do something?
-    LOGW_CDROM(prependState(std::format("Mute() not implemented!")));
+    muted = true;
 
     push_drive_state_to_response_queue();
     return 3;
@@ -914,8 +1208,7 @@ void CDROM::demute() {
 uint8_t CDROM::demute_response() {
     LOGV_CDROM(prependState(std::format("========> Demute(): Response <========")));
 
-    // TODO Do something?
-    LOGW_CDROM(prependState(std::format("Demute() not implemented!")));
+    muted = false;
 
     push_drive_state_to_response_queue();
     return 3;
@@ -931,8 +1224,8 @@ uint8_t CDROM::set_filter_response() {
     uint8_t channel = parameter_queue.pop();
     LOGV_CDROM(prependState(std::format("========> SetFilter(0x{:02X}, 0x{:02X}): Response <========", file, channel)));
 
-    // TODO Implement
-    LOGW_CDROM(prependState(std::format("SetFilter() not implemented!")));
+    filter_file = file;
+    filter_channel = channel;
 
     push_drive_state_to_response_queue();
     return 3;
@@ -1054,6 +1347,7 @@ uint8_t CDROM::seek_l_response() {
         return no_disc_response();
     }
 
+    stop_playing();
     scheduled_responses.emplace_back(&CDROM::seek_l_second_response);
 
     drive_state = SEEKING;
@@ -1065,6 +1359,7 @@ uint8_t CDROM::seek_l_second_response() {
     LOGV_CDROM(prependState(std::format("========> SeekL(): Second Response <========")));
 
     cd->seek_to_bcd(amm, ass, asect);
+    set_loc_pending = false;
 
     drive_state = MOTOR_ON;
     push_drive_state_to_response_queue();
@@ -1083,6 +1378,7 @@ uint8_t CDROM::seek_p_response() {
         return no_disc_response();
     }
 
+    stop_playing();
     scheduled_responses.emplace_back(&CDROM::seek_p_second_response);
 
     drive_state = SEEKING;
@@ -1094,6 +1390,7 @@ uint8_t CDROM::seek_p_second_response() {
     LOGV_CDROM(prependState(std::format("========> SeekP(): Second Response <========")));
 
     cd->seek_to_bcd(amm, ass, asect);
+    set_loc_pending = false;
 
     drive_state = MOTOR_ON;
     push_drive_state_to_response_queue();
@@ -1171,10 +1468,7 @@ void CDROM::read_s() {
     scheduled_responses.emplace_back(&CDROM::read_s_response);
 
     // Make sure we do not have any already read sectors remaining
-    while (!read_sector_buffers.empty()) {
-        unused_sector_buffers.emplace_back(std::move(read_sector_buffers.back()));
-        read_sector_buffers.pop_back();
-    }
+    read_sectors.clear();
 }
 
 uint8_t CDROM::read_s_response() {
@@ -1190,10 +1484,14 @@ uint8_t CDROM::read_s_response() {
 
     // Read does also seek
     // TODO Move this to second response, separate spam response
+    stop_playing();
+    xa_decoder.reset();
     cd->seek_to_bcd(amm, ass, asect);
+    set_loc_pending = false;
+    cd->start_streaming();
 
     // Schedule second response
-    scheduled_responses.emplace_back(&CDROM::read_s_second_response, 0x36CD2);
+    scheduled_responses.emplace_back(&CDROM::read_s_second_response, drive_cycles(CDROM_SECTOR_CYCLES));
 
     return 3;
 }
@@ -1201,42 +1499,33 @@ uint8_t CDROM::read_s_response() {
 uint8_t CDROM::read_s_second_response() {
     LOGV_CDROM(prependState(std::format("========> ReadS(): Second Response <========")));
 
-    // Read sector from CD
-    std::unique_ptr<uint8_t[]> buffer;
-    if (!unused_sector_buffers.empty()) {
-        buffer = std::move(unused_sector_buffers.front());
-        unused_sector_buffers.pop_front();
-
-    } else {
-        LOGW_CDROM(prependState(std::format("No unused sector buffer for read, allocating new buffer!")));
-        buffer = std::make_unique<uint8_t[]>(CD::SECTOR_SIZE);
-    }
-
-    LOGV_CDROM(prependState(std::format("CD is at {}", cd->get_current_position_on_disc())));
-    last_sector_header.was_data = cd->get_current_track_mode() != util::cue::Track::Mode::AUDIO;
-    cd->read_sector_and_advance(buffer.get());
+    std::span<const uint8_t> sector = read_next_sector();
+    last_sector_header.was_data = !last_sector_on_audio_track;
     if (last_sector_header.was_data) {
-        last_sector_header.header[0] = buffer[0x00C];
-        last_sector_header.header[1] = buffer[0x00D];
-        last_sector_header.header[2] = buffer[0x00E];
-        last_sector_header.header[3] = buffer[0x00F];
-        last_sector_header.sub_header[0] = buffer[0x010];
-        last_sector_header.sub_header[1] = buffer[0x011];
-        last_sector_header.sub_header[2] = buffer[0x012];
-        last_sector_header.sub_header[3] = buffer[0x013];
+        last_sector_header.header[0] = sector[0x00C];
+        last_sector_header.header[1] = sector[0x00D];
+        last_sector_header.header[2] = sector[0x00E];
+        last_sector_header.header[3] = sector[0x00F];
+        last_sector_header.sub_header[0] = sector[0x010];
+        last_sector_header.sub_header[1] = sector[0x011];
+        last_sector_header.sub_header[2] = sector[0x012];
+        last_sector_header.sub_header[3] = sector[0x013];
         LOGV_CDROM(prependState(std::format("Extracted (sub-)header: 0x{:02X}, 0x{:02X}, 0x{:02X}, 0x{:02X}, 0x{:02X}, 0x{:02X}, 0x{:02X}, 0x{:02X}",
                         last_sector_header.header[0], last_sector_header.header[1], last_sector_header.header[2], last_sector_header.header[3],
                         last_sector_header.sub_header[0], last_sector_header.sub_header[1], last_sector_header.sub_header[2], last_sector_header.sub_header[3])));
     }
-    read_sector_buffers.emplace_back(std::move(buffer));
-
-    push_drive_state_to_response_queue();
 
     // Schedule reading of next sector (since we are automatically reading that)
     // Software has to be fast enough to keep up!
     // That is, the next_sector_buffer has to be read or we will overwrite it.
-    scheduled_responses.emplace_back(&CDROM::read_s_second_response, 0x36CD2);
+    scheduled_responses.emplace_back(&CDROM::read_s_second_response, drive_cycles(CDROM_SECTOR_CYCLES, last_sector_is_audio));
+
+    // XA-ADPCM sectors are not reported
+    if (last_sector_to_spu) {
+        return 0;
+    }
 
+    push_drive_state_to_response_queue();
     return 1;
 }
 
@@ -1249,7 +1538,7 @@ uint8_t CDROM::read_toc_response() {
     LOGV_CDROM(prependState(std::format("========> ReadTOC(): Initial Response <========")));
     // INT3 with status first, then INT2 with status
 
-    scheduled_responses.emplace_back(&CDROM::read_toc_second_response, 0x1F78A40);
+    scheduled_responses.emplace_back(&CDROM::read_toc_second_response, drive_cycles(CDROM_READ_TOC_CYCLES));
     push_drive_state_to_response_queue();
     return 3;
 }
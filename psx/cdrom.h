@@ -1,13 +1,17 @@
 #ifndef PSX_CDROM_H
 #define PSX_CDROM_H
 
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <deque>
 #include <memory>
 #include <ostream>
 #include <span>
 
+#include "cdaudio.h"
 #include "util/queue.h"
+#include "xaadpcm.h"
 
 namespace PSX {
 
@@ -50,7 +54,33 @@ namespace PSX {
 #define CDROM_REQUEST_BFWR 6 // Unknown
 #define CDROM_REQUEST_SMEN 5 // Start interrupt (INT10) on next command
 
+#define CDROM_MODE_XA_ADPCM 6 // XA-ADPCM (0 = off, 1 = send XA-ADPCM sectors to SPU audio input)
 #define CDROM_MODE_SECTOR_SIZE 5 // Sector Size (0 = 0x800, data only, 1 = 0x924, whole sector except sync bytes)
+#define CDROM_MODE_XA_FILTER 3 // XA-Filter (0 = off, 1 = only play XA-ADPCM sectors matching Setfilter())
+#define CDROM_MODE_REPORT 2 // Report (0 = off, 1 = INT1 with the position every 10 sectors while playing CD-DA)
+#define CDROM_MODE_AUTO_PAUSE 1 // AutoPause (0 = off, 1 = pause with INT4 at the end of a track while playing CD-DA)
+
+// 0x1F801803, index 3 write - Audio Volume Apply Changes
+#define CDROM_AUDIO_APPLY_CHANGES 5 // Apply the CD-out to SPU-in volumes written before
+#define CDROM_AUDIO_MUTE_XA_ADPCM 0 // 0 = off, 1 = mute XA-ADPCM
+
+// Sub-mode byte of the sub-header of mode 2 sectors
+#define CDROM_SUBMODE_AUDIO 2 // XA-ADPCM sector
+
+// Timing of the drive mechanics in CPU cycles at normal speed
+#define CDROM_SECTOR_CYCLES 0x36CD2 // Between two sectors while reading, also seek time until the first sector
+#define CDROM_PAUSE_CYCLES 0x10BD93
+#define CDROM_READ_TOC_CYCLES 0x1F78A40
+// CD-DA is always played back at normal speed, 75 sectors (44100 frames) per second
+#define CDROM_AUDIO_SECTOR_CYCLES 0x6E400
+// Sped-up drive timings do not go below this
+#define CDROM_MIN_DRIVE_CYCLES 0x800
+// Speed-up factor that delivers data sectors as soon as the previous INT1 has been acknowledged
+#define CDROM_SPEED_UP_INSTANT 0
+
+// Read sectors that have not been requested yet are dropped beyond this
+// (together with the sector being transferred, they have to fit into CD_SECTOR_SPAN_LIFETIME)
+#define CDROM_MAX_READ_SECTORS 8
 
 class Bus;
 class CD;
@@ -61,6 +91,10 @@ private:
 
     uint8_t statusRegister;
     uint8_t audioVolumeCDOutToSPUIn[4]; // Left -> Left, Left -> Right, Right -> Left, Right -> Right
+    uint8_t applied_audio_volume[4]; // Takes effect on Audio Volume Apply Changes
+    // Mute() and Demute()
+    bool muted;
+    bool xa_adpcm_muted;
     uint8_t interruptEnableRegister;
     uint8_t interruptFlagRegister;
     uint8_t requestRegister;
@@ -88,11 +122,41 @@ private:
 
     std::unique_ptr<CD> cd;
 
+    // CD-DA playback (Play), declared after the CD since its worker thread reads from it
+    CDAudio cd_audio;
+    // Number of cycles until the next sector is played
+    uint32_t play_cycles_left;
+    // Samples of the current sector after applying the volume
+    CDAudio::SectorSamples play_samples;
+    // Response bytes of the last report
+    std::array<uint8_t, 8> play_report;
+
+    // A sector that points directly into the disc image, number is the value of sectors_read after reading it
+    struct ReadSector {
+        std::span<const uint8_t> data;
+        uint32_t number;
+    };
     // The current sector being served
-    std::unique_ptr<uint8_t[]> current_sector_buffer;
-    // Buffers that already have been read
-    std::deque<std::unique_ptr<uint8_t[]>> read_sector_buffers;
-    std::deque<std::unique_ptr<uint8_t[]>> unused_sector_buffers;
+    ReadSector current_sector;
+    // Sectors that already have been read
+    std::deque<ReadSector> read_sectors;
+    // Sectors read from the disc (including XA-ADPCM ones), spans expire CD_SECTOR_SPAN_LIFETIME sectors later
+    uint32_t sectors_read;
+    // Audio (CD-DA or XA-ADPCM played back) has to be read at real speed
+    bool last_sector_is_audio;
+    // The last sector was XA-ADPCM sent to the SPU instead of the data queue
+    bool last_sector_to_spu;
+    // The last sector was read from a CD-DA track
+    bool last_sector_on_audio_track;
+
+    // XA-ADPCM playback while reading
+    XADecoder xa_decoder;
+    // Setfilter()
+    uint8_t filter_file;
+    uint8_t filter_channel;
+
+    // Divides the time of the drive mechanics for faster loading
+    std::atomic<uint32_t> speed_up;
 
     // Header of last sector that was read
     struct LastSectorHeader {
@@ -116,6 +180,8 @@ private:
     uint8_t amm;
     uint8_t ass;
     uint8_t asect;
+    // Setloc() has not been followed by a command that seeks yet
+    bool set_loc_pending;
 
     uint8_t mode;
     uint32_t sector_offset;
@@ -148,7 +214,13 @@ public:
     ~CDROM();
     void reset();
     void setCD(std::unique_ptr<CD> cd);
+    // State the BIOS leaves the controller in after loading the boot executable (for fast boot)
+    void set_booted_state();
+    // 1 for normal speed, CDROM_SPEED_UP_INSTANT to read data as fast as the software takes it
+    void set_speed_up(uint32_t factor);
+    uint32_t get_speed_up() const;
     CD& getCD();
+    bool hasCD() const;
     void catchUpToCPU(uint32_t cycles);
 
     void deliver_response(ScheduledResponse &response);
@@ -168,14 +240,29 @@ public:
     bool has_data();
     uint8_t read_byte();
     uint32_t read_word();
+    // Up to bytes bytes of the data queue, fewer if the sector ends earlier
+    std::span<const uint8_t> read_data(uint32_t bytes);
 
 private:
     // Command table and implementations
     typedef void (CDROM::*Command) ();
 
     void push_drive_state_to_response_queue();
+    // Reads the next sector from the CD and queues it for the data queue
+    std::span<const uint8_t> read_next_sector();
+    // Drops the sectors whose spans are about to become invalid, called for every sector read
+    void drop_expired_sectors();
+    // Time the drive mechanics take for something that takes cycles at normal speed
+    uint32_t drive_cycles(uint32_t cycles, bool real_time = false) const;
     // Generic response when no disc is inserted
     uint8_t no_disc_response();
+    // Plays back one CD-DA sector, called every CDROM_AUDIO_SECTOR_CYCLES while playing
+    void play_sector();
+    void stop_playing();
+    // Decodes an XA-ADPCM sector and sends it to the SPU (if it passes the filter)
+    void play_xa_sector(std::span<const uint8_t> sector);
+    // Hands the samples to the SPU after applying the CD-out to SPU-in volume
+    void mix_audio(std::span<const int16_t> samples, bool mute);
 
     static const Command commands[];
     void unknown();
@@ -185,6 +272,11 @@ private:
     // 0x02
     void set_loc();
     uint8_t set_loc_response();
+    // 0x03
+    void play();
+    uint8_t play_response();
+    uint8_t play_report_response();
+    uint8_t play_end_response();
     // 0x06
     void read_n();
     uint8_t read_n_response();
@@ -1,5 +1,6 @@
 #include "core.h"
 
+#include <chrono>
 #include <format>
 #include <iostream>
 
@@ -17,6 +18,8 @@ void Core::setRenderer(Renderer *renderer) {
 
 void Core::reset() {
     bus.reset();
+    frameSkipper.reset();
+    framePacer.reset();
 }
 
 void Core::emulateStep() {
@@ -30,6 +33,7 @@ void Core::emulateStep() {
     bus.timers.catchUpToCPU(cyclesTaken);
     bus.gio.catchUpToCPU(cyclesTaken);
     bus.cdrom.catchUpToCPU(cyclesTaken);
+    bus.spu.catchUpToCPU(cyclesTaken);
 }
 
 void Core::emulateBlock() {
@@ -45,18 +49,47 @@ void Core::emulateBlock() {
     bus.timers.catchUpToCPU(cyclesTaken);
     bus.gio.catchUpToCPU(cyclesTaken);
     bus.cdrom.catchUpToCPU(cyclesTaken);
+    bus.spu.catchUpToCPU(cyclesTaken);
 }
 
 void Core::emulateUntilVBLANK() {
+    std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+
+    frameSkipper.beginFrame();
+    bus.gpu.setFrameSkipping(!frameSkipper.presentFrame(), !frameSkipper.rasterizeFrame());
+
     do {
         emulateBlock();
     } while (!bus.gpu.vBlankOccurred());
+
+    frameSkipper.endFrame(std::chrono::steady_clock::now() - frameStart);
+
+    // Fast-forward is uncapped
+    double frameRate = FramePacer::frameRateOfVideoMode(bus.gpu.videoModeIsPAL());
+    if (!frameSkipper.fastForwardEnabled()) {
+        framePacer.throttle(frameRate, bus.spu);
+    }
+    framePacer.recordFrame(frameRate);
+
+#ifdef GTE_PROFILE
+    bus.cpu.gte.end_profile_frame();
+#endif
 }
 
 void Core::run() {
     try {
+#ifdef GTE_PROFILE
+        uint32_t frames = 0;
+#endif
         while (true) {
             emulateUntilVBLANK();
+
+#ifdef GTE_PROFILE
+            // Geometry load of one frame about every second
+            if (++frames % 60 == 0) {
+                std::cout << std::format("Frame {:d}: ", frames) << bus.cpu.gte.get_profile().report();
+            }
+#endif
         }
 
     } catch (const std::runtime_error &e) {
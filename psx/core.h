@@ -2,6 +2,8 @@
 #define PSX_CORE_H
 
 #include "bus.h"
+#include "frameskip.h"
+#include "pacer.h"
 
 namespace PSX {
 
@@ -10,6 +12,8 @@ class Renderer;
 class Core {
 public:
     Bus bus;
+    FrameSkipper frameSkipper;
+    FramePacer framePacer;
 
 public:
     Core();
@@ -63,6 +63,9 @@ void CPU::step() {
     if ((instructionPC & 0x1FFFFFFF) == 0x00030000 && bus->executable.loaded()) {
         LOG_EXE("Sideloading executable");
         bus->executable.writeToMemory();
+        if (bus->executable.loadedFromDisc()) {
+            bus->cdrom.set_booted_state();
+        }
     }
 
     // execute instruction
@@ -740,9 +740,19 @@ void DMA::transferFromCDROM() {
                                 numberOfBlocks));
         }
 
+        // Read straight from the sector in the disc image
+        std::span<const uint8_t> data = bus->cdrom.read_data(numberOfWords * 4);
+        if (data.size() < numberOfWords * 4) {
+            LOGW_DMA(std::format("Channel 3 (CDROM) transfer: only {:d} of {:d} bytes in data queue",
+                                 data.size(), numberOfWords * 4));
+        }
+
         uint32_t previousAddress = address; // to update base address register
         for (uint32_t i = 0; i < numberOfWords; ++i) {
-            uint32_t word = bus->cdrom.read_word();
+            uint32_t word = 0;
+            if (4 * i + 4 <= data.size()) {
+                std::memcpy(&word, &data[4 * i], sizeof(word));
+            }
             LOGT_DMA(std::format("Channel 3 (CDROM) transfer: reading 0x{:08X}", word));
 
             bus->write<uint32_t>(address, word);
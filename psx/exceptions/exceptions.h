@@ -37,6 +37,14 @@ public:
         : std::runtime_error(what) {}
 };
 
+class FileWriteError : public std::runtime_error {
+public:
+    explicit FileWriteError(const std::string &what)
+        : std::runtime_error(what) {}
+    explicit FileWriteError(const char *what)
+        : std::runtime_error(what) {}
+};
+
 class UnknownOpcodeError : public std::runtime_error {
 public:
     explicit UnknownOpcodeError(const std::string &what)
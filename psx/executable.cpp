@@ -7,12 +7,56 @@
 #include <sstream>
 
 #include "bus.h"
+#include "cd.h"
+#include "iso9660.h"
 #include "util/log.h"
 #include "exceptions/exceptions.h"
 
 using namespace util;
 
 namespace PSX {
+SystemConfig::SystemConfig()
+    : boot(EXECUTABLE_DEFAULT_BOOT),
+      tcb(EXECUTABLE_DEFAULT_TCB),
+      event(EXECUTABLE_DEFAULT_EVENT),
+      stack(EXECUTABLE_DEFAULT_STACK) {
+}
+
+void SystemConfig::parse(const std::string &text) {
+    // Lines of "KEY = VALUE", numbers are hexadecimal
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        std::string::size_type equals = line.find('=');
+        if (equals == std::string::npos) {
+            continue;
+        }
+
+        std::string key, value;
+        std::istringstream(line.substr(0, equals)) >> key;
+        std::istringstream(line.substr(equals + 1)) >> value;
+        if (value.empty()) {
+            continue;
+        }
+
+        try {
+            if (key == "BOOT") {
+                boot = value;
+            } else if (key == "TCB") {
+                tcb = std::stoul(value, nullptr, 16);
+            } else if (key == "EVENT") {
+                event = std::stoul(value, nullptr, 16);
+            } else if (key == "STACK") {
+                stack = std::stoul(value, nullptr, 16);
+            } else {
+                LOGW_EXE(std::format("Unknown SYSTEM.CNF entry \"{:s}\"", key));
+            }
+        } catch (const std::logic_error&) {
+            LOGW_EXE(std::format("Invalid SYSTEM.CNF value \"{:s}\" of {:s}", value, key));
+        }
+    }
+}
+
 Executable::Executable(Bus *bus) {
     this->bus = bus;
 
@@ -32,6 +76,7 @@ void Executable::reset() {
     }
     exe = nullptr;
     exeLength = 0;
+    fromDisc = false;
 }
 
 void Executable::readFromFile(const std::string &file) {
@@ -56,10 +101,54 @@ void Executable::readFromFile(const std::string &file) {
     parseHeader();
 }
 
+void Executable::readFromDisc(const CD &cd) {
+    reset();
+
+    ISO9660 fileSystem(cd);
+    ISO9660::Extent extent;
+
+    systemConfig = SystemConfig();
+    if (fileSystem.open("SYSTEM.CNF", extent) && !extent.directory) {
+        std::vector<uint8_t> text = fileSystem.read(extent);
+        systemConfig.parse(std::string(text.begin(), text.end()));
+    } else {
+        LOG_EXE("No SYSTEM.CNF on disc");
+    }
+    LOG_EXE(std::format("Booting \"{:s}\" from disc \"{:s}\" (TCB {:d}, EVENT {:d}, STACK 0x{:08X})",
+                        systemConfig.boot, fileSystem.get_volume_id(), systemConfig.tcb, systemConfig.event, systemConfig.stack));
+    if (systemConfig.tcb != EXECUTABLE_DEFAULT_TCB || systemConfig.event != EXECUTABLE_DEFAULT_EVENT) {
+        LOGW_EXE("The kernel keeps its default number of TCBs and events");
+    }
+
+    if (!fileSystem.open(systemConfig.boot, extent) || extent.directory) {
+        throw exceptions::FileReadError("Boot executable \"" + systemConfig.boot + "\" not found on disc");
+    }
+    std::vector<uint8_t> data = fileSystem.read(extent);
+    if (data.size() < 0x800 || std::memcmp(data.data(), "PS-X EXE", 8) != 0) {
+        throw exceptions::FileReadError("\"" + systemConfig.boot + "\" is not a PS-X executable");
+    }
+
+    exeLength = data.size();
+    exe = new uint8_t[exeLength];
+    std::memcpy(exe, data.data(), exeLength);
+    fromDisc = true;
+
+    parseHeader();
+    // writeToMemory() copies fileSize bytes after the header
+    if (header.fileSize > exeLength - 0x800) {
+        reset();
+        throw exceptions::FileReadError("\"" + systemConfig.boot + "\" is truncated");
+    }
+}
+
 bool Executable::loaded() {
     return exeLength > 0;
 }
 
+bool Executable::loadedFromDisc() const {
+    return fromDisc;
+}
+
 void Executable::parseHeader() {
     std::memcpy(header.asciiID, exe, 8);
     header.asciiID[8] = '\0';
@@ -98,8 +187,8 @@ void Executable::parseHeader() {
 
 void Executable::writeToMemory() {
     // Copy to RAM
-    assert(header.fileSize <= exeLength + 0x800);
-    for (uint32_t i = 0; i <= header.fileSize; ++i) {
+    assert(header.fileSize + 0x800 <= exeLength);
+    for (uint32_t i = 0; i < header.fileSize; ++i) {
         bus->write<uint8_t>(header.destination + i, exe[0x800 + i]);
     }
 
@@ -111,10 +200,13 @@ void Executable::writeToMemory() {
     if (header.initialR2930Base != 0) {
         bus->cpu.regs.setRegister(29, header.initialR2930Base + header.initialR2930Offset);
         bus->cpu.regs.setRegister(30, header.initialR2930Base + header.initialR2930Offset);
+    } else if (fromDisc) {
+        bus->cpu.regs.setRegister(29, systemConfig.stack);
+        bus->cpu.regs.setRegister(30, systemConfig.stack);
     }
 
     // Memfill
-    for (uint32_t i = 0; i <= header.memfillSize; ++i) {
+    for (uint32_t i = 0; i < header.memfillSize; ++i) {
         bus->write<uint8_t>(header.memfillStart + i, 0);
     }
 }
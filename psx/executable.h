@@ -7,6 +7,13 @@
 namespace PSX {
 
 class Bus;
+class CD;
+
+// What the BIOS uses if SYSTEM.CNF is missing or lacks an entry
+#define EXECUTABLE_DEFAULT_BOOT "cdrom:\\PSX.EXE;1"
+#define EXECUTABLE_DEFAULT_TCB 4
+#define EXECUTABLE_DEFAULT_EVENT 16
+#define EXECUTABLE_DEFAULT_STACK 0x801FFF00
 
 struct ExecutableHeader {
     char asciiID[9];
@@ -21,6 +28,17 @@ struct ExecutableHeader {
     std::string asciiMarker;
 };
 
+// Boot configuration of a disc (SYSTEM.CNF), defaults are used for missing entries
+struct SystemConfig {
+    std::string boot;
+    uint32_t tcb;
+    uint32_t event;
+    uint32_t stack;
+
+    SystemConfig();
+    void parse(const std::string &text);
+};
+
 class Executable {
 private:
     Bus *bus;
@@ -28,6 +46,9 @@ private:
     uint8_t* exe;
     uint32_t exeLength;
     ExecutableHeader header;
+    // Loaded from a disc, the stack of SYSTEM.CNF applies
+    bool fromDisc;
+    SystemConfig systemConfig;
 
 public:
     Executable(Bus *bus);
@@ -35,7 +56,11 @@ public:
     void reset();
 
     void readFromFile(const std::string &file);
+    // Fast boot: loads the executable SYSTEM.CNF boots (or PSX.EXE) from the disc,
+    // throws exceptions::FileReadError if the disc cannot be booted
+    void readFromDisc(const CD &cd);
     bool loaded();
+    bool loadedFromDisc() const;
     void parseHeader();
     void writeToMemory();
 };
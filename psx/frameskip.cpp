@@ -0,0 +1,123 @@
+#include "frameskip.h"
+
+#include <format>
+
+#include "util/log.h"
+
+using namespace util;
+
+namespace PSX {
+
+FrameSkipper::FrameSkipper()
+    : fast_forward(false),
+      skip_rasterization(false) {
+    reset();
+}
+
+void FrameSkipper::reset() {
+    skip_count = 0;
+    frame_in_cycle = 0;
+    presentation_accumulator = 0;
+    current_frame_presented = true;
+    next_frame_presented = true;
+
+    presented_frame_time = 1.0 / FRAME_SKIP_PRESENTATION_RATE;
+    skipped_frame_time = 0.0; // Unknown until the first frame has been skipped
+}
+
+void FrameSkipper::setFastForward(bool enabled) {
+    fast_forward.store(enabled);
+}
+
+bool FrameSkipper::fastForwardEnabled() const {
+    return fast_forward.load();
+}
+
+void FrameSkipper::setSkipRasterization(bool enabled) {
+    skip_rasterization.store(enabled);
+}
+
+bool FrameSkipper::skipRasterizationEnabled() const {
+    return skip_rasterization.load();
+}
+
+void FrameSkipper::beginFrame() {
+    current_frame_presented = next_frame_presented;
+
+    if (!fast_forward.load()) {
+        frame_in_cycle = 0;
+        presentation_accumulator = 0;
+        current_frame_presented = true;
+        next_frame_presented = true;
+        return;
+    }
+
+    // Present FRAME_SKIP_CYCLE - skip_count frames per cycle, spread evenly
+    presentation_accumulator += FRAME_SKIP_CYCLE - skip_count;
+    next_frame_presented = presentation_accumulator >= FRAME_SKIP_CYCLE;
+    if (next_frame_presented) {
+        presentation_accumulator -= FRAME_SKIP_CYCLE;
+    }
+}
+
+bool FrameSkipper::presentFrame() const {
+    return current_frame_presented;
+}
+
+bool FrameSkipper::rasterizeFrame() const {
+    // Games draw into the back buffer during the frame before it is displayed,
+    // so we also rasterize the frame preceding a presented one
+    return !skip_rasterization.load() || current_frame_presented || next_frame_presented;
+}
+
+void FrameSkipper::endFrame(std::chrono::steady_clock::duration hostTime) {
+    double seconds = std::chrono::duration<double>(hostTime).count();
+
+    if (current_frame_presented) {
+        presented_frame_time = 0.9 * presented_frame_time + 0.1 * seconds;
+    } else if (skipped_frame_time == 0.0) {
+        skipped_frame_time = seconds;
+    } else {
+        skipped_frame_time = 0.9 * skipped_frame_time + 0.1 * seconds;
+    }
+
+    if (!fast_forward.load()) {
+        return;
+    }
+
+    ++frame_in_cycle;
+    if (frame_in_cycle == FRAME_SKIP_CYCLE) {
+        frame_in_cycle = 0;
+
+        uint32_t new_skip_count = choose_skip_count();
+        if (new_skip_count != skip_count) {
+            LOGV_MISC(std::format("Frame skip: skipping {:d} out of {:d} frames (presented {:.2f} ms, skipped {:.2f} ms)",
+                                  new_skip_count, FRAME_SKIP_CYCLE,
+                                  presented_frame_time * 1000.0, skipped_frame_time * 1000.0));
+            skip_count = new_skip_count;
+        }
+    }
+}
+
+uint32_t FrameSkipper::getSkipCount() const {
+    return skip_count;
+}
+
+uint32_t FrameSkipper::choose_skip_count() const {
+    double skipped_time = skipped_frame_time != 0.0 ? skipped_frame_time : presented_frame_time;
+
+    // Skip as few frames as possible while presenting at most
+    // FRAME_SKIP_PRESENTATION_RATE frames per second of host time
+    for (uint32_t skipped = 0; skipped < FRAME_SKIP_CYCLE - 1; ++skipped) {
+        double presented = FRAME_SKIP_CYCLE - skipped;
+        double cycle_time = presented * presented_frame_time + skipped * skipped_time;
+
+        if (presented <= FRAME_SKIP_PRESENTATION_RATE * cycle_time) {
+            return skipped;
+        }
+    }
+
+    return FRAME_SKIP_CYCLE - 1;
+}
+
+}
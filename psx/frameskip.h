@@ -0,0 +1,57 @@
+#ifndef PSX_FRAMESKIP_H
+#define PSX_FRAMESKIP_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace PSX {
+
+// Frames are skipped in cycles of FRAME_SKIP_CYCLE frames, i.e.,
+// at most FRAME_SKIP_CYCLE - 1 out of FRAME_SKIP_CYCLE frames are skipped
+#define FRAME_SKIP_CYCLE 10
+// Number of frames per second we aim to present while fast-forwarding
+#define FRAME_SKIP_PRESENTATION_RATE 60.0
+
+class FrameSkipper {
+private:
+    std::atomic<bool> fast_forward;
+    std::atomic<bool> skip_rasterization;
+
+    // Number of frames that are skipped per cycle of FRAME_SKIP_CYCLE frames
+    uint32_t skip_count;
+    uint32_t frame_in_cycle;
+    // Accumulates presented frames to spread them evenly across a cycle
+    uint32_t presentation_accumulator;
+    bool current_frame_presented;
+    bool next_frame_presented;
+
+    // Exponential moving averages of the host time spent on a frame (in seconds)
+    double presented_frame_time;
+    double skipped_frame_time;
+
+public:
+    FrameSkipper();
+    void reset();
+
+    void setFastForward(bool enabled);
+    bool fastForwardEnabled() const;
+    void setSkipRasterization(bool enabled);
+    bool skipRasterizationEnabled() const;
+
+    // Decide whether the frame that is about to be emulated is shown
+    void beginFrame();
+    bool presentFrame() const;
+    bool rasterizeFrame() const;
+    // Feed back how long the host took to emulate the frame
+    void endFrame(std::chrono::steady_clock::duration hostTime);
+
+    uint32_t getSkipCount() const;
+
+private:
+    uint32_t choose_skip_count() const;
+};
+
+}
+
+#endif
@@ -108,6 +108,7 @@ void GPU::reset() {
     currentScanlineCycles = 0;
     frame_count = 0;
     verticalBlankOccurred = false;
+    skip_presentation = false;
 
     gp0 = 0;
     queue.clear();
@@ -143,6 +144,15 @@ bool GPU::vBlankOccurred() {
     return occurred;
 }
 
+void GPU::setFrameSkipping(bool skipPresentation, bool skipRasterization) {
+    skip_presentation = skipPresentation;
+    renderer->set_rasterization_enabled(!skipRasterization);
+}
+
+bool GPU::videoModeIsPAL() const {
+    return Bit::getBit(gpuStatusRegister, GPUSTAT_VIDEO_MODE);
+}
+
 void GPU::catchUpToCPU(uint32_t cpuCycles) {
     updateTimers(cpuCycles);
 
@@ -252,7 +262,9 @@ void GPU::updateTimers(uint32_t cpuCycles) {
 
                     // Swap buffers
                     LOGT_GPU(std::format("VBlank"));
-                    renderer->swapBuffers();
+                    if (!skip_presentation) {
+                        renderer->swapBuffers();
+                    }
 
                     // Issue VBlank interrupt
                     bus->interrupts.notifyAboutVBLANK();
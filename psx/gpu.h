@@ -110,6 +110,8 @@ private:
     uint32_t currentScanlineCycles;
     uint32_t frame_count;
     bool verticalBlankOccurred;
+    // Do not present the current frame on VBlank (fast-forward)
+    bool skip_presentation;
 
     // 1F801810
     // Write GP0     Send GP0 Commands/Packets (Rendering and VRAM Access)
@@ -180,6 +182,8 @@ public:
     void setRenderer(Renderer *renderer);
 
     bool vBlankOccurred();
+    void setFrameSkipping(bool skipPresentation, bool skipRasterization);
+    bool videoModeIsPAL() const;
 
     void catchUpToCPU(uint32_t cpuCycles);
     void updateTimers(uint32_t cpuCycles);
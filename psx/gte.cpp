@@ -4,9 +4,15 @@
 #include <cassert>
 #include <format>
 #include <sstream>
+#include <utility>
 
 #include "util/log.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#define GTE_X86
+#include <immintrin.h>
+#endif
+
 #define INT32(x) static_cast<int32_t>(x)
 #define INT64(x) static_cast<int64_t>(x)
 
@@ -14,6 +20,312 @@ using namespace util;
 
 namespace PSX {
 
+namespace {
+
+// Flag bits of component k (0...2 for MAC1/IR1/R...MAC3/IR3/B)
+inline uint32_t component_flag(uint8_t flag_of_first, uint32_t k) {
+    return 1u << (flag_of_first - k);
+}
+
+// The triple commands run their three vertices through the same stages, each one a kernel that is
+// specialized for sf and lm (and what the stage computes) at compile time. All kernels return the flags they set.
+
+// MAC = (translation << 12) + matrix * vector, IR = MAC clamped, for the vectors of the three lanes.
+// For RTP, depth receives the 32 bit truncation of MAC3 >> 12 (for SZ3) and it sets the IR3 flag instead of MAC3.
+typedef uint32_t (*MatrixKernel)(const int16_t *matrix, const int32_t *translation, const GTELaneVector &vectors,
+                                 GTELaneVector &mac, GTELaneVector &ir, GTELanes &depth);
+
+enum class ColorStage {
+    NONE, // NCT: MAC and IR are just converted to colors
+    COLOR, // NCCT: MAC = (color * IR) << 4
+    COLOR_DEPTH_CUE, // NCDT: MAC = (color * IR) << 4, interpolated towards the far color by IR0
+    DEPTH_CUE // DPCT: MAC = color << 16, interpolated towards the far color by IR0
+};
+
+// Continues with MAC and IR of the matrix stage, colors receives the values pushed to the color queue
+typedef uint32_t (*ColorKernel)(const GTELaneVector &colors, const int32_t *far_color, int64_t ir0,
+                                GTELaneVector &mac, GTELaneVector &ir, GTELaneVector &rgb);
+
+inline int64_t sign_extend_44(int64_t value) {
+    return static_cast<int64_t>(static_cast<uint64_t>(value) << 20) >> 20;
+}
+
+inline uint32_t mac_overflow_flags(int64_t value, uint32_t k) {
+    return (value > INT64(0x7FF'FFFF'FFFF) ? component_flag(GTE_FLAGS_MAC1_POS_OVERFLOW, k) : 0)
+        | (value < -INT64(0x800'0000'0000) ? component_flag(GTE_FLAGS_MAC1_NEG_OVERFLOW, k) : 0);
+}
+
+inline int64_t clamp_ir(int64_t mac, bool lm, uint32_t k, uint32_t &flags) {
+    int64_t clamped = std::clamp(mac, lm ? INT64(0) : -INT64(0x8000), INT64(0x7FFF));
+    flags |= clamped != mac ? component_flag(GTE_FLAGS_IR1, k) : 0;
+    return clamped;
+}
+
+// Lane 3 is left out and copied from lane 0
+template<bool sf, bool lm, bool rtp>
+struct MatrixScalar {
+    static uint32_t run(const int16_t *matrix, const int32_t *translation, const GTELaneVector &vectors,
+                        GTELaneVector &mac, GTELaneVector &ir, GTELanes &depth) {
+        uint32_t flags = 0;
+        for (uint32_t k = 0; k < 3; ++k) {
+            for (uint32_t lane = 0; lane < 3; ++lane) {
+                int64_t sum = (INT64(translation[k]) << 12) + matrix[3 * k] * vectors[0][lane];
+                flags |= mac_overflow_flags(sum, k);
+                sum = sign_extend_44(sum) + matrix[3 * k + 1] * vectors[1][lane];
+                flags |= mac_overflow_flags(sum, k);
+                sum = sign_extend_44(sum) + matrix[3 * k + 2] * vectors[2][lane];
+                flags |= mac_overflow_flags(sum, k);
+                mac[k][lane] = INT32(sum >> (sf * 12));
+
+                if (rtp && k == 2) {
+                    int32_t shifted = INT32(sum >> 12);
+                    depth[lane] = shifted;
+                    clamp_ir(shifted, false, k, flags);
+                    uint32_t ignored = 0;
+                    ir[k][lane] = clamp_ir(mac[k][lane], lm, k, ignored);
+                } else {
+                    ir[k][lane] = clamp_ir(mac[k][lane], lm, k, flags);
+                }
+            }
+            mac[k][3] = mac[k][0];
+            ir[k][3] = ir[k][0];
+        }
+        depth[3] = depth[0];
+        return flags;
+    }
+};
+
+template<bool sf, bool lm, ColorStage stage>
+struct ColorScalar {
+    static uint32_t run(const GTELaneVector &colors, const int32_t *far_color, int64_t ir0,
+                        GTELaneVector &mac, GTELaneVector &ir, GTELaneVector &rgb) {
+        uint32_t flags = 0;
+        for (uint32_t k = 0; k < 3; ++k) {
+            for (uint32_t lane = 0; lane < 3; ++lane) {
+                if (stage == ColorStage::COLOR) {
+                    int64_t sum = (colors[k][lane] * ir[k][lane]) << 4;
+                    flags |= mac_overflow_flags(sum, k);
+                    mac[k][lane] = INT32(sum >> (sf * 12));
+                    ir[k][lane] = clamp_ir(mac[k][lane], lm, k, flags);
+                } else if (stage != ColorStage::NONE) {
+                    int64_t temp = stage == ColorStage::DEPTH_CUE ? colors[k][lane] << 16 : (colors[k][lane] * ir[k][lane]) << 4;
+                    int64_t sum = (INT64(far_color[k]) << 12) - temp;
+                    flags |= mac_overflow_flags(sum, k);
+                    mac[k][lane] = INT32(sum >> (sf * 12));
+                    ir[k][lane] = clamp_ir(mac[k][lane], false, k, flags);
+
+                    sum = temp + ir[k][lane] * ir0;
+                    flags |= mac_overflow_flags(sum, k);
+                    mac[k][lane] = INT32(sum >> (sf * 12));
+                    ir[k][lane] = clamp_ir(mac[k][lane], lm, k, flags);
+                }
+
+                int64_t color = mac[k][lane] >> 4;
+                rgb[k][lane] = std::clamp(color, INT64(0x00), INT64(0xFF));
+                flags |= rgb[k][lane] != color ? component_flag(GTE_FLAGS_COLOR_QUEUE_R_CLAMPED, k) : 0;
+            }
+            mac[k][3] = mac[k][0];
+            ir[k][3] = ir[k][0];
+            rgb[k][3] = rgb[k][0];
+        }
+        return flags;
+    }
+};
+
+#ifdef GTE_X86
+// AVX2 has no arithmetic 64 bit shifts, no 64 bit minimum/maximum and no 64 bit multiplication.
+// None of them are needed: the factors fit into 32 bits (_mm256_mul_epi32), the sign extensions flip
+// the sign bit instead, and the values that get shifted arithmetically fit into 32 bits.
+
+__attribute__((target("avx2")))
+inline __m256i load_lanes_avx2(const GTELanes &lanes) {
+    return _mm256_loadu_si256((const __m256i*)lanes.data());
+}
+
+__attribute__((target("avx2")))
+inline void store_lanes_avx2(GTELanes &lanes, __m256i value) {
+    _mm256_storeu_si256((__m256i*)lanes.data(), value);
+}
+
+// Sign-extends the lower bits of the lanes
+template<uint32_t bits>
+__attribute__((target("avx2")))
+inline __m256i sign_extend_avx2(__m256i value) {
+    __m256i mask = _mm256_set1_epi64x((INT64(1) << bits) - 1);
+    __m256i sign = _mm256_set1_epi64x(INT64(1) << (bits - 1));
+    return _mm256_sub_epi64(_mm256_xor_si256(_mm256_and_si256(value, mask), sign), sign);
+}
+
+// MAC1...MAC3 = lower 32 bits of sum >> shift
+template<uint32_t shift>
+__attribute__((target("avx2")))
+inline __m256i truncate_mac_avx2(__m256i sum) {
+    // Logical and arithmetic shifts agree in the lower 32 bits
+    return sign_extend_avx2<32>(_mm256_srli_epi64(sum, shift));
+}
+
+// Collects the lanes outside of the 44 bit range
+__attribute__((target("avx2")))
+inline void check_mac_avx2(__m256i sum, __m256i &positive, __m256i &negative) {
+    positive = _mm256_or_si256(positive, _mm256_cmpgt_epi64(sum, _mm256_set1_epi64x(INT64(0x7FF'FFFF'FFFF))));
+    negative = _mm256_or_si256(negative, _mm256_cmpgt_epi64(_mm256_set1_epi64x(-INT64(0x800'0000'0000)), sum));
+}
+
+__attribute__((target("avx2")))
+inline uint32_t any_lane_avx2(__m256i mask, uint32_t flag) {
+    return _mm256_testz_si256(mask, mask) ? 0 : flag;
+}
+
+// Clamps the lanes to [min, max], clamped collects the lanes that were out of range
+__attribute__((target("avx2")))
+inline __m256i clamp_avx2(__m256i value, int64_t min, int64_t max, __m256i &clamped) {
+    __m256i upper = _mm256_set1_epi64x(max);
+    __m256i lower = _mm256_set1_epi64x(min);
+    __m256i above = _mm256_cmpgt_epi64(value, upper);
+    __m256i below = _mm256_cmpgt_epi64(lower, value);
+    clamped = _mm256_or_si256(clamped, _mm256_or_si256(above, below));
+    return _mm256_blendv_epi8(_mm256_blendv_epi8(value, upper, above), lower, below);
+}
+
+__attribute__((target("avx2")))
+inline __m256i clamp_ir_avx2(__m256i mac, bool lm, uint32_t k, uint32_t &flags) {
+    __m256i clamped = _mm256_setzero_si256();
+    __m256i ir = clamp_avx2(mac, lm ? 0 : -0x8000, 0x7FFF, clamped);
+    flags |= any_lane_avx2(clamped, component_flag(GTE_FLAGS_IR1, k));
+    return ir;
+}
+
+template<bool sf, bool lm, bool rtp>
+struct MatrixAVX2 {
+    __attribute__((target("avx2")))
+    static uint32_t run(const int16_t *matrix, const int32_t *translation, const GTELaneVector &vectors,
+                        GTELaneVector &mac, GTELaneVector &ir, GTELanes &depth) {
+        __m256i x = load_lanes_avx2(vectors[0]);
+        __m256i y = load_lanes_avx2(vectors[1]);
+        __m256i z = load_lanes_avx2(vectors[2]);
+
+        uint32_t flags = 0;
+        for (uint32_t k = 0; k < 3; ++k) {
+            __m256i positive = _mm256_setzero_si256();
+            __m256i negative = _mm256_setzero_si256();
+            __m256i sum = _mm256_add_epi64(_mm256_set1_epi64x(INT64(translation[k]) << 12),
+                                           _mm256_mul_epi32(_mm256_set1_epi64x(matrix[3 * k]), x));
+            check_mac_avx2(sum, positive, negative);
+            sum = _mm256_add_epi64(sign_extend_avx2<44>(sum), _mm256_mul_epi32(_mm256_set1_epi64x(matrix[3 * k + 1]), y));
+            check_mac_avx2(sum, positive, negative);
+            sum = _mm256_add_epi64(sign_extend_avx2<44>(sum), _mm256_mul_epi32(_mm256_set1_epi64x(matrix[3 * k + 2]), z));
+            check_mac_avx2(sum, positive, negative);
+            flags |= any_lane_avx2(positive, component_flag(GTE_FLAGS_MAC1_POS_OVERFLOW, k));
+            flags |= any_lane_avx2(negative, component_flag(GTE_FLAGS_MAC1_NEG_OVERFLOW, k));
+
+            __m256i result = truncate_mac_avx2<sf * 12>(sum);
+            store_lanes_avx2(mac[k], result);
+            if (rtp && k == 2) {
+                __m256i shifted = truncate_mac_avx2<12>(sum);
+                store_lanes_avx2(depth, shifted);
+                clamp_ir_avx2(shifted, false, k, flags);
+                uint32_t ignored = 0;
+                store_lanes_avx2(ir[k], clamp_ir_avx2(result, lm, k, ignored));
+            } else {
+                store_lanes_avx2(ir[k], clamp_ir_avx2(result, lm, k, flags));
+            }
+        }
+        return flags;
+    }
+};
+
+template<bool sf, bool lm, ColorStage stage>
+struct ColorAVX2 {
+    __attribute__((target("avx2")))
+    static uint32_t run(const GTELaneVector &colors, const int32_t *far_color, int64_t ir0,
+                        GTELaneVector &mac, GTELaneVector &ir, GTELaneVector &rgb) {
+        uint32_t flags = 0;
+        for (uint32_t k = 0; k < 3; ++k) {
+            __m256i mac_k = load_lanes_avx2(mac[k]);
+            __m256i ir_k = load_lanes_avx2(ir[k]);
+            if (stage != ColorStage::NONE) {
+                __m256i color = load_lanes_avx2(colors[k]);
+                __m256i positive = _mm256_setzero_si256();
+                __m256i negative = _mm256_setzero_si256();
+                if (stage == ColorStage::COLOR) {
+                    __m256i sum = _mm256_slli_epi64(_mm256_mul_epi32(color, ir_k), 4);
+                    check_mac_avx2(sum, positive, negative);
+                    mac_k = truncate_mac_avx2<sf * 12>(sum);
+                    ir_k = clamp_ir_avx2(mac_k, lm, k, flags);
+                } else {
+                    __m256i temp = stage == ColorStage::DEPTH_CUE ? _mm256_slli_epi64(color, 16)
+                                                                 : _mm256_slli_epi64(_mm256_mul_epi32(color, ir_k), 4);
+                    __m256i sum = _mm256_sub_epi64(_mm256_set1_epi64x(INT64(far_color[k]) << 12), temp);
+                    check_mac_avx2(sum, positive, negative);
+                    mac_k = truncate_mac_avx2<sf * 12>(sum);
+                    ir_k = clamp_ir_avx2(mac_k, false, k, flags);
+
+                    sum = _mm256_add_epi64(temp, _mm256_mul_epi32(ir_k, _mm256_set1_epi64x(ir0)));
+                    check_mac_avx2(sum, positive, negative);
+                    mac_k = truncate_mac_avx2<sf * 12>(sum);
+                    ir_k = clamp_ir_avx2(mac_k, lm, k, flags);
+                }
+                flags |= any_lane_avx2(positive, component_flag(GTE_FLAGS_MAC1_POS_OVERFLOW, k));
+                flags |= any_lane_avx2(negative, component_flag(GTE_FLAGS_MAC1_NEG_OVERFLOW, k));
+                store_lanes_avx2(mac[k], mac_k);
+                store_lanes_avx2(ir[k], ir_k);
+            }
+
+            // MAC fits into 32 bits, whose arithmetic shift keeps the upper half of the lane intact
+            __m256i clamped = _mm256_setzero_si256();
+            store_lanes_avx2(rgb[k], clamp_avx2(_mm256_srai_epi32(mac_k, 4), 0x00, 0xFF, clamped));
+            flags |= any_lane_avx2(clamped, component_flag(GTE_FLAGS_COLOR_QUEUE_R_CLAMPED, k));
+        }
+        return flags;
+    }
+};
+#endif
+
+// Tables of the specializations, indexed by sf * 4 + lm * 2 + rtp and sf * 8 + lm * 4 + stage
+template<template<bool, bool, bool> class Kernel, size_t... I>
+std::array<MatrixKernel, 8> matrix_kernel_table(std::index_sequence<I...>) {
+    return {Kernel<(I & 4) != 0, (I & 2) != 0, (I & 1) != 0>::run...};
+}
+
+template<template<bool, bool, ColorStage> class Kernel, size_t... I>
+std::array<ColorKernel, 16> color_kernel_table(std::index_sequence<I...>) {
+    return {Kernel<(I & 8) != 0, (I & 4) != 0, static_cast<ColorStage>(I & 3)>::run...};
+}
+
+struct Kernels {
+    std::array<MatrixKernel, 8> matrix;
+    std::array<ColorKernel, 16> color;
+
+    Kernels()
+        : matrix(matrix_kernel_table<MatrixScalar>(std::make_index_sequence<8>())),
+          color(color_kernel_table<ColorScalar>(std::make_index_sequence<16>())) {
+#ifdef GTE_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            matrix = matrix_kernel_table<MatrixAVX2>(std::make_index_sequence<8>());
+            color = color_kernel_table<ColorAVX2>(std::make_index_sequence<16>());
+        }
+#endif
+    }
+
+    MatrixKernel get_matrix(bool sf, bool lm, bool rtp) const {
+        return matrix[sf * 4 + lm * 2 + rtp];
+    }
+
+    ColorKernel get_color(bool sf, bool lm, ColorStage stage) const {
+        return color[sf * 8 + lm * 4 + static_cast<uint32_t>(stage)];
+    }
+};
+
+const Kernels& kernels() {
+    static const Kernels selected;
+    return selected;
+}
+
+const int32_t no_translation[3] = {0, 0, 0};
+
+}
+
 std::ostream& operator<<(std::ostream &os, const GTE &gte) {
     return os;
 }
@@ -139,7 +451,6 @@ void GTE::reset() {
     mac1 = 0;
     mac2 = 0;
     mac3 = 0;
-    rgb = 0;
     lzcs = 0;
 
     for (int i = 0; i < 9; ++i) {
@@ -206,22 +517,117 @@ void GTE::execute(uint32_t instruction) {
     this->lm = Bit::getBit(instruction, GTE_INST_LM);
     funct = 0x3F & instruction;
 
+#ifdef GTE_PROFILE
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#endif
+
     reset_flags();
     (this->*cp2[funct])();
+
+#ifdef GTE_PROFILE
+    profile_command(funct, std::chrono::steady_clock::now() - start);
+#endif
+}
+
+#ifdef GTE_PROFILE
+void GTE::profile_command(uint8_t funct, std::chrono::steady_clock::duration duration) {
+    ++frame_profile.calls[funct];
+    frame_profile.nanoseconds[funct] += std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+    for (uint32_t bits = get_flags(); bits != 0; bits &= bits - 1) {
+        ++frame_profile.flags[std::countr_zero(bits)];
+    }
+}
+
+void GTE::end_profile_frame() {
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    last_frame_profile = frame_profile;
+    frame_profile.reset();
+}
+
+GTEProfile GTE::get_profile() const {
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    return last_frame_profile;
+}
+
+GTEProfile::GTEProfile() {
+    reset();
+}
+
+void GTEProfile::reset() {
+    calls.fill(0);
+    nanoseconds.fill(0);
+    flags.fill(0);
+}
+
+uint64_t GTEProfile::total_calls() const {
+    uint64_t total = 0;
+    for (uint64_t c : calls) {
+        total += c;
+    }
+    return total;
+}
+
+std::string GTEProfile::report() const {
+    static const char* COMMAND_NAMES[64] = {
+        "UNOFF", "RTPS", "UNOFF", "UNOFF", "UNOFF", "UNOFF", "NCLIP", "UNOFF",
+        "UNOFF", "UNOFF", "UNOFF", "UNOFF", "OP", "UNOFF", "UNOFF", "UNOFF",
+        "DPCS", "INTPL", "MVMVA", "NCDS", "CDP", "UNOFF", "NCDT", "UNOFF",
+        "UNOFF", "UNOFF", "UNOFF", "NCCS", "CC", "UNOFF", "NCS", "UNOFF",
+        "NCT", "UNOFF", "UNOFF", "UNOFF", "UNOFF", "UNOFF", "UNOFF", "UNOFF",
+        "SQR", "DCPL", "DPCT", "UNOFF", "UNOFF", "AVSZ3", "AVSZ4", "UNOFF",
+        "RTPT", "UNOFF", "UNOFF", "UNOFF", "UNOFF", "UNOFF", "UNOFF", "UNOFF",
+        "UNOFF", "UNOFF", "UNOFF", "UNOFF", "UNOFF", "GPF", "GPL", "NCCT"
+    };
+    static const char* FLAG_NAMES[32] = {
+        "", "", "", "", "", "", "", "", "", "", "", "",
+        "IR0", "SY2", "SX2", "MAC0-", "MAC0+", "DIVISION", "SZ3/OTZ",
+        "B", "G", "R", "IR3", "IR2", "IR1", "MAC3-", "MAC2-", "MAC1-", "MAC3+", "MAC2+", "MAC1+", "ERROR"
+    };
+
+    std::array<uint8_t, 64> order;
+    for (uint32_t i = 0; i < 64; ++i) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [this](uint8_t a, uint8_t b) {
+        return nanoseconds[a] > nanoseconds[b];
+    });
+
+    std::stringstream ss;
+    ss << std::format("GTE: {:d} commands", total_calls()) << std::endl;
+    for (uint8_t funct : order) {
+        // Commands that were called but measured 0 ns may sort behind the unused ones
+        if (calls[funct] == 0) {
+            continue;
+        }
+        ss << std::format("  {:<5s} (0x{:02X}) {:>8d} calls {:>10.3f} ms {:>8.1f} ns/call",
+                          COMMAND_NAMES[funct], funct, calls[funct], nanoseconds[funct] / 1e6,
+                          static_cast<double>(nanoseconds[funct]) / calls[funct]) << std::endl;
+    }
+    for (uint32_t bit = 31; bit >= 12; --bit) {
+        if (flags[bit] != 0) {
+            ss << std::format("  flag {:<8s} ({:2d}) {:>8d} commands", FLAG_NAMES[bit], bit, flags[bit]) << std::endl;
+        }
+    }
+    return ss.str();
 }
+#endif
 
 void GTE::reset_flags() {
     flags = 0;
 }
 
-void GTE::update_error_flag() {
+uint32_t GTE::get_flags() const {
     uint32_t bits_in_error_flag = 0x7F87'E000; // 30 to 23, 18 to 13 (IR3 not included?!)
-    Bit::setBit(flags, GTE_FLAGS_ERROR, flags & bits_in_error_flag);
+    uint32_t error = (flags & bits_in_error_flag) != 0;
+    return flags | (error << GTE_FLAGS_ERROR);
 }
 
 void GTE::set_flag(uint8_t flag) {
     Bit::setBit(flags, flag);
-    update_error_flag();
+}
+
+void GTE::set_flag_if(bool condition, uint8_t flag) {
+    flags |= static_cast<uint32_t>(condition) << flag;
 }
 
 uint32_t GTE::get_register_as_uint32_t(uint8_t rt) {
@@ -285,9 +691,9 @@ uint32_t GTE::get_register_as_uint32_t(uint8_t rt) {
         case GTE_REG_MAC3:
             return mac3;
         case GTE_REG_IRGB:
-            return rgb;
+            return get_orgb();
         case GTE_REG_ORGB:
-            return rgb;
+            return get_orgb();
         case GTE_REG_LZCS:
             return lzcs;
         case GTE_REG_LZCR:
@@ -474,7 +880,7 @@ uint32_t GTE::get_control_register_as_uint32_t(uint8_t rt) {
         case GTE_REG_ZSF4:
             return static_cast<int32_t>(zsf4);
         case GTE_REG_FLAGS:
-            return flags;
+            return get_flags();
         default:
             assert(false);
             return 0;
@@ -592,7 +998,6 @@ void GTE::set_control_register_from_uint32_t(uint8_t rt, uint32_t value) {
             break;
         case GTE_REG_FLAGS:
             flags = value & 0x7FFF'F000;
-            update_error_flag();
             break;
         default:
             assert(false);
@@ -600,15 +1005,12 @@ void GTE::set_control_register_from_uint32_t(uint8_t rt, uint32_t value) {
 }
 
 uint8_t GTE::clamp_to_u8bit(int64_t value) {
-    int64_t clamped = std::min(static_cast<int64_t>(0xFF), value);
-    clamped = std::max(static_cast<int64_t>(0x00), clamped);
-    return clamped;
+    return std::clamp(value, INT64(0x00), INT64(0xFF));
 }
 
 int64_t GTE::clamp_to_16bit(int64_t value, bool lm) {
-    int64_t clamped = std::min(static_cast<int64_t>(0x7FFF), value);
-    clamped = lm ? std::max(static_cast<int64_t>(0), clamped) : std::max(-static_cast<int64_t>(0x8000), clamped);
-    return clamped;
+    int64_t lower_limit = lm ? 0 : -0x8000;
+    return std::clamp(value, lower_limit, static_cast<int64_t>(0x7FFF));
 }
 
 uint8_t GTE::convert_16bit_to_5bit_color(int32_t color) {
@@ -634,68 +1036,83 @@ void GTE::push_color_queue() {
     rgb1 = rgb2;
 }
 
+GTELaneVector GTE::get_vector_lanes() const {
+    return {{
+        {v0.x, v1.x, v2.x, v0.x},
+        {v0.y, v1.y, v2.y, v0.y},
+        {v0.z, v1.z, v2.z, v0.z}
+    }};
+}
+
+GTELaneVector GTE::get_color_lanes() const {
+    return {{
+        {get_r(), get_r(), get_r(), get_r()},
+        {get_g(), get_g(), get_g(), get_g()},
+        {get_b(), get_b(), get_b(), get_b()}
+    }};
+}
+
+void GTE::set_mac_ir_from_lane(const GTELaneVector &mac, const GTELaneVector &ir, uint32_t lane) {
+    mac1 = mac[0][lane];
+    mac2 = mac[1][lane];
+    mac3 = mac[2][lane];
+    set_ir1_without_clamping(ir[0][lane]);
+    set_ir2_without_clamping(ir[1][lane]);
+    set_ir3_without_clamping(ir[2][lane]);
+}
+
+void GTE::push_color_lanes(const GTELaneVector &colors) {
+    uint32_t code = get_c() << 24;
+    rgb0 = colors[0][0] | (colors[1][0] << 8) | (colors[2][0] << 16) | code;
+    rgb1 = colors[0][1] | (colors[1][1] << 8) | (colors[2][1] << 16) | code;
+    rgb2 = colors[0][2] | (colors[1][2] << 8) | (colors[2][2] << 16) | code;
+}
+
 void GTE::set_sx2(int64_t value) {
     int32_t lower = static_cast<int32_t>(value);
-    int64_t clamped = std::min(static_cast<int32_t>(0x03FF), lower);
-    clamped = std::max(-static_cast<int64_t>(0x0400), clamped); // Minus in front of static_cast
-    if (clamped != lower) {
-        set_flag(GTE_FLAGS_SX2_CLAMPED);
-    }
+    int32_t clamped = std::clamp(lower, -0x0400, 0x03FF);
+    set_flag_if(clamped != lower, GTE_FLAGS_SX2_CLAMPED);
     sxy2.x = clamped;
 }
 
 void GTE::set_sy2(int64_t value) {
     int32_t lower = static_cast<int32_t>(value);
-    int64_t clamped = std::min(static_cast<int32_t>(0x03FF), lower);
-    clamped = std::max(-static_cast<int64_t>(0x0400), clamped); // Minus in front of static_cast
-    if (clamped != lower) {
-        set_flag(GTE_FLAGS_SY2_CLAMPED);
-    }
+    int32_t clamped = std::clamp(lower, -0x0400, 0x03FF);
+    set_flag_if(clamped != lower, GTE_FLAGS_SY2_CLAMPED);
     sxy2.y = clamped;
 }
 
 void GTE::set_ir0(int64_t value) {
-    int64_t clamped = std::min(static_cast<int64_t>(0x1000), value);
-    clamped = std::max(static_cast<int64_t>(0x0000), clamped);
-    if (clamped != value) {
-        set_flag(GTE_FLAGS_IR0_CLAMPED);
-    }
+    int64_t clamped = std::clamp(value, INT64(0x0000), INT64(0x1000));
+    set_flag_if(clamped != value, GTE_FLAGS_IR0_CLAMPED);
     ir0 = clamped;
 }
 
 void GTE::set_ir1(int64_t value, bool lm) {
     int32_t lower = static_cast<int32_t>(value);
     int64_t clamped = clamp_to_16bit(lower, lm);
-    if (clamped != lower) {
-        set_flag(GTE_FLAGS_IR1);
-    }
+    set_flag_if(clamped != lower, GTE_FLAGS_IR1);
     set_ir1_without_clamping(clamped);
 }
 
 void GTE::set_ir2(int64_t value, bool lm) {
     int32_t lower = static_cast<int32_t>(value);
     int64_t clamped = clamp_to_16bit(lower, lm);
-    if (clamped != lower) {
-        set_flag(GTE_FLAGS_IR2);
-    }
+    set_flag_if(clamped != lower, GTE_FLAGS_IR2);
     set_ir2_without_clamping(clamped);
 }
 
 void GTE::set_ir3(int64_t value, bool lm) {
     int32_t lower = static_cast<int32_t>(value);
     int64_t clamped = clamp_to_16bit(lower, lm);
-    if (clamped != lower) {
-        set_flag(GTE_FLAGS_IR3);
-    }
+    set_flag_if(clamped != lower, GTE_FLAGS_IR3);
     set_ir3_without_clamping(clamped);
 }
 
 void GTE::set_ir3_special(int64_t value, int64_t definitely_shifted_value, bool lm) {
     int32_t lower_dsv = static_cast<int32_t>(definitely_shifted_value);
     int64_t clamped_dsv = clamp_to_16bit(lower_dsv, false);
-    if (clamped_dsv != lower_dsv) {
-        set_flag(GTE_FLAGS_IR3);
-    }
+    set_flag_if(clamped_dsv != lower_dsv, GTE_FLAGS_IR3);
 
     int32_t lower = static_cast<int32_t>(value);
     int64_t clamped = clamp_to_16bit(lower, lm);
@@ -704,22 +1121,18 @@ void GTE::set_ir3_special(int64_t value, int64_t definitely_shifted_value, bool
 
 void GTE::set_ir1_without_clamping(int64_t value) {
     ir1 = value;
-    rgb = (rgb & 0xFFFFFFE0) | convert_16bit_to_5bit_color(value);
 }
 
 void GTE::set_ir2_without_clamping(int64_t value) {
     ir2 = value;
-    rgb = (rgb & 0xFFFFFC1F) | (convert_16bit_to_5bit_color(value) << 5);
 }
 
 void GTE::set_ir3_without_clamping(int64_t value) {
     ir3 = value;
-    rgb = (rgb & 0xFFFF83FF) | (convert_16bit_to_5bit_color(value) << 10);
 }
 
 void GTE::set_irgb(uint32_t value) {
-    rgb = value & 0x00007FFF;
-
+    // ORGB reads back the same bits, as they are derived from IR1, IR2, IR3
     uint8_t r = Bit::getBits<5>(value, 0);
     uint8_t g = Bit::getBits<5>(value, 5);
     uint8_t b = Bit::getBits<5>(value, 10);
@@ -729,206 +1142,100 @@ void GTE::set_irgb(uint32_t value) {
     ir3 = b * 0x80;
 }
 
+uint32_t GTE::get_orgb() const {
+    return convert_16bit_to_5bit_color(ir1)
+        | (convert_16bit_to_5bit_color(ir2) << 5)
+        | (convert_16bit_to_5bit_color(ir3) << 10);
+}
+
 void GTE::set_otz(int64_t value) {
-    int64_t clamped = std::min(static_cast<int64_t>(0xFFFF), value);
-    clamped = std::max(static_cast<int64_t>(0x0000), clamped);
-    if (clamped != value) {
-        set_flag(GTE_FLAGS_SZ3_OTZ_CLAMPED);
-    }
+    int64_t clamped = std::clamp(value, INT64(0x0000), INT64(0xFFFF));
+    set_flag_if(clamped != value, GTE_FLAGS_SZ3_OTZ_CLAMPED);
     otz = clamped;
 }
 
 void GTE::set_sz3(int64_t value) {
     int32_t lower = static_cast<int32_t>(value);
-    int32_t clamped = std::min(static_cast<int32_t>(0xFFFF), lower);
-    clamped = std::max(static_cast<int32_t>(0x0000), clamped);
-    if (clamped != lower) {
-        set_flag(GTE_FLAGS_SZ3_OTZ_CLAMPED);
-    }
+    int32_t clamped = std::clamp(lower, 0x0000, 0xFFFF);
+    set_flag_if(clamped != lower, GTE_FLAGS_SZ3_OTZ_CLAMPED);
     sz3 = clamped;
 }
 
+void GTE::check_mac0_overflow(int64_t value) {
+    // 32bit overflow
+    set_flag_if(value > INT64(0x7FFF'FFFF), GTE_FLAGS_MAC0_POS_OVERFLOW);
+    set_flag_if(value < -INT64(0x8000'0000), GTE_FLAGS_MAC0_NEG_OVERFLOW);
+}
+
+void GTE::check_mac_overflow(int64_t value, uint8_t pos_flag, uint8_t neg_flag) {
+    // 44bit overflow
+    set_flag_if(value > INT64(0x7FF'FFFF'FFFF), pos_flag);
+    set_flag_if(value < -INT64(0x800'0000'0000), neg_flag);
+}
+
 void GTE::set_mac0(int64_t value) {
-    int64_t clamped = std::min(static_cast<int64_t>(0x7FFF'FFFF), value);
-    if (clamped != value) {
-        // positive 32bit overflow
-        set_flag(GTE_FLAGS_MAC0_POS_OVERFLOW);
-    }
-    int64_t temp = clamped;
-    clamped = std::max(-static_cast<int64_t>(0x8000'0000), clamped); // Minus has to be in front of the cast!
-    if (clamped != temp) {
-        // negative 32bit overflow
-        set_flag(GTE_FLAGS_MAC0_NEG_OVERFLOW);
-    }
+    check_mac0_overflow(value);
     // MAC0 does not get clamped! Value is just used for checking overflow
     mac0 = value;
 }
 
 void GTE::set_mac1(int64_t value, uint8_t shift) {
-    int64_t clamped = std::min(static_cast<int64_t>(0x7FF'FFFF'FFFF), value);
-    if (clamped != value) {
-        // positive 44bit overflow
-        set_flag(GTE_FLAGS_MAC1_POS_OVERFLOW);
-    }
-    int64_t temp = clamped;
-    clamped = std::max(-static_cast<int64_t>(0x800'0000'0000), clamped);
-    if (clamped != temp) {
-        // negative 44bit overflow
-        set_flag(GTE_FLAGS_MAC1_NEG_OVERFLOW);
-    }
+    check_mac_overflow(value, GTE_FLAGS_MAC1_POS_OVERFLOW, GTE_FLAGS_MAC1_NEG_OVERFLOW);
     // MAC1 does not get clamped! Value is just used for checking overflow
-    //mac1 = value & 0xFFF'FFFF'FFFF;
-    //if (mac1 & 0x800'0000'0000) {
-    //    mac1 |= 0xFFFF'F000'0000'0000;
-    //}
     mac1 = static_cast<int32_t>(value >> shift);
-    //mac1 = value;
 }
 
 void GTE::set_mac2(int64_t value, uint8_t shift) {
-    int64_t clamped = std::min(static_cast<int64_t>(0x7FF'FFFF'FFFF), value);
-    if (clamped != value) {
-        // positive 44bit overflow
-        set_flag(GTE_FLAGS_MAC2_POS_OVERFLOW);
-    }
-    int64_t temp = clamped;
-    clamped = std::max(-static_cast<int64_t>(0x800'0000'0000), clamped);
-    if (clamped != temp) {
-        // negative 44bit overflow
-        set_flag(GTE_FLAGS_MAC2_NEG_OVERFLOW);
-    }
+    check_mac_overflow(value, GTE_FLAGS_MAC2_POS_OVERFLOW, GTE_FLAGS_MAC2_NEG_OVERFLOW);
     // MAC2 does not get clamped! Value is just used for checking overflow
-    //mac2 = value & 0xFFF'FFFF'FFFF;
-    //if (mac2 & 0x800'0000'0000) {
-    //    mac2 |= 0xFFFF'F000'0000'0000;
-    //}
     mac2 = static_cast<int32_t>(value >> shift);
-    //mac2 = value;
 }
 
 void GTE::set_mac3(int64_t value, uint8_t shift) {
-    int64_t clamped = std::min(static_cast<int64_t>(0x7FF'FFFF'FFFF), value);
-    if (clamped != value) {
-        // positive 44bit overflow
-        set_flag(GTE_FLAGS_MAC3_POS_OVERFLOW);
-    }
-    int64_t temp = clamped;
-    clamped = std::max(-static_cast<int64_t>(0x800'0000'0000), clamped);
-    if (clamped != temp) {
-        // negative 44bit overflow
-        set_flag(GTE_FLAGS_MAC3_NEG_OVERFLOW);
-    }
+    check_mac_overflow(value, GTE_FLAGS_MAC3_POS_OVERFLOW, GTE_FLAGS_MAC3_NEG_OVERFLOW);
     // MAC3 does not get clamped! Value is just used for checking overflow
-    //mac3 = value & 0xFFF'FFFF'FFFF;
-    //if (mac3 & 0x800'0000'0000) {
-    //    mac3 |= 0xFFFF'F000'0000'0000;
-    //}
     mac3 = static_cast<int32_t>(value >> shift);
-    //mac3 = value;
 }
 
 int64_t GTE::sign_extend0(int64_t value) {
-    int64_t clamped = std::min(static_cast<int64_t>(0x7FFF'FFFF), value);
-    if (clamped != value) {
-        // positive 32bit overflow
-        set_flag(GTE_FLAGS_MAC0_POS_OVERFLOW);
-    }
-    int64_t temp = clamped;
-    clamped = std::max(-static_cast<int64_t>(0x8000'0000), clamped); // Minus has to be in front of the cast!
-    if (clamped != temp) {
-        // negative 32bit overflow
-        set_flag(GTE_FLAGS_MAC0_NEG_OVERFLOW);
-    }
-
-    if (value & 0x0000'0000'8000'0000) {
-        value |= 0xFFFF'FFFF'0000'0000;
-    } else {
-        value &= 0x0000'0000'7FFF'FFFF;
-    }
-    return value;
+    check_mac0_overflow(value);
+    // Keep the lower 32 bits, sign-extended
+    return static_cast<int32_t>(value);
 }
 
 int64_t GTE::sign_extend1(int64_t value) {
-    int64_t clamped = std::min(static_cast<int64_t>(0x7FF'FFFF'FFFF), value);
-    if (clamped != value) {
-        // positive 44bit overflow
-        set_flag(GTE_FLAGS_MAC1_POS_OVERFLOW);
-    }
-    int64_t temp = clamped;
-    clamped = std::max(-static_cast<int64_t>(0x800'0000'0000), clamped);
-    if (clamped != temp) {
-        // negative 44bit overflow
-        set_flag(GTE_FLAGS_MAC1_NEG_OVERFLOW);
-    }
-    if (value & 0x0000'0800'0000'0000) {
-        value |= 0xFFFF'F000'0000'0000;
-    } else {
-        value &= 0x0000'07FF'FFFF'FFFF;
-    }
-    return value;
+    check_mac_overflow(value, GTE_FLAGS_MAC1_POS_OVERFLOW, GTE_FLAGS_MAC1_NEG_OVERFLOW);
+    // Keep the lower 44 bits, sign-extended
+    return static_cast<int64_t>(static_cast<uint64_t>(value) << 20) >> 20;
 }
 
 int64_t GTE::sign_extend2(int64_t value) {
-    int64_t clamped = std::min(static_cast<int64_t>(0x7FF'FFFF'FFFF), value);
-    if (clamped != value) {
-        // positive 44bit overflow
-        set_flag(GTE_FLAGS_MAC2_POS_OVERFLOW);
-    }
-    int64_t temp = clamped;
-    clamped = std::max(-static_cast<int64_t>(0x800'0000'0000), clamped);
-    if (clamped != temp) {
-        // negative 44bit overflow
-        set_flag(GTE_FLAGS_MAC2_NEG_OVERFLOW);
-    }
-    if (value & 0x0000'0800'0000'0000) {
-        value |= 0xFFFF'F000'0000'0000;
-    } else {
-        value &= 0x0000'07FF'FFFF'FFFF;
-    }
-    return value;
+    check_mac_overflow(value, GTE_FLAGS_MAC2_POS_OVERFLOW, GTE_FLAGS_MAC2_NEG_OVERFLOW);
+    // Keep the lower 44 bits, sign-extended
+    return static_cast<int64_t>(static_cast<uint64_t>(value) << 20) >> 20;
 }
 
 int64_t GTE::sign_extend3(int64_t value) {
-    int64_t clamped = std::min(static_cast<int64_t>(0x7FF'FFFF'FFFF), value);
-    if (clamped != value) {
-        // positive 44bit overflow
-        set_flag(GTE_FLAGS_MAC3_POS_OVERFLOW);
-    }
-    int64_t temp = clamped;
-    clamped = std::max(-static_cast<int64_t>(0x800'0000'0000), clamped);
-    if (clamped != temp) {
-        // negative 44bit overflow
-        set_flag(GTE_FLAGS_MAC3_NEG_OVERFLOW);
-    }
-    if (value & 0x0000'0800'0000'0000) {
-        value |= 0xFFFF'F000'0000'0000;
-    } else {
-        value &= 0x0000'07FF'FFFF'FFFF;
-    }
-    return value;
+    check_mac_overflow(value, GTE_FLAGS_MAC3_POS_OVERFLOW, GTE_FLAGS_MAC3_NEG_OVERFLOW);
+    // Keep the lower 44 bits, sign-extended
+    return static_cast<int64_t>(static_cast<uint64_t>(value) << 20) >> 20;
 }
 
 void GTE::set_r2(int64_t value) {
     uint8_t clamped = clamp_to_u8bit(value);
-    if (clamped != value) {
-        set_flag(GTE_FLAGS_COLOR_QUEUE_R_CLAMPED);
-    }
+    set_flag_if(clamped != value, GTE_FLAGS_COLOR_QUEUE_R_CLAMPED);
     rgb2 = (rgb2 & 0xFFFF'FF00U) | static_cast<uint32_t>(clamped);
 }
 
 void GTE::set_g2(int64_t value) {
     uint8_t clamped = clamp_to_u8bit(value);
-    if (clamped != value) {
-        set_flag(GTE_FLAGS_COLOR_QUEUE_G_CLAMPED);
-    }
+    set_flag_if(clamped != value, GTE_FLAGS_COLOR_QUEUE_G_CLAMPED);
     rgb2 = (rgb2 & 0xFFFF'00FFU) | (static_cast<uint32_t>(clamped) << 8);
 }
 
 void GTE::set_b2(int64_t value) {
     uint8_t clamped = clamp_to_u8bit(value);
-    if (clamped != value) {
-        set_flag(GTE_FLAGS_COLOR_QUEUE_B_CLAMPED);
-    }
+    set_flag_if(clamped != value, GTE_FLAGS_COLOR_QUEUE_B_CLAMPED);
     rgb2 = (rgb2 & 0xFF00'FFFFU) | (static_cast<uint32_t>(clamped) << 16);
 }
 
@@ -971,202 +1278,140 @@ void GTE::RTPT() {
     // Perspective Transformation (Triple)
     LOGT_GTE(std::format("RTPT"));
 
-    // V0
-    set_mac1(sign_extend1(sign_extend1((get_trx() << 12) + get_rt11() * get_vx0()) + get_rt12() * get_vy0()) + get_rt13() * get_vz0(), sf * 12);
-    set_mac2(sign_extend2(sign_extend2((get_try() << 12) + get_rt21() * get_vx0()) + get_rt22() * get_vy0()) + get_rt23() * get_vz0(), sf * 12);
-    int64_t temp_mac3 = sign_extend3(sign_extend3((get_trz() << 12) + get_rt31() * get_vx0()) + get_rt32() * get_vy0()) + get_rt33() * get_vz0();
-    set_mac3(temp_mac3, sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3_special(get_mac3(), temp_mac3 >> 12, lm);
+    GTELaneVector mac, ir;
+    GTELanes depth;
+    flags |= kernels().get_matrix(sf, lm, true)(rotation_matrix, translation_vector, get_vector_lanes(), mac, ir, depth);
+    set_mac_ir_from_lane(mac, ir, 2);
 
-    push_sz_queue();
-    set_sz3(temp_mac3 >> 12);
-
-    push_sxy_queue();
-    int64_t division = static_cast<int64_t>(unr_division(h, sz3));
+    for (uint32_t lane = 0; lane < 3; ++lane) {
+        push_sz_queue();
+        set_sz3(depth[lane]);
+    }
 
-    set_mac0(division * get_ir1() + get_ofx());
-    set_sx2(get_mac0() >> 16);
-    set_mac0(division * get_ir2() + get_ofy());
-    set_sy2(get_mac0() >> 16);
-    //set_mac0(division * get_dqa() + get_dqb());
-    //set_ir0(get_mac0() >> 12);
+    // The divisions of the three vertices are independent of each other
+    int64_t divisions[3];
+    const uint16_t *depths[3] = {&sz1, &sz2, &sz3};
+    for (uint32_t lane = 0; lane < 3; ++lane) {
+        divisions[lane] = static_cast<int64_t>(unr_division(h, *depths[lane]));
+    }
 
-    // V1
-    set_mac1(sign_extend1(sign_extend1((get_trx() << 12) + get_rt11() * get_vx1()) + get_rt12() * get_vy1()) + get_rt13() * get_vz1(), sf * 12);
-    set_mac2(sign_extend2(sign_extend2((get_try() << 12) + get_rt21() * get_vx1()) + get_rt22() * get_vy1()) + get_rt23() * get_vz1(), sf * 12);
-    temp_mac3 = sign_extend3(sign_extend3((get_trz() << 12) + get_rt31() * get_vx1()) + get_rt32() * get_vy1()) + get_rt33() * get_vz1();
-    set_mac3(temp_mac3, sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3_special(get_mac3(), temp_mac3 >> 12, lm);
+    for (uint32_t lane = 0; lane < 3; ++lane) {
+        push_sxy_queue();
+        set_mac0(divisions[lane] * ir[0][lane] + get_ofx());
+        set_sx2(get_mac0() >> 16);
+        set_mac0(divisions[lane] * ir[1][lane] + get_ofy());
+        set_sy2(get_mac0() >> 16);
+    }
+    // Depth cueing of the last vertex only
+    set_mac0(divisions[2] * get_dqa() + get_dqb());
+    set_ir0(get_mac0() >> 12);
+}
 
-    push_sz_queue();
-    set_sz3(temp_mac3 >> 12);
+void GTE::MVMVA() {
+    LOGT_GTE(std::format("MVMVA"));
 
-    push_sxy_queue();
-    division = static_cast<int64_t>(unr_division(h, sz3));
+    // Matrix (bits 18-17), vector (16-15), translation (14-13), sf (19) and lm (10)
+    uint32_t variant = (((instruction >> 13) & 0x7F) << 1) | lm;
+    (this->*mvmva_variants[variant])();
+}
 
-    set_mac0(division * get_ir1() + get_ofx());
-    set_sx2(get_mac0() >> 16);
-    set_mac0(division * get_ir2() + get_ofy());
-    set_sy2(get_mac0() >> 16);
-    //set_mac0(division * get_dqa() + get_dqb());
-    //set_ir0(get_mac0() >> 12);
+template<size_t... I>
+constexpr std::array<GTE::Opcode, 256> GTE::mvmva_variant_table(std::index_sequence<I...>) {
+    return {mvmva_variant<I>()...};
+}
 
-    // V2
-    set_mac1(sign_extend1(sign_extend1((get_trx() << 12) + get_rt11() * get_vx2()) + get_rt12() * get_vy2()) + get_rt13() * get_vz2(), sf * 12);
-    set_mac2(sign_extend2(sign_extend2((get_try() << 12) + get_rt21() * get_vx2()) + get_rt22() * get_vy2()) + get_rt23() * get_vz2(), sf * 12);
-    temp_mac3 = sign_extend3(sign_extend3((get_trz() << 12) + get_rt31() * get_vx2()) + get_rt32() * get_vy2()) + get_rt33() * get_vz2();
-    set_mac3(temp_mac3, sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3_special(get_mac3(), temp_mac3 >> 12, lm);
+template<size_t I>
+constexpr GTE::Opcode GTE::mvmva_variant() {
+    constexpr uint8_t matrix_selection = (I >> 5) & 0x3; // 0 = Rotation, 1 = Light, 2 = Color, 3 = Reserved
+    constexpr uint8_t vector_selection = (I >> 3) & 0x3; // 0 = V0, 1 = V1, 2 = V2, 3 = IR
+    constexpr uint8_t translation_selection = (I >> 1) & 0x3; // 0 = TR, 1 = BK, 2 = FC (Bugged!), 3 = None
+    constexpr bool sf = (I >> 7) & 0x1;
+    constexpr bool lm = I & 0x1;
+    if constexpr (translation_selection == 2) {
+        return &GTE::MVMVA_far_color_variant<matrix_selection, vector_selection, sf, lm>;
+    } else {
+        return &GTE::MVMVA_variant<matrix_selection, vector_selection, translation_selection, sf, lm>;
+    }
+}
 
-    push_sz_queue();
-    set_sz3(temp_mac3 >> 12);
+const std::array<GTE::Opcode, 256> GTE::mvmva_variants = GTE::mvmva_variant_table(std::make_index_sequence<256>());
 
-    push_sxy_queue();
-    division = static_cast<int64_t>(unr_division(h, sz3));
+template<uint8_t matrix_selection>
+void GTE::get_mvmva_matrix(int64_t (&m)[9]) const {
+    if constexpr (matrix_selection == 3) {
+        // Garbage Matrix
+        int64_t r = get_r();
+        m[0] = -r * 0x10;
+        m[1] = r * 0x10;
+        m[2] = get_ir0();
+        m[3] = m[4] = m[5] = get_rt13();
+        m[6] = m[7] = m[8] = get_rt22();
+    } else {
+        const int16_t *matrix = matrix_selection == 0 ? rotation_matrix
+            : matrix_selection == 1 ? light_source_matrix : light_color_matrix_source;
+        for (uint32_t i = 0; i < 9; ++i) {
+            m[i] = matrix[i];
+        }
+    }
+}
 
-    set_mac0(division * get_ir1() + get_ofx());
-    set_sx2(get_mac0() >> 16);
-    set_mac0(division * get_ir2() + get_ofy());
-    set_sy2(get_mac0() >> 16);
-    set_mac0(division * get_dqa() + get_dqb());
-    set_ir0(get_mac0() >> 12);
+template<uint8_t vector_selection>
+void GTE::get_mvmva_vector(int64_t (&v)[3]) const {
+    if constexpr (vector_selection == 3) {
+        v[0] = get_ir1();
+        v[1] = get_ir2();
+        v[2] = get_ir3();
+    } else {
+        const Bit::int16_t_triple &vector = vector_selection == 0 ? v0 : vector_selection == 1 ? v1 : v2;
+        v[0] = vector.x;
+        v[1] = vector.y;
+        v[2] = vector.z;
+    }
 }
 
-void GTE::MVMVA() {
-    LOGT_GTE(std::format("MVMVA"));
+template<uint8_t matrix_selection, uint8_t vector_selection, uint8_t translation_selection, bool sf, bool lm>
+void GTE::MVMVA_variant() {
+    int64_t m[9], v[3];
+    get_mvmva_matrix<matrix_selection>(m);
+    get_mvmva_vector<vector_selection>(v);
 
-    int64_t m11, m12, m13, m21, m22, m23, m31, m32, m33;
-    uint8_t mvmva_matrix = (instruction >> 17) & 0x3; // 0 = Rotation, 1 = Light, 2 = Color, 3 = Reserved
-    switch (mvmva_matrix) {
-        case 0:
-            m11 = get_rt11();
-            m12 = get_rt12();
-            m13 = get_rt13();
-            m21 = get_rt21();
-            m22 = get_rt22();
-            m23 = get_rt23();
-            m31 = get_rt31();
-            m32 = get_rt32();
-            m33 = get_rt33();
-            break;
-        case 1:
-            m11 = get_l11();
-            m12 = get_l12();
-            m13 = get_l13();
-            m21 = get_l21();
-            m22 = get_l22();
-            m23 = get_l23();
-            m31 = get_l31();
-            m32 = get_l32();
-            m33 = get_l33();
-            break;
-        case 2:
-            m11 = get_lr1();
-            m12 = get_lr2();
-            m13 = get_lr3();
-            m21 = get_lg1();
-            m22 = get_lg2();
-            m23 = get_lg3();
-            m31 = get_lb1();
-            m32 = get_lb2();
-            m33 = get_lb3();
-            break;
-        default: {
-            // Garbage Matrix
-            uint8_t r = get_r();
-            m11 = -r * 0x10;
-            m12 = r * 0x10;
-            m13 = get_ir0();
-            m21 = get_rt13();
-            m22 = get_rt13();
-            m23 = get_rt13();
-            m31 = get_rt22();
-            m32 = get_rt22();
-            m33 = get_rt22();
-            break;
-         }
+    int64_t t[3] = {0, 0, 0};
+    if constexpr (translation_selection != 3) {
+        const int32_t *translation = translation_selection == 0 ? translation_vector : background_color;
+        t[0] = translation[0];
+        t[1] = translation[1];
+        t[2] = translation[2];
     }
 
-    int64_t vx, vy, vz;
-    uint8_t mvmva_vector = (instruction >> 15) & 0x3; // 0 = V0, 1 = V1, 2 = V2, 3 = IR
-    switch (mvmva_vector) {
-        case 0:
-            vx = get_vx0();
-            vy = get_vy0();
-            vz = get_vz0();
-            break;
-        case 1:
-            vx = get_vx1();
-            vy = get_vy1();
-            vz = get_vz1();
-            break;
-        case 2:
-            vx = get_vx2();
-            vy = get_vy2();
-            vz = get_vz2();
-            break;
-        default:
-            vx = get_ir1();
-            vy = get_ir2();
-            vz = get_ir3();
-            break;
-    }
+    set_mac1(sign_extend1(sign_extend1((t[0] << 12) + m[0] * v[0]) + m[1] * v[1]) + m[2] * v[2], sf * 12);
+    set_mac2(sign_extend2(sign_extend2((t[1] << 12) + m[3] * v[0]) + m[4] * v[1]) + m[5] * v[2], sf * 12);
+    set_mac3(sign_extend3(sign_extend3((t[2] << 12) + m[6] * v[0]) + m[7] * v[1]) + m[8] * v[2], sf * 12);
+    set_ir1(get_mac1(), lm);
+    set_ir2(get_mac2(), lm);
+    set_ir3(get_mac3(), lm);
+}
 
-    int64_t tvx, tvy, tvz;
-    uint8_t mvmva_translation_vector = (instruction >> 13) & 0x3; // 0 = TR, 1 = BK, 2 = FC (Bugged!), 3 = None
-    switch (mvmva_translation_vector) {
-        case 0:
-            tvx = get_trx();
-            tvy = get_try();
-            tvz = get_trz();
-            break;
-        case 1:
-            tvx = get_rbk();
-            tvy = get_gbk();
-            tvz = get_bbk();
-            break;
-        case 2:
-            tvx = get_rfc();
-            tvy = get_gfc();
-            tvz = get_bfc();
-            break;
-        default:
-            tvx = 0;
-            tvy = 0;
-            tvz = 0;
-            break;
-    }
+template<uint8_t matrix_selection, uint8_t vector_selection, bool sf, bool lm>
+void GTE::MVMVA_far_color_variant() {
+    int64_t m[9], v[3];
+    get_mvmva_matrix<matrix_selection>(m);
+    get_mvmva_vector<vector_selection>(v);
 
-    if (mvmva_translation_vector == 2) {
-        // Bugged Computation
-        set_mac1((tvx << 12) + m11 * vx, sf * 12);
-        set_mac2((tvy << 12) + m21 * vx, sf * 12);
-        set_mac3((tvz << 12) + m31 * vx, sf * 12);
-        set_ir1(get_mac1(), false);
-        set_ir2(get_mac2(), false);
-        set_ir3(get_mac3(), false);
-
-        set_mac1(m12 * vy + m13 * vz, sf * 12);
-        set_mac2(m22 * vy + m23 * vz, sf * 12);
-        set_mac3(m32 * vy + m33 * vz, sf * 12);
-        set_ir1(get_mac1(), lm);
-        set_ir2(get_mac2(), lm);
-        set_ir3(get_mac3(), lm);
+    // Bugged Computation: the flags are set by the far color and the first column,
+    // the result only consists of the second and third column
+    set_mac1((get_rfc() << 12) + m[0] * v[0], sf * 12);
+    set_mac2((get_gfc() << 12) + m[3] * v[0], sf * 12);
+    set_mac3((get_bfc() << 12) + m[6] * v[0], sf * 12);
+    set_ir1(get_mac1(), false);
+    set_ir2(get_mac2(), false);
+    set_ir3(get_mac3(), false);
 
-    } else {
-        set_mac1(sign_extend1(sign_extend1((tvx << 12) + m11 * vx) + m12 * vy) + m13 * vz, sf * 12);
-        set_mac2(sign_extend2(sign_extend2((tvy << 12) + m21 * vx) + m22 * vy) + m23 * vz, sf * 12);
-        set_mac3(sign_extend3(sign_extend3((tvz << 12) + m31 * vx) + m32 * vy) + m33 * vz, sf * 12);
-        set_ir1(get_mac1(), lm);
-        set_ir2(get_mac2(), lm);
-        set_ir3(get_mac3(), lm);
-    }
+    set_mac1(m[1] * v[1] + m[2] * v[2], sf * 12);
+    set_mac2(m[4] * v[1] + m[5] * v[2], sf * 12);
+    set_mac3(m[7] * v[1] + m[8] * v[2], sf * 12);
+    set_ir1(get_mac1(), lm);
+    set_ir2(get_mac2(), lm);
+    set_ir3(get_mac3(), lm);
 }
 
 void GTE::DCPL() {
@@ -1231,78 +1476,19 @@ void GTE::DPCT() {
     // Depth Cue (Triple)
     LOGT_GTE(std::format("DPCT"));
 
-    // Read color values from RGB0 instead of RGBC
-    int64_t temp1 = get_r0() << 16;
-    int64_t temp2 = get_g0() << 16;
-    int64_t temp3 = get_b0() << 16;
-
-    set_mac1(((get_rfc() << 12) - temp1), sf * 12);
-    set_mac2(((get_gfc() << 12) - temp2), sf * 12);
-    set_mac3(((get_bfc() << 12) - temp3), sf * 12);
-    set_ir1(get_mac1(), false);
-    set_ir2(get_mac2(), false);
-    set_ir3(get_mac3(), false);
-
-    set_mac1(temp1 + get_ir1() * get_ir0(), sf * 12);
-    set_mac2(temp2 + get_ir2() * get_ir0(), sf * 12);
-    set_mac3(temp3 + get_ir3() * get_ir0(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    push_color_queue();
-    set_r2(get_mac1() >> 4);
-    set_g2(get_mac2() >> 4);
-    set_b2(get_mac3() >> 4);
-    set_c2(get_c());
-
-    temp1 = get_r0() << 16;
-    temp2 = get_g0() << 16;
-    temp3 = get_b0() << 16;
-
-    set_mac1(((get_rfc() << 12) - temp1), sf * 12);
-    set_mac2(((get_gfc() << 12) - temp2), sf * 12);
-    set_mac3(((get_bfc() << 12) - temp3), sf * 12);
-    set_ir1(get_mac1(), false);
-    set_ir2(get_mac2(), false);
-    set_ir3(get_mac3(), false);
-
-    set_mac1(temp1 + get_ir1() * get_ir0(), sf * 12);
-    set_mac2(temp2 + get_ir2() * get_ir0(), sf * 12);
-    set_mac3(temp3 + get_ir3() * get_ir0(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    push_color_queue();
-    set_r2(get_mac1() >> 4);
-    set_g2(get_mac2() >> 4);
-    set_b2(get_mac3() >> 4);
-    set_c2(get_c());
-
-    temp1 = get_r0() << 16;
-    temp2 = get_g0() << 16;
-    temp3 = get_b0() << 16;
-
-    set_mac1(((get_rfc() << 12) - temp1), sf * 12);
-    set_mac2(((get_gfc() << 12) - temp2), sf * 12);
-    set_mac3(((get_bfc() << 12) - temp3), sf * 12);
-    set_ir1(get_mac1(), false);
-    set_ir2(get_mac2(), false);
-    set_ir3(get_mac3(), false);
-
-    set_mac1(temp1 + get_ir1() * get_ir0(), sf * 12);
-    set_mac2(temp2 + get_ir2() * get_ir0(), sf * 12);
-    set_mac3(temp3 + get_ir3() * get_ir0(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
+    // Read color values from RGB0 (the three entries of the color queue, as it moves with every result) instead of RGBC
+    GTELaneVector colors;
+    const uint32_t queue[4] = {rgb0, rgb1, rgb2, rgb0};
+    for (uint32_t k = 0; k < 3; ++k) {
+        for (uint32_t lane = 0; lane < 4; ++lane) {
+            colors[k][lane] = (queue[lane] >> (8 * k)) & 0xFF;
+        }
+    }
 
-    push_color_queue();
-    set_r2(get_mac1() >> 4);
-    set_g2(get_mac2() >> 4);
-    set_b2(get_mac3() >> 4);
-    set_c2(get_c());
+    GTELaneVector mac, ir, rgb;
+    flags |= kernels().get_color(sf, lm, ColorStage::DEPTH_CUE)(colors, far_color, get_ir0(), mac, ir, rgb);
+    set_mac_ir_from_lane(mac, ir, 2);
+    push_color_lanes(rgb);
 }
 
 void GTE::INTPL() {
@@ -1375,65 +1561,16 @@ void GTE::NCT() {
     // Normal Color (Triple)
     LOGT_GTE(std::format("NCT"));
 
-    set_mac1(sign_extend1(get_l11() * get_vx0() + get_l12() * get_vy0()) + get_l13() * get_vz0(), sf * 12);
-    set_mac2(sign_extend2(get_l21() * get_vx0() + get_l22() * get_vy0()) + get_l23() * get_vz0(), sf * 12);
-    set_mac3(sign_extend3(get_l31() * get_vx0() + get_l32() * get_vy0()) + get_l33() * get_vz0(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    set_mac1(sign_extend1(sign_extend1((get_rbk() << 12) + get_lr1() * get_ir1()) + get_lr2() * get_ir2()) + get_lr3() * get_ir3(), sf * 12);
-    set_mac2(sign_extend2(sign_extend2((get_gbk() << 12) + get_lg1() * get_ir1()) + get_lg2() * get_ir2()) + get_lg3() * get_ir3(), sf * 12);
-    set_mac3(sign_extend3(sign_extend3((get_bbk() << 12) + get_lb1() * get_ir1()) + get_lb2() * get_ir2()) + get_lb3() * get_ir3(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    push_color_queue();
-    set_r2(get_mac1() >> 4);
-    set_g2(get_mac2() >> 4);
-    set_b2(get_mac3() >> 4);
-    set_c2(get_c());
-
-    set_mac1(sign_extend1(get_l11() * get_vx1() + get_l12() * get_vy1()) + get_l13() * get_vz1(), sf * 12);
-    set_mac2(sign_extend2(get_l21() * get_vx1() + get_l22() * get_vy1()) + get_l23() * get_vz1(), sf * 12);
-    set_mac3(sign_extend3(get_l31() * get_vx1() + get_l32() * get_vy1()) + get_l33() * get_vz1(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    set_mac1(sign_extend1(sign_extend1((get_rbk() << 12) + get_lr1() * get_ir1()) + get_lr2() * get_ir2()) + get_lr3() * get_ir3(), sf * 12);
-    set_mac2(sign_extend2(sign_extend2((get_gbk() << 12) + get_lg1() * get_ir1()) + get_lg2() * get_ir2()) + get_lg3() * get_ir3(), sf * 12);
-    set_mac3(sign_extend3(sign_extend3((get_bbk() << 12) + get_lb1() * get_ir1()) + get_lb2() * get_ir2()) + get_lb3() * get_ir3(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    push_color_queue();
-    set_r2(get_mac1() >> 4);
-    set_g2(get_mac2() >> 4);
-    set_b2(get_mac3() >> 4);
-    set_c2(get_c());
-
-    set_mac1(sign_extend1(get_l11() * get_vx2() + get_l12() * get_vy2()) + get_l13() * get_vz2(), sf * 12);
-    set_mac2(sign_extend2(get_l21() * get_vx2() + get_l22() * get_vy2()) + get_l23() * get_vz2(), sf * 12);
-    set_mac3(sign_extend3(get_l31() * get_vx2() + get_l32() * get_vy2()) + get_l33() * get_vz2(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    set_mac1(sign_extend1(sign_extend1((get_rbk() << 12) + get_lr1() * get_ir1()) + get_lr2() * get_ir2()) + get_lr3() * get_ir3(), sf * 12);
-    set_mac2(sign_extend2(sign_extend2((get_gbk() << 12) + get_lg1() * get_ir1()) + get_lg2() * get_ir2()) + get_lg3() * get_ir3(), sf * 12);
-    set_mac3(sign_extend3(sign_extend3((get_bbk() << 12) + get_lb1() * get_ir1()) + get_lb2() * get_ir2()) + get_lb3() * get_ir3(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    push_color_queue();
-    set_r2(get_mac1() >> 4);
-    set_g2(get_mac2() >> 4);
-    set_b2(get_mac3() >> 4);
-    set_c2(get_c());
+    GTELaneVector mac, ir, rgb;
+    GTELanes unused;
+    const Kernels &selected = kernels();
+    uint32_t new_flags = selected.get_matrix(sf, lm, false)(light_source_matrix, no_translation, get_vector_lanes(), mac, ir, unused);
+    GTELaneVector light = ir;
+    new_flags |= selected.get_matrix(sf, lm, false)(light_color_matrix_source, background_color, light, mac, ir, unused);
+    new_flags |= selected.get_color(sf, lm, ColorStage::NONE)(get_color_lanes(), far_color, get_ir0(), mac, ir, rgb);
+    flags |= new_flags;
+    set_mac_ir_from_lane(mac, ir, 2);
+    push_color_lanes(rgb);
 }
 
 void GTE::NCDS() {
@@ -1483,119 +1620,16 @@ void GTE::NCDT() {
     // Normal Color Depth Cue (Triple)
     LOGT_GTE(std::format("NCDT"));
 
-    set_mac1(sign_extend1(get_l11() * get_vx0() + get_l12() * get_vy0()) + get_l13() * get_vz0(), sf * 12);
-    set_mac2(sign_extend2(get_l21() * get_vx0() + get_l22() * get_vy0()) + get_l23() * get_vz0(), sf * 12);
-    set_mac3(sign_extend3(get_l31() * get_vx0() + get_l32() * get_vy0()) + get_l33() * get_vz0(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    set_mac1(sign_extend1(sign_extend1((get_rbk() << 12) + get_lr1() * get_ir1()) + get_lr2() * get_ir2()) + get_lr3() * get_ir3(), sf * 12);
-    set_mac2(sign_extend2(sign_extend2((get_gbk() << 12) + get_lg1() * get_ir1()) + get_lg2() * get_ir2()) + get_lg3() * get_ir3(), sf * 12);
-    set_mac3(sign_extend3(sign_extend3((get_bbk() << 12) + get_lb1() * get_ir1()) + get_lb2() * get_ir2()) + get_lb3() * get_ir3(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    int64_t temp1 = (get_r() * get_ir1()) << 4;
-    int64_t temp2 = (get_g() * get_ir2()) << 4;
-    int64_t temp3 = (get_b() * get_ir3()) << 4;
-
-    set_mac1(((get_rfc() << 12) - temp1), sf * 12);
-    set_mac2(((get_gfc() << 12) - temp2), sf * 12);
-    set_mac3(((get_bfc() << 12) - temp3), sf * 12);
-    set_ir1(get_mac1(), false);
-    set_ir2(get_mac2(), false);
-    set_ir3(get_mac3(), false);
-
-    set_mac1(temp1 + get_ir1() * get_ir0(), sf * 12);
-    set_mac2(temp2 + get_ir2() * get_ir0(), sf * 12);
-    set_mac3(temp3 + get_ir3() * get_ir0(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    push_color_queue();
-    set_r2(get_mac1() >> 4);
-    set_g2(get_mac2() >> 4);
-    set_b2(get_mac3() >> 4);
-    set_c2(get_c());
-
-    set_mac1(sign_extend1(get_l11() * get_vx1() + get_l12() * get_vy1()) + get_l13() * get_vz1(), sf * 12);
-    set_mac2(sign_extend2(get_l21() * get_vx1() + get_l22() * get_vy1()) + get_l23() * get_vz1(), sf * 12);
-    set_mac3(sign_extend3(get_l31() * get_vx1() + get_l32() * get_vy1()) + get_l33() * get_vz1(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    set_mac1(sign_extend1(sign_extend1((get_rbk() << 12) + get_lr1() * get_ir1()) + get_lr2() * get_ir2()) + get_lr3() * get_ir3(), sf * 12);
-    set_mac2(sign_extend2(sign_extend2((get_gbk() << 12) + get_lg1() * get_ir1()) + get_lg2() * get_ir2()) + get_lg3() * get_ir3(), sf * 12);
-    set_mac3(sign_extend3(sign_extend3((get_bbk() << 12) + get_lb1() * get_ir1()) + get_lb2() * get_ir2()) + get_lb3() * get_ir3(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    temp1 = (get_r() * get_ir1()) << 4;
-    temp2 = (get_g() * get_ir2()) << 4;
-    temp3 = (get_b() * get_ir3()) << 4;
-
-    set_mac1(((get_rfc() << 12) - temp1), sf * 12);
-    set_mac2(((get_gfc() << 12) - temp2), sf * 12);
-    set_mac3(((get_bfc() << 12) - temp3), sf * 12);
-    set_ir1(get_mac1(), false);
-    set_ir2(get_mac2(), false);
-    set_ir3(get_mac3(), false);
-
-    set_mac1(temp1 + get_ir1() * get_ir0(), sf * 12);
-    set_mac2(temp2 + get_ir2() * get_ir0(), sf * 12);
-    set_mac3(temp3 + get_ir3() * get_ir0(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    push_color_queue();
-    set_r2(get_mac1() >> 4);
-    set_g2(get_mac2() >> 4);
-    set_b2(get_mac3() >> 4);
-    set_c2(get_c());
-
-    set_mac1(sign_extend1(get_l11() * get_vx2() + get_l12() * get_vy2()) + get_l13() * get_vz2(), sf * 12);
-    set_mac2(sign_extend2(get_l21() * get_vx2() + get_l22() * get_vy2()) + get_l23() * get_vz2(), sf * 12);
-    set_mac3(sign_extend3(get_l31() * get_vx2() + get_l32() * get_vy2()) + get_l33() * get_vz2(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    set_mac1(sign_extend1(sign_extend1((get_rbk() << 12) + get_lr1() * get_ir1()) + get_lr2() * get_ir2()) + get_lr3() * get_ir3(), sf * 12);
-    set_mac2(sign_extend2(sign_extend2((get_gbk() << 12) + get_lg1() * get_ir1()) + get_lg2() * get_ir2()) + get_lg3() * get_ir3(), sf * 12);
-    set_mac3(sign_extend3(sign_extend3((get_bbk() << 12) + get_lb1() * get_ir1()) + get_lb2() * get_ir2()) + get_lb3() * get_ir3(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    temp1 = (get_r() * get_ir1()) << 4;
-    temp2 = (get_g() * get_ir2()) << 4;
-    temp3 = (get_b() * get_ir3()) << 4;
-
-    set_mac1(((get_rfc() << 12) - temp1), sf * 12);
-    set_mac2(((get_gfc() << 12) - temp2), sf * 12);
-    set_mac3(((get_bfc() << 12) - temp3), sf * 12);
-    set_ir1(get_mac1(), false);
-    set_ir2(get_mac2(), false);
-    set_ir3(get_mac3(), false);
-
-    set_mac1(temp1 + get_ir1() * get_ir0(), sf * 12);
-    set_mac2(temp2 + get_ir2() * get_ir0(), sf * 12);
-    set_mac3(temp3 + get_ir3() * get_ir0(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    push_color_queue();
-    set_r2(get_mac1() >> 4);
-    set_g2(get_mac2() >> 4);
-    set_b2(get_mac3() >> 4);
-    set_c2(get_c());
+    GTELaneVector mac, ir, rgb;
+    GTELanes unused;
+    const Kernels &selected = kernels();
+    uint32_t new_flags = selected.get_matrix(sf, lm, false)(light_source_matrix, no_translation, get_vector_lanes(), mac, ir, unused);
+    GTELaneVector light = ir;
+    new_flags |= selected.get_matrix(sf, lm, false)(light_color_matrix_source, background_color, light, mac, ir, unused);
+    new_flags |= selected.get_color(sf, lm, ColorStage::COLOR_DEPTH_CUE)(get_color_lanes(), far_color, get_ir0(), mac, ir, rgb);
+    flags |= new_flags;
+    set_mac_ir_from_lane(mac, ir, 2);
+    push_color_lanes(rgb);
 }
 
 void GTE::NCCS() {
@@ -1634,86 +1668,16 @@ void GTE::NCCT() {
     // Normal Color Color (Triple)
     LOGT_GTE(std::format("NCCT"));
 
-    set_mac1(sign_extend1(get_l11() * get_vx0() + get_l12() * get_vy0()) + get_l13() * get_vz0(), sf * 12);
-    set_mac2(sign_extend2(get_l21() * get_vx0() + get_l22() * get_vy0()) + get_l23() * get_vz0(), sf * 12);
-    set_mac3(sign_extend3(get_l31() * get_vx0() + get_l32() * get_vy0()) + get_l33() * get_vz0(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    set_mac1(sign_extend1(sign_extend1((get_rbk() << 12) + get_lr1() * get_ir1()) + get_lr2() * get_ir2()) + get_lr3() * get_ir3(), sf * 12);
-    set_mac2(sign_extend2(sign_extend2((get_gbk() << 12) + get_lg1() * get_ir1()) + get_lg2() * get_ir2()) + get_lg3() * get_ir3(), sf * 12);
-    set_mac3(sign_extend3(sign_extend3((get_bbk() << 12) + get_lb1() * get_ir1()) + get_lb2() * get_ir2()) + get_lb3() * get_ir3(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    set_mac1((get_r() * get_ir1()) << 4, sf * 12);
-    set_mac2((get_g() * get_ir2()) << 4, sf * 12);
-    set_mac3((get_b() * get_ir3()) << 4, sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    push_color_queue();
-    set_r2(get_mac1() >> 4);
-    set_g2(get_mac2() >> 4);
-    set_b2(get_mac3() >> 4);
-    set_c2(get_c());
-
-    set_mac1(sign_extend1(get_l11() * get_vx1() + get_l12() * get_vy1()) + get_l13() * get_vz1(), sf * 12);
-    set_mac2(sign_extend2(get_l21() * get_vx1() + get_l22() * get_vy1()) + get_l23() * get_vz1(), sf * 12);
-    set_mac3(sign_extend3(get_l31() * get_vx1() + get_l32() * get_vy1()) + get_l33() * get_vz1(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    set_mac1(sign_extend1(sign_extend1((get_rbk() << 12) + get_lr1() * get_ir1()) + get_lr2() * get_ir2()) + get_lr3() * get_ir3(), sf * 12);
-    set_mac2(sign_extend2(sign_extend2((get_gbk() << 12) + get_lg1() * get_ir1()) + get_lg2() * get_ir2()) + get_lg3() * get_ir3(), sf * 12);
-    set_mac3(sign_extend3(sign_extend3((get_bbk() << 12) + get_lb1() * get_ir1()) + get_lb2() * get_ir2()) + get_lb3() * get_ir3(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    set_mac1((get_r() * get_ir1()) << 4, sf * 12);
-    set_mac2((get_g() * get_ir2()) << 4, sf * 12);
-    set_mac3((get_b() * get_ir3()) << 4, sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    push_color_queue();
-    set_r2(get_mac1() >> 4);
-    set_g2(get_mac2() >> 4);
-    set_b2(get_mac3() >> 4);
-    set_c2(get_c());
-
-    set_mac1(sign_extend1(get_l11() * get_vx2() + get_l12() * get_vy2()) + get_l13() * get_vz2(), sf * 12);
-    set_mac2(sign_extend2(get_l21() * get_vx2() + get_l22() * get_vy2()) + get_l23() * get_vz2(), sf * 12);
-    set_mac3(sign_extend3(get_l31() * get_vx2() + get_l32() * get_vy2()) + get_l33() * get_vz2(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    set_mac1(sign_extend1(sign_extend1((get_rbk() << 12) + get_lr1() * get_ir1()) + get_lr2() * get_ir2()) + get_lr3() * get_ir3(), sf * 12);
-    set_mac2(sign_extend2(sign_extend2((get_gbk() << 12) + get_lg1() * get_ir1()) + get_lg2() * get_ir2()) + get_lg3() * get_ir3(), sf * 12);
-    set_mac3(sign_extend3(sign_extend3((get_bbk() << 12) + get_lb1() * get_ir1()) + get_lb2() * get_ir2()) + get_lb3() * get_ir3(), sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    set_mac1((get_r() * get_ir1()) << 4, sf * 12);
-    set_mac2((get_g() * get_ir2()) << 4, sf * 12);
-    set_mac3((get_b() * get_ir3()) << 4, sf * 12);
-    set_ir1(get_mac1(), lm);
-    set_ir2(get_mac2(), lm);
-    set_ir3(get_mac3(), lm);
-
-    push_color_queue();
-    set_r2(get_mac1() >> 4);
-    set_g2(get_mac2() >> 4);
-    set_b2(get_mac3() >> 4);
-    set_c2(get_c());
+    GTELaneVector mac, ir, rgb;
+    GTELanes unused;
+    const Kernels &selected = kernels();
+    uint32_t new_flags = selected.get_matrix(sf, lm, false)(light_source_matrix, no_translation, get_vector_lanes(), mac, ir, unused);
+    GTELaneVector light = ir;
+    new_flags |= selected.get_matrix(sf, lm, false)(light_color_matrix_source, background_color, light, mac, ir, unused);
+    new_flags |= selected.get_color(sf, lm, ColorStage::COLOR)(get_color_lanes(), far_color, get_ir0(), mac, ir, rgb);
+    flags |= new_flags;
+    set_mac_ir_from_lane(mac, ir, 2);
+    push_color_lanes(rgb);
 }
 
 void GTE::CDP() {
@@ -1,8 +1,16 @@
 #ifndef PSX_GTE_H
 #define PSX_GTE_H
 
+#include <array>
 #include <cstdint>
 #include <iostream>
+#include <string>
+#include <utility>
+
+#ifdef GTE_PROFILE
+#include <chrono>
+#include <mutex>
+#endif
 
 #include "util/bit.h"
 
@@ -103,6 +111,27 @@ namespace PSX {
 #define GTE_REG_ZSF4 62
 #define GTE_REG_FLAGS 63
 
+// One register for each of the three vertices (or colors) of a triple command.
+// Lane 3 repeats lane 0, so that four-lane kernels set the same flags as three lanes.
+typedef std::array<int64_t, 4> GTELanes;
+// Components 1...3 (X, Y, Z or R, G, B) of a triple command
+typedef std::array<GTELanes, 3> GTELaneVector;
+
+#ifdef GTE_PROFILE
+// The commands executed during one frame (built with PSX_GTE_PROFILE only)
+struct GTEProfile {
+    std::array<uint64_t, 64> calls; // by function field
+    std::array<uint64_t, 64> nanoseconds; // host time, by function field
+    std::array<uint64_t, 32> flags; // commands that set the bit of FLAG
+
+    GTEProfile();
+    void reset();
+    uint64_t total_calls() const;
+    // The commands by host time and the flags that were set, one per line
+    std::string report() const;
+};
+#endif
+
 class GTE {
 private:
     uint16_t unr_table[0x101];
@@ -122,8 +151,8 @@ private:
     uint32_t reserved;                         // RES1
     int64_t mac0;                              // MAC0 // larger than 32 bit internally
     int32_t mac1, mac2, mac3;                  // MAC1, MAC2, MAC3 // 44 bit
-    uint32_t rgb;                              // IRGB, ORGB
     uint32_t lzcs;                             // LZCS, (LZCR is computed when reading)
+                                               // IRGB, ORGB are computed from IR1, IR2, IR3 when reading
 
 
     // Control registers
@@ -138,13 +167,19 @@ private:
     int16_t dqa;                               // DQA
     int32_t dqb;                               // DQB
     int16_t zsf3, zsf4;                        // ZSF3, ZSF4
-    uint32_t flags;                            // FLAG
+    uint32_t flags;                            // FLAG (without the error bit, it is computed when reading)
 
     uint32_t instruction;
     bool lm;
     bool sf;
     uint8_t funct;
 
+#ifdef GTE_PROFILE
+    GTEProfile frame_profile;
+    mutable std::mutex profile_mutex;
+    GTEProfile last_frame_profile;
+#endif
+
     friend std::ostream& operator<<(std::ostream &os, const GTE &gte);
 
     static const char* REGISTER_NAMES[];
@@ -163,13 +198,26 @@ public:
 
     void execute(uint32_t instruction);
 
+#ifdef GTE_PROFILE
+    // Completes the profile of the current frame
+    void end_profile_frame();
+    // Profile of the last completed frame
+    GTEProfile get_profile() const;
+#endif
+
 private:
     /*
      * Helper functions for internal use
      */
+#ifdef GTE_PROFILE
+    void profile_command(uint8_t funct, std::chrono::steady_clock::duration duration);
+#endif
     void reset_flags();
-    void update_error_flag();
+    // The FLAG register as the CPU sees it
+    uint32_t get_flags() const;
     void set_flag(uint8_t flag);
+    // Without branching, for the checks of every intermediate result
+    void set_flag_if(bool condition, uint8_t flag);
 
     // Getters and setters for interaction with the CPU
     uint32_t get_register_as_uint32_t(uint8_t rt);
@@ -183,6 +231,13 @@ private:
     void push_sxy_queue();
     void push_sz_queue();
     void push_color_queue();
+    // For the triple commands
+    GTELaneVector get_vector_lanes() const;
+    GTELaneVector get_color_lanes() const;
+    // MAC1...MAC3 and IR1...IR3 end up with the results of the last vertex
+    void set_mac_ir_from_lane(const GTELaneVector &mac, const GTELaneVector &ir, uint32_t lane);
+    // Pushes the three colors, with the code of RGBC
+    void push_color_lanes(const GTELaneVector &colors);
 
     /*
      * Setters for internal use
@@ -198,10 +253,14 @@ private:
     void set_ir2_without_clamping(int64_t value);
     void set_ir3_without_clamping(int64_t value);
     void set_irgb(uint32_t value);
+    uint32_t get_orgb() const;
 
     void set_otz(int64_t value);
     void set_sz3(int64_t value);
 
+    // Set the overflow flags of MAC0 (32 bit) or MAC1...MAC3 (44 bit), the value is not changed
+    void check_mac0_overflow(int64_t value);
+    void check_mac_overflow(int64_t value, uint8_t pos_flag, uint8_t neg_flag);
     void set_mac0(int64_t value);
     void set_mac1(int64_t value, uint8_t shift = 0);
     void set_mac2(int64_t value, uint8_t shift = 0);
@@ -320,6 +379,21 @@ private:
     void RTPS();
     void RTPT();
     void MVMVA();
+    // MVMVA for each matrix, vector and translation selection, sf, and lm (table indexed by instruction bits 19...13, 10)
+    static const std::array<Opcode, 256> mvmva_variants;
+    template<size_t... I>
+    static constexpr std::array<Opcode, 256> mvmva_variant_table(std::index_sequence<I...>);
+    template<size_t I>
+    static constexpr Opcode mvmva_variant();
+    template<uint8_t matrix_selection, uint8_t vector_selection, uint8_t translation_selection, bool sf, bool lm>
+    void MVMVA_variant();
+    // The far color translation is bugged, it has its own variant
+    template<uint8_t matrix_selection, uint8_t vector_selection, bool sf, bool lm>
+    void MVMVA_far_color_variant();
+    template<uint8_t matrix_selection>
+    void get_mvmva_matrix(int64_t (&m)[9]) const;
+    template<uint8_t vector_selection>
+    void get_mvmva_vector(int64_t (&v)[3]) const;
     void DCPL();
     void DPCS();
     void DPCT();
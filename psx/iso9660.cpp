@@ -0,0 +1,220 @@
+#include "iso9660.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <format>
+
+#include "exceptions/exceptions.h"
+#include "util/log.h"
+
+using namespace util;
+
+namespace PSX {
+
+namespace {
+
+// Volume descriptor
+const uint32_t DESCRIPTOR_TYPE = 0;
+const uint32_t DESCRIPTOR_IDENTIFIER = 1;
+const uint32_t DESCRIPTOR_VOLUME_ID = 40;
+const uint32_t DESCRIPTOR_ROOT_RECORD = 156;
+const uint8_t DESCRIPTOR_TYPE_PRIMARY = 1;
+const uint8_t DESCRIPTOR_TYPE_TERMINATOR = 255;
+
+// Directory record
+const uint32_t RECORD_LENGTH = 0;
+const uint32_t RECORD_LBA = 2;
+const uint32_t RECORD_SIZE = 10;
+const uint32_t RECORD_FLAGS = 25;
+const uint32_t RECORD_NAME_LENGTH = 32;
+const uint32_t RECORD_NAME = 33;
+const uint8_t RECORD_FLAG_DIRECTORY = 0x2;
+
+uint32_t read_u32(const uint8_t *data) {
+    // Both-endian fields, use the little endian half
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+// Upper case without version and trailing dot (files without extension are "NAME.;1")
+std::string normalize_name(std::string name) {
+    name = name.substr(0, name.find(';'));
+    if (!name.empty() && name.back() == '.') {
+        name.pop_back();
+    }
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::toupper(c); });
+    return name;
+}
+
+}
+
+ISO9660::ISO9660(const CD &cd)
+    : cd(cd) {
+    for (uint32_t lba = ISO9660_VOLUME_DESCRIPTORS_LBA; ; ++lba) {
+        const uint8_t *descriptor = read_block(lba);
+        if (std::memcmp(&descriptor[DESCRIPTOR_IDENTIFIER], "CD001", 5) != 0
+            || descriptor[DESCRIPTOR_TYPE] == DESCRIPTOR_TYPE_TERMINATOR) {
+            throw exceptions::FileReadError("No ISO9660 primary volume descriptor found");
+        }
+
+        if (descriptor[DESCRIPTOR_TYPE] == DESCRIPTOR_TYPE_PRIMARY) {
+            volume_id.assign((const char*)&descriptor[DESCRIPTOR_VOLUME_ID], 32);
+            volume_id.erase(volume_id.find_last_not_of(' ') + 1);
+
+            const uint8_t *root = &descriptor[DESCRIPTOR_ROOT_RECORD];
+            entries[""] = Extent{read_u32(&root[RECORD_LBA]), read_u32(&root[RECORD_SIZE]), true};
+            break;
+        }
+    }
+
+    LOG_CDIMG(std::format("ISO9660 volume \"{:s}\", root directory at block {:d}", volume_id, entries[""].lba));
+}
+
+bool ISO9660::open(const std::string &path, Extent &extent) {
+    std::string normalized = normalize_path(path);
+
+    // Expand the directories along the path
+    std::string directory;
+    std::string::size_type start = 0;
+    while (true) {
+        if (!expand(directory)) {
+            return false;
+        }
+
+        std::string::size_type slash = normalized.find('/', start);
+        if (slash == std::string::npos) {
+            break;
+        }
+        directory = normalized.substr(0, slash);
+        start = slash + 1;
+    }
+
+    auto it = entries.find(normalized);
+    if (it == entries.end()) {
+        LOGV_CDIMG(std::format("ISO9660: \"{:s}\" not found", path));
+        return false;
+    }
+
+    extent = it->second;
+    return true;
+}
+
+std::vector<std::string> ISO9660::list(const std::string &path) {
+    std::vector<std::string> paths;
+
+    std::string directory = normalize_path(path);
+    Extent extent;
+    if (!open(directory, extent) || !expand(directory)) {
+        return paths;
+    }
+
+    std::string prefix = directory.empty() ? "" : directory + "/";
+    for (const auto& [entry_path, entry] : entries) {
+        if (entry_path.size() > prefix.size() && entry_path.starts_with(prefix)
+            && entry_path.find('/', prefix.size()) == std::string::npos) {
+            paths.push_back(entry_path);
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    return paths;
+}
+
+std::vector<uint8_t> ISO9660::read(const Extent &extent) {
+    std::vector<uint8_t> data(extent.size);
+
+    for (uint32_t offset = 0; offset < extent.size; offset += ISO9660_BLOCK_SIZE) {
+        const uint8_t *block = read_block(extent.lba + offset / ISO9660_BLOCK_SIZE);
+        std::memcpy(&data[offset], block, std::min<uint32_t>(ISO9660_BLOCK_SIZE, extent.size - offset));
+    }
+
+    return data;
+}
+
+const std::string& ISO9660::get_volume_id() const {
+    return volume_id;
+}
+
+std::string ISO9660::normalize_path(const std::string &path) {
+    std::string p = path;
+    if (p.size() >= 6 && normalize_name(p.substr(0, 6)) == "CDROM:") {
+        p.erase(0, 6);
+    }
+    std::replace(p.begin(), p.end(), '\\', '/');
+
+    std::string normalized;
+    std::string::size_type start = 0;
+    while (start <= p.size()) {
+        std::string::size_type end = std::min(p.find('/', start), p.size());
+        std::string component = normalize_name(p.substr(start, end - start));
+        if (!component.empty()) {
+            if (!normalized.empty()) {
+                normalized += '/';
+            }
+            normalized += component;
+        }
+        start = end + 1;
+    }
+
+    return normalized;
+}
+
+uint32_t ISO9660::lba_to_position(uint32_t lba) {
+    return lba + CD_TWO_SECONDS;
+}
+
+const uint8_t* ISO9660::read_block(uint32_t lba) {
+    if (!cd.copy_sector(lba_to_position(lba), sector.data())) {
+        throw exceptions::FileReadError(std::format("ISO9660: Block {:d} is beyond the end of the disc", lba));
+    }
+
+    // Mode byte of the header
+    if (sector[CD_MODE2_HEADER_OFFSET + 3] == 1) {
+        return &sector[ISO9660_MODE1_DATA_OFFSET];
+    }
+    return &sector[CD_MODE2_DATA_OFFSET];
+}
+
+bool ISO9660::expand(const std::string &directory) {
+    auto it = entries.find(directory);
+    if (it == entries.end() || !it->second.directory) {
+        return false;
+    }
+    if (expanded_directories.contains(directory)) {
+        return true;
+    }
+
+    Extent extent = it->second;
+    LOGV_CDIMG(std::format("ISO9660: Reading directory \"{:s}\" at block {:d}", directory, extent.lba));
+
+    for (uint32_t offset = 0; offset < extent.size; offset += ISO9660_BLOCK_SIZE) {
+        const uint8_t *block = read_block(extent.lba + offset / ISO9660_BLOCK_SIZE);
+
+        // Records do not cross block boundaries, the rest of a block is zero
+        uint32_t position = 0;
+        while (position + RECORD_NAME < ISO9660_BLOCK_SIZE && block[position + RECORD_LENGTH] != 0) {
+            const uint8_t *record = &block[position];
+            uint32_t length = record[RECORD_LENGTH];
+            uint32_t name_length = record[RECORD_NAME_LENGTH];
+            if (length <= RECORD_NAME || position + length > ISO9660_BLOCK_SIZE || RECORD_NAME + name_length > length) {
+                LOGW_CDIMG(std::format("ISO9660: Invalid directory record in \"{:s}\"", directory));
+                break;
+            }
+
+            // Skip "." and ".."
+            bool self_or_parent = name_length == 1 && (record[RECORD_NAME] == 0 || record[RECORD_NAME] == 1);
+            if (!self_or_parent) {
+                std::string name = normalize_name(std::string((const char*)&record[RECORD_NAME], name_length));
+                std::string path = directory.empty() ? name : directory + "/" + name;
+                entries[path] = Extent{read_u32(&record[RECORD_LBA]), read_u32(&record[RECORD_SIZE]), (record[RECORD_FLAGS] & RECORD_FLAG_DIRECTORY) != 0};
+            }
+
+            position += length;
+        }
+    }
+
+    expanded_directories.insert(directory);
+    return true;
+}
+
+}
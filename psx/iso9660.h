@@ -0,0 +1,68 @@
+#ifndef PSX_ISO9660_H
+#define PSX_ISO9660_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "cd.h"
+
+namespace PSX {
+
+#define ISO9660_BLOCK_SIZE 2048
+// Logical block address of the first volume descriptor
+#define ISO9660_VOLUME_DESCRIPTORS_LBA 16
+#define ISO9660_MODE1_DATA_OFFSET 0x10
+
+// Read-only ISO9660 file system (with CD-XA extensions) of a CD.
+// Lookups go through a hash map of paths, a directory is only read
+// the first time a path through it is looked up.
+class ISO9660 {
+public:
+    struct Extent {
+        uint32_t lba; // logical block address, block 0 is at 00:02:00 on disc
+        uint32_t size; // in bytes
+        bool directory;
+    };
+
+private:
+    const CD &cd;
+    std::string volume_id;
+
+    // Normalized path (e.g., "MOVIE/INTRO.STR", "" is the root) of every entry of expanded directories
+    std::unordered_map<std::string, Extent> entries;
+    std::unordered_set<std::string> expanded_directories;
+
+    std::array<uint8_t, CD::SECTOR_SIZE> sector;
+
+public:
+    // Throws exceptions::FileReadError if the CD does not contain an ISO9660 file system
+    explicit ISO9660(const CD &cd);
+
+    // Accepts paths like "cdrom:\SLUS_123.45;1", "\SYSTEM.CNF" or "movie/intro.str", returns false if not found
+    bool open(const std::string &path, Extent &extent);
+    // Normalized paths of the entries of a directory
+    std::vector<std::string> list(const std::string &path);
+    // Contents of a file, form 2 sectors are read as 2048 bytes as well
+    std::vector<uint8_t> read(const Extent &extent);
+
+    const std::string& get_volume_id() const;
+
+    // Upper case, '/' as separator, without device, version (";1") and empty components
+    static std::string normalize_path(const std::string &path);
+    // Position on disc (in sectors) of a logical block
+    static uint32_t lba_to_position(uint32_t lba);
+
+private:
+    // The 2048 bytes of user data of a logical block
+    const uint8_t* read_block(uint32_t lba);
+    // Makes sure the entries of the directory are known, returns false if it is not a directory
+    bool expand(const std::string &directory);
+};
+
+}
+
+#endif
@@ -1,19 +1,383 @@
 #include "mdec.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <format>
 #include <sstream>
 #include <string>
+#include <thread>
 
 #include "bus.h"
 #include "exceptions/exceptions.h"
 #include "util/bit.h"
 #include "util/log.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#define MDEC_X86
+#include <immintrin.h>
+#endif
+
 using namespace util;
 
 namespace PSX {
 
+namespace {
+
+// One pass of the IDCT: out = (coefficients * matrix + 0x0FFF) / 0x2000 for 8x8 matrices (row major),
+// rounding toward zero. All values, including the results, have to fit into 16 bits.
+typedef void (*IDCTPassKernel)(const int16_t *coefficients, const int16_t *matrix, int16_t *out);
+
+void idct_pass_scalar(const int16_t *coefficients, const int16_t *matrix, int16_t *out) {
+    for (uint32_t i = 0; i < 8; ++i) {
+        for (uint32_t j = 0; j < 8; ++j) {
+            int32_t sum = 0;
+            for (uint32_t k = 0; k < 8; ++k) {
+                sum += coefficients[i * 8 + k] * matrix[k * 8 + j];
+            }
+            out[i * 8 + j] = (sum + 0x0FFF) / 0x2000;
+        }
+    }
+}
+
+#ifdef MDEC_X86
+// The factors of two neighbouring coefficients of a row, for multiplying with interleaved matrix rows
+inline int32_t coefficient_pair(const int16_t *coefficients) {
+    int32_t pair;
+    std::memcpy(&pair, coefficients, sizeof(pair));
+    return pair;
+}
+
+__attribute__((target("sse2")))
+inline __m128i divide_sse2(__m128i sum) {
+    sum = _mm_add_epi32(sum, _mm_set1_epi32(0x0FFF));
+    // Division rounds toward zero, the arithmetic shift rounds down
+    __m128i bias = _mm_and_si128(_mm_srai_epi32(sum, 31), _mm_set1_epi32(0x1FFF));
+    return _mm_srai_epi32(_mm_add_epi32(sum, bias), 13);
+}
+
+// Rows k and k + 1 of the matrix are interleaved, so that madd adds up two terms of the sums of four columns
+__attribute__((target("sse2")))
+void idct_pass_sse2(const int16_t *coefficients, const int16_t *matrix, int16_t *out) {
+    __m128i pairs_low[4], pairs_high[4];
+    for (uint32_t k = 0; k < 4; ++k) {
+        __m128i first = _mm_loadu_si128((const __m128i*)&matrix[16 * k]);
+        __m128i second = _mm_loadu_si128((const __m128i*)&matrix[16 * k + 8]);
+        pairs_low[k] = _mm_unpacklo_epi16(first, second);
+        pairs_high[k] = _mm_unpackhi_epi16(first, second);
+    }
+
+    for (uint32_t i = 0; i < 8; ++i) {
+        __m128i low = _mm_setzero_si128();
+        __m128i high = _mm_setzero_si128();
+        for (uint32_t k = 0; k < 4; ++k) {
+            __m128i factors = _mm_set1_epi32(coefficient_pair(&coefficients[i * 8 + 2 * k]));
+            low = _mm_add_epi32(low, _mm_madd_epi16(pairs_low[k], factors));
+            high = _mm_add_epi32(high, _mm_madd_epi16(pairs_high[k], factors));
+        }
+        _mm_storeu_si128((__m128i*)&out[i * 8], _mm_packs_epi32(divide_sse2(low), divide_sse2(high)));
+    }
+}
+
+__attribute__((target("avx2")))
+inline __m256i divide_avx2(__m256i sum) {
+    sum = _mm256_add_epi32(sum, _mm256_set1_epi32(0x0FFF));
+    __m256i bias = _mm256_and_si256(_mm256_srai_epi32(sum, 31), _mm256_set1_epi32(0x1FFF));
+    return _mm256_srai_epi32(_mm256_add_epi32(sum, bias), 13);
+}
+
+// Same as SSE2, with all eight columns of a row in one register and two rows per iteration
+__attribute__((target("avx2")))
+void idct_pass_avx2(const int16_t *coefficients, const int16_t *matrix, int16_t *out) {
+    __m256i pairs[4];
+    for (uint32_t k = 0; k < 4; ++k) {
+        __m128i first = _mm_loadu_si128((const __m128i*)&matrix[16 * k]);
+        __m128i second = _mm_loadu_si128((const __m128i*)&matrix[16 * k + 8]);
+        pairs[k] = _mm256_setr_m128i(_mm_unpacklo_epi16(first, second), _mm_unpackhi_epi16(first, second));
+    }
+
+    for (uint32_t i = 0; i < 8; i += 2) {
+        __m256i upper = _mm256_setzero_si256();
+        __m256i lower = _mm256_setzero_si256();
+        for (uint32_t k = 0; k < 4; ++k) {
+            __m256i upper_factors = _mm256_set1_epi32(coefficient_pair(&coefficients[i * 8 + 2 * k]));
+            __m256i lower_factors = _mm256_set1_epi32(coefficient_pair(&coefficients[i * 8 + 8 + 2 * k]));
+            upper = _mm256_add_epi32(upper, _mm256_madd_epi16(pairs[k], upper_factors));
+            lower = _mm256_add_epi32(lower, _mm256_madd_epi16(pairs[k], lower_factors));
+        }
+        // Packing works within 128-bit lanes, put the columns back into order
+        __m256i packed = _mm256_packs_epi32(divide_avx2(upper), divide_avx2(lower));
+        packed = _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256((__m256i*)&out[i * 8], packed);
+    }
+}
+#endif
+
+// Contributions of the chroma samples to red, green and blue of their 2x2 pixels
+struct ChromaTerms {
+    alignas(16) int16_t r[64];
+    alignas(16) int16_t g[64];
+    alignas(16) int16_t b[64];
+};
+
+// The kernels append a 16x16 macroblock (the four 8x8 luminance blocks are top left, top right, bottom left, bottom right)
+// or a monochrome 8x8 block to the output. Components are 8 bits, two's complement if signed, offset by 128 otherwise.
+typedef void (*ColorKernel)(const int16_t *const luminance[4], const ChromaTerms &chroma, bool is_signed, uint16_t bit15, uint16_t *out);
+typedef void (*MonochromeKernel)(const int16_t *luminance, bool is_signed, uint16_t *out);
+
+void compute_chroma_terms(const int16_t *cr, const int16_t *cb, ChromaTerms &terms) {
+    for (uint32_t i = 0; i < 64; ++i) {
+        float r_fl = cr[i];
+        float b_fl = cb[i];
+        float g_fl = -0.3437 * b_fl - 0.7143 * r_fl;
+        r_fl = 1.402 * r_fl;
+        b_fl = 1.772 * b_fl;
+
+        terms.r[i] = static_cast<int32_t>(r_fl);
+        terms.g[i] = static_cast<int32_t>(g_fl);
+        terms.b[i] = static_cast<int32_t>(b_fl);
+    }
+}
+
+inline uint8_t color_component(int32_t luminance, int32_t term, bool is_signed) {
+    int32_t value = std::clamp<int32_t>(luminance + term, -128, 127);
+    return is_signed ? value & 0xFF : value + 128;
+}
+
+inline uint8_t monochrome_component(int16_t luminance, bool is_signed) {
+    // The hardware only looks at the lower 10 bits
+    int32_t value = std::clamp<int32_t>(static_cast<int16_t>(luminance << 6) >> 6, -128, 127);
+    return is_signed ? value & 0xFF : value + 128;
+}
+
+// Calls write(pixel, chroma) for every pixel of the macroblock in order
+template <typename F>
+inline void for_each_pixel(const int16_t *const luminance[4], F write) {
+    for (uint32_t y = 0; y < 16; ++y) {
+        for (uint32_t x = 0; x < 16; ++x) {
+            write(luminance[(y / 8) * 2 + x / 8][(y % 8) * 8 + x % 8], (y / 2) * 8 + x / 2);
+        }
+    }
+}
+
+void convert_15_bit_scalar(const int16_t *const luminance[4], const ChromaTerms &chroma, bool is_signed, uint16_t bit15, uint16_t *out) {
+    for_each_pixel(luminance, [&](int16_t y, uint32_t c) {
+        uint8_t r = color_component(y, chroma.r[c], is_signed);
+        uint8_t g = color_component(y, chroma.g[c], is_signed);
+        uint8_t b = color_component(y, chroma.b[c], is_signed);
+        *(out++) = bit15 | ((b >> 3) << 10) | ((g >> 3) << 5) | (r >> 3);
+    });
+}
+
+// 24-bit pixels are written as bytes, halfwords are little endian just like on the host
+void convert_24_bit_scalar(const int16_t *const luminance[4], const ChromaTerms &chroma, bool is_signed, uint16_t, uint16_t *out) {
+    uint8_t *bytes = reinterpret_cast<uint8_t*>(out);
+    for_each_pixel(luminance, [&](int16_t y, uint32_t c) {
+        *(bytes++) = color_component(y, chroma.r[c], is_signed);
+        *(bytes++) = color_component(y, chroma.g[c], is_signed);
+        *(bytes++) = color_component(y, chroma.b[c], is_signed);
+    });
+}
+
+// The first pixel is in the lower nibble
+void monochrome_4_bit_scalar(const int16_t *luminance, bool is_signed, uint16_t *out) {
+    uint8_t *bytes = reinterpret_cast<uint8_t*>(out);
+    for (uint32_t i = 0; i < 64; i += 2) {
+        *(bytes++) = (monochrome_component(luminance[i], is_signed) >> 4) | (monochrome_component(luminance[i + 1], is_signed) & 0xF0);
+    }
+}
+
+void monochrome_8_bit_scalar(const int16_t *luminance, bool is_signed, uint16_t *out) {
+    uint8_t *bytes = reinterpret_cast<uint8_t*>(out);
+    for (uint32_t i = 0; i < 64; ++i) {
+        *(bytes++) = monochrome_component(luminance[i], is_signed);
+    }
+}
+
+#ifdef MDEC_X86
+// Saturating is fine, sums beyond 16 bits are clamped anyway. The offset is 0x80 for unsigned output.
+__attribute__((target("sse2")))
+inline __m128i color_component_sse2(__m128i luminance, __m128i term, __m128i offset) {
+    __m128i value = _mm_adds_epi16(luminance, term);
+    value = _mm_min_epi16(_mm_max_epi16(value, _mm_set1_epi16(-128)), _mm_set1_epi16(127));
+    return _mm_and_si128(_mm_xor_si128(value, offset), _mm_set1_epi16(0xFF));
+}
+
+__attribute__((target("sse2")))
+inline __m128i monochrome_component_sse2(__m128i luminance, __m128i offset) {
+    __m128i value = _mm_srai_epi16(_mm_slli_epi16(luminance, 6), 6);
+    value = _mm_min_epi16(_mm_max_epi16(value, _mm_set1_epi16(-128)), _mm_set1_epi16(127));
+    return _mm_and_si128(_mm_xor_si128(value, offset), _mm_set1_epi16(0xFF));
+}
+
+// Red, green and blue of eight pixels of a line of the macroblock, in 16-bit lanes.
+// The right half of a line uses the upper four chroma samples, each for two pixels.
+struct Colors {
+    __m128i r, g, b;
+};
+
+__attribute__((target("sse2")))
+inline Colors colors_sse2(const int16_t *const luminance[4], const ChromaTerms &chroma, uint32_t y, uint32_t half, __m128i offset) {
+    __m128i l = _mm_loadu_si128((const __m128i*)&luminance[(y / 8) * 2 + half][(y % 8) * 8]);
+    __m128i r = _mm_load_si128((const __m128i*)&chroma.r[(y / 2) * 8]);
+    __m128i g = _mm_load_si128((const __m128i*)&chroma.g[(y / 2) * 8]);
+    __m128i b = _mm_load_si128((const __m128i*)&chroma.b[(y / 2) * 8]);
+    if (half == 0) {
+        r = _mm_unpacklo_epi16(r, r);
+        g = _mm_unpacklo_epi16(g, g);
+        b = _mm_unpacklo_epi16(b, b);
+    } else {
+        r = _mm_unpackhi_epi16(r, r);
+        g = _mm_unpackhi_epi16(g, g);
+        b = _mm_unpackhi_epi16(b, b);
+    }
+    return Colors{color_component_sse2(l, r, offset), color_component_sse2(l, g, offset), color_component_sse2(l, b, offset)};
+}
+
+__attribute__((target("sse2")))
+void convert_15_bit_sse2(const int16_t *const luminance[4], const ChromaTerms &chroma, bool is_signed, uint16_t bit15, uint16_t *out) {
+    const __m128i offset = _mm_set1_epi16(is_signed ? 0 : 0x80);
+    const __m128i high_bit = _mm_set1_epi16(bit15);
+    const __m128i five_bits = _mm_set1_epi16(0x1F);
+
+    for (uint32_t y = 0; y < 16; ++y) {
+        for (uint32_t half = 0; half < 2; ++half) {
+            Colors colors = colors_sse2(luminance, chroma, y, half, offset);
+            __m128i r = _mm_srli_epi16(colors.r, 3);
+            __m128i g = _mm_slli_epi16(_mm_and_si128(_mm_srli_epi16(colors.g, 3), five_bits), 5);
+            __m128i b = _mm_slli_epi16(_mm_srli_epi16(colors.b, 3), 10);
+            __m128i pixels = _mm_or_si128(_mm_or_si128(r, g), _mm_or_si128(b, high_bit));
+            _mm_storeu_si128((__m128i*)&out[y * 16 + half * 8], pixels);
+        }
+    }
+}
+
+// Red, green and blue of a whole line of the macroblock as bytes
+__attribute__((target("sse2")))
+inline Colors line_colors_sse2(const int16_t *const luminance[4], const ChromaTerms &chroma, uint32_t y, __m128i offset) {
+    Colors left = colors_sse2(luminance, chroma, y, 0, offset);
+    Colors right = colors_sse2(luminance, chroma, y, 1, offset);
+    return Colors{_mm_packus_epi16(left.r, right.r), _mm_packus_epi16(left.g, right.g), _mm_packus_epi16(left.b, right.b)};
+}
+
+__attribute__((target("sse2")))
+void convert_24_bit_sse2(const int16_t *const luminance[4], const ChromaTerms &chroma, bool is_signed, uint16_t, uint16_t *out) {
+    const __m128i offset = _mm_set1_epi16(is_signed ? 0 : 0x80);
+    uint8_t *bytes = reinterpret_cast<uint8_t*>(out);
+
+    for (uint32_t y = 0; y < 16; ++y) {
+        Colors colors = line_colors_sse2(luminance, chroma, y, offset);
+        alignas(16) uint8_t r[16], g[16], b[16];
+        _mm_store_si128((__m128i*)r, colors.r);
+        _mm_store_si128((__m128i*)g, colors.g);
+        _mm_store_si128((__m128i*)b, colors.b);
+        for (uint32_t x = 0; x < 16; ++x) {
+            *(bytes++) = r[x];
+            *(bytes++) = g[x];
+            *(bytes++) = b[x];
+        }
+    }
+}
+
+// For each 16-byte part of 16 interleaved RGB pixels and each component: which component byte goes where (-1 for none)
+struct InterleaveMasks {
+    alignas(16) int8_t masks[3][3][16];
+
+    constexpr InterleaveMasks()
+        : masks() {
+        for (int part = 0; part < 3; ++part) {
+            for (int component = 0; component < 3; ++component) {
+                for (int i = 0; i < 16; ++i) {
+                    int position = 16 * part + i;
+                    masks[part][component][i] = position % 3 == component ? position / 3 : -1;
+                }
+            }
+        }
+    }
+};
+
+constexpr InterleaveMasks interleave_masks;
+
+__attribute__((target("ssse3")))
+void convert_24_bit_ssse3(const int16_t *const luminance[4], const ChromaTerms &chroma, bool is_signed, uint16_t, uint16_t *out) {
+    const __m128i offset = _mm_set1_epi16(is_signed ? 0 : 0x80);
+    __m128i *lines = reinterpret_cast<__m128i*>(out);
+
+    for (uint32_t y = 0; y < 16; ++y) {
+        Colors colors = line_colors_sse2(luminance, chroma, y, offset);
+        for (uint32_t part = 0; part < 3; ++part) {
+            const int8_t (&masks)[3][16] = interleave_masks.masks[part];
+            __m128i r = _mm_shuffle_epi8(colors.r, _mm_load_si128((const __m128i*)masks[0]));
+            __m128i g = _mm_shuffle_epi8(colors.g, _mm_load_si128((const __m128i*)masks[1]));
+            __m128i b = _mm_shuffle_epi8(colors.b, _mm_load_si128((const __m128i*)masks[2]));
+            _mm_storeu_si128(lines++, _mm_or_si128(_mm_or_si128(r, g), b));
+        }
+    }
+}
+
+__attribute__((target("sse2")))
+void monochrome_4_bit_sse2(const int16_t *luminance, bool is_signed, uint16_t *out) {
+    const __m128i offset = _mm_set1_epi16(is_signed ? 0 : 0x80);
+
+    for (uint32_t i = 0; i < 64; i += 32) {
+        // Two pixels per 32-bit lane, the second one into the upper nibble
+        __m128i bytes[4];
+        for (uint32_t j = 0; j < 4; ++j) {
+            __m128i nibbles = _mm_srli_epi16(monochrome_component_sse2(_mm_loadu_si128((const __m128i*)&luminance[i + 8 * j]), offset), 4);
+            bytes[j] = _mm_and_si128(_mm_or_si128(nibbles, _mm_srli_epi32(nibbles, 12)), _mm_set1_epi32(0xFF));
+        }
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(bytes[0], bytes[1]), _mm_packs_epi32(bytes[2], bytes[3]));
+        _mm_storeu_si128((__m128i*)&out[i / 4], packed);
+    }
+}
+
+__attribute__((target("sse2")))
+void monochrome_8_bit_sse2(const int16_t *luminance, bool is_signed, uint16_t *out) {
+    const __m128i offset = _mm_set1_epi16(is_signed ? 0 : 0x80);
+
+    for (uint32_t i = 0; i < 64; i += 16) {
+        __m128i first = monochrome_component_sse2(_mm_loadu_si128((const __m128i*)&luminance[i]), offset);
+        __m128i second = monochrome_component_sse2(_mm_loadu_si128((const __m128i*)&luminance[i + 8]), offset);
+        _mm_storeu_si128((__m128i*)&out[i / 2], _mm_packus_epi16(first, second));
+    }
+}
+#endif
+
+struct Kernels {
+    IDCTPassKernel idct_pass;
+    ColorKernel convert_15_bit;
+    ColorKernel convert_24_bit;
+    MonochromeKernel monochrome_4_bit;
+    MonochromeKernel monochrome_8_bit;
+
+    Kernels()
+        : idct_pass(idct_pass_scalar),
+          convert_15_bit(convert_15_bit_scalar),
+          convert_24_bit(convert_24_bit_scalar),
+          monochrome_4_bit(monochrome_4_bit_scalar),
+          monochrome_8_bit(monochrome_8_bit_scalar) {
+#ifdef MDEC_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            idct_pass = idct_pass_avx2;
+        } else {
+            idct_pass = idct_pass_sse2;
+        }
+        convert_15_bit = convert_15_bit_sse2;
+        convert_24_bit = __builtin_cpu_supports("ssse3") ? convert_24_bit_ssse3 : convert_24_bit_sse2;
+        monochrome_4_bit = monochrome_4_bit_sse2;
+        monochrome_8_bit = monochrome_8_bit_sse2;
+#endif
+    }
+};
+
+const Kernels& kernels() {
+    static const Kernels selected;
+    return selected;
+}
+
+}
+
 uint8_t MacroblockDecoder::zigzag[] = {
      0,  1,  5,  6, 14, 15, 27, 28,
      2,  4,  7, 13, 16, 26, 29, 42,
@@ -34,7 +398,7 @@ std::ostream& operator<<(std::ostream &os, const MacroblockDecoder &mdec) {
 uint32_t MacroblockDecoder::get_status_register() const {
     uint32_t reg = static_cast<uint32_t>(remaining_parameter_words);
 
-    Bit::setBit(reg, MDEC_STATUS_DATA_OUT_QUEUE_EMPTY, data_output_queue.empty());
+    Bit::setBit(reg, MDEC_STATUS_DATA_OUT_QUEUE_EMPTY, !output_available());
     Bit::setBit(reg, MDEC_STATUS_DATA_IN_QUEUE_FULL, received_all_parameters);
     Bit::setBit(reg, MDEC_STATUS_CMD_BUSY, state != State::IDLE);
     Bit::setBit(reg, MDEC_STATUS_DATA_IN_REQ, data_in_request());
@@ -80,13 +444,32 @@ void MacroblockDecoder::decode_macroblock(uint32_t command) {
     extract_data_output_bits(command);
     remaining_parameter_words = static_cast<uint16_t>(command & 0x0000'FFFF) - 1;
     LOGT_MDEC(std::format("Remaining parameter words (one was subtracted): 0x{:04X}", remaining_parameter_words));
+
+    scan_in_block = false;
+    scan_blocks = 0;
+    scan_macroblock_position = input_read_position + input_size;
+    current_block = 4; // Monochrome: Y, colored: Cr
+
+#ifdef MDEC_TRACE
+    // Dump encoding information
+    LOGT_MDEC(std::format("Data Output Depth: {:d}", data_output_depth));
+    LOGT_MDEC(std::format("Data Output Signed: {:s}", data_output_signed));
+    LOGT_MDEC(std::format("Data Output Bit 15: {:s}", data_output_bit15));
+
+    // Dump tables
+    LOGT_MDEC(std::format("Luminance Quantization Table ({:d} bytes):", luminance_quantization_table.size()));
+    trace_values_as_table(luminance_quantization_table.cbegin(), luminance_quantization_table.cend());
+    LOGT_MDEC(std::format("Color Quantization Table ({:d} bytes):", color_quantization_table.size()));
+    trace_values_as_table(color_quantization_table.cbegin(), color_quantization_table.cend());
+    LOGT_MDEC(std::format("Scale Table ({:d} halfwords):", scale_table.size()));
+    trace_values_as_table(scale_table.cbegin(), scale_table.cend());
+#endif
 }
 
 void MacroblockDecoder::set_iqtab(uint32_t command) {
     LOGT_MDEC("set_iqtab");
     state = State::CMD_SET_IQTAB;
-    luminance_quantization_table.clear();
-    color_quantization_table.clear();
+    table_entries = 0;
     extract_data_output_bits(command);
     if (!Bit::getBit(command, MDEC_CMD_COLOR)) {
         LOGT_MDEC(std::format("Luminance only, setting remaining parameter words to 64/4 - 1 = 15"));
@@ -100,7 +483,7 @@ void MacroblockDecoder::set_iqtab(uint32_t command) {
 void MacroblockDecoder::set_scale(uint32_t command) {
     LOGT_MDEC("set_scale");
     state = State::CMD_SET_SCALE;
-    scale_table.clear();
+    table_entries = 0;
     extract_data_output_bits(command);
     LOGT_MDEC(std::format("Setting remaining parameter words to 64/2 - 1 = 31"));
     remaining_parameter_words = 31;
@@ -114,6 +497,79 @@ void MacroblockDecoder::no_function(uint32_t command) {
     LOGT_MDEC(std::format("Remaining parameter words: 0x{:04X}", remaining_parameter_words));
 }
 
+void MacroblockDecoder::push_input(uint16_t value) {
+    // End-of-block padding before a macroblock is not needed for decoding, so it is not stored at all
+    if (value == MDEC_END_OF_BLOCK && !scan_in_block && scan_blocks == 0) {
+        return;
+    }
+    if (input_size == MDEC_INPUT_CAPACITY) {
+        LOGW_MDEC("Input queue overflow, dropping halfword");
+        return;
+    }
+    uint32_t position = input_read_position + input_size;
+    data_input[position & (MDEC_INPUT_CAPACITY - 1)] = value;
+    ++input_size;
+
+    scan_input(value, position);
+}
+
+void MacroblockDecoder::scan_input(uint16_t value, uint32_t position) {
+    if (value != MDEC_END_OF_BLOCK) {
+        scan_in_block = true;
+        return;
+    }
+
+    if (!scan_in_block) {
+        // Padding between the blocks of a macroblock (padding before a macroblock is not stored)
+        return;
+    }
+
+    scan_in_block = false;
+    ++scan_blocks;
+    if (scan_blocks == blocks_per_macroblock()) {
+        LOGT_MDEC(std::format("Received macroblock #{:d} of the batch", macroblock_positions.size()));
+        macroblock_positions.push_back(scan_macroblock_position);
+        scan_blocks = 0;
+        scan_macroblock_position = position + 1;
+    }
+
+    // Block that is received next, colored macroblocks are Cr, Cb, Y1...Y4
+    const uint8_t order[6] = {4, 5, 0, 1, 2, 3};
+    current_block = blocks_per_macroblock() == 1 ? 4 : order[scan_blocks];
+}
+
+uint16_t MacroblockDecoder::input_at(uint32_t position) const {
+    assert(position - input_read_position < input_size);
+    return data_input[position & (MDEC_INPUT_CAPACITY - 1)];
+}
+
+void MacroblockDecoder::drop_input(uint32_t halfwords) {
+    assert(halfwords <= input_size);
+    input_read_position += halfwords;
+    input_size -= halfwords;
+}
+
+bool MacroblockDecoder::output_empty() const {
+    return output_read_position == data_output.size();
+}
+
+bool MacroblockDecoder::output_available() const {
+    return !output_empty() || !macroblock_positions.empty();
+}
+
+uint16_t* MacroblockDecoder::reserve_output(uint32_t halfwords) {
+    // Drop what has been read already, this is little while output is read as it is decoded
+    if (output_read_position > 0) {
+        data_output.erase(data_output.begin(), data_output.begin() + output_read_position);
+        output_read_position = 0;
+    }
+
+    size_t end = data_output.size();
+    data_output.resize(end + halfwords);
+    return data_output.data() + end;
+}
+
+#ifdef MDEC_TRACE
 template<std::input_iterator ITER, std::sentinel_for<ITER> SENT>
 void MacroblockDecoder::trace_values_as_table(ITER begin, SENT end, uint32_t width) {
     std::stringstream ss;
@@ -126,159 +582,100 @@ void MacroblockDecoder::trace_values_as_table(ITER begin, SENT end, uint32_t wid
         ss.str(std::string());
     }
 }
+#endif
 
-void MacroblockDecoder::decode_collected_blocks() {
-    LOGT_MDEC("Decoding collected blocks");
-
-    // Dump encoding information
-    LOGT_MDEC(std::format("Data Output Depth: {:d}", data_output_depth));
-    LOGT_MDEC(std::format("Data Output Signed: {:s}", data_output_signed));
-    LOGT_MDEC(std::format("Data Output Bit 15: {:s}", data_output_bit15));
-
-    // Dump tables
-    LOGT_MDEC(std::format("Luminance Quantization Table ({:d} bytes):", luminance_quantization_table.size()));
-    trace_values_as_table(luminance_quantization_table.cbegin(), luminance_quantization_table.cend());
-    LOGT_MDEC(std::format("Color Quantization Table ({:d} bytes):", color_quantization_table.size()));
-    trace_values_as_table(color_quantization_table.cbegin(), color_quantization_table.cend());
-    LOGT_MDEC(std::format("Scale Table ({:d} halfwords):", scale_table.size()));
-    trace_values_as_table(scale_table.cbegin(), scale_table.cend());
-
-    // Dump input blocks
-    //LOGT_MDEC(std::format("Block Input Queue ({:d} halfwords):", data_input_queue.size()));
-    //std::stringstream ss;
-    //for (uint16_t value : data_input_queue) {
-    //    ss << std::format("0x{:02X}", value);
-
-    //    if (value == MDEC_END_OF_BLOCK) {
-    //        LOGT_MDEC(ss.str());
-    //        ss.str(std::string());
-    //    } else {
-    //        ss << ", ";
-    //    }
-    //}
-    //// Check if input ended without end-of-block marker
-    //if (!ss.str().empty()) {
-    //    LOGW_MDEC(std::format("Macroblock input ended without end-of-block marker: {:s}", ss.str()));
-    //}
-
-    // Decompress and combine blocks into macroblocks
-    assert(data_output_depth <= 3); // 0 = 4bit, 1 = 8bit, 2 = 24bit, 3 = 15bit
-    if (data_output_depth == 0 || data_output_depth == 1) { // Monochrome
-        std::vector<int16_t> y;
-        while (decode_next_block_stepwise(luminance_quantization_table, y)) {
-            // TODO Decode
-            if (data_output_depth == 0) { // 4bit: 8 * 8 * 4 bit values = 16 halfwords
-                // TODO: Replace dummy data
-                LOGW_MDEC(std::format("4 bit macroblocks not implemented: producing dummy macroblock"));
-                for (uint32_t i = 0; i < 16; ++i) {
-                    data_output_queue.push_back(0x48CF);
-                }
-
-            } else { // 8 bit: 8 * 8 * 8 bit values = 32 halfwords
-                // TODO: Replace dummy data
-                LOGW_MDEC(std::format("8 bit macroblocks not implemented: producing dummy macroblock"));
-                for (uint32_t i = 0; i < 32; ++i) {
-                    data_output_queue.push_back(0x7FFF);
-                }
-            }
+void MacroblockDecoder::decode_pending_macroblocks() {
+    uint32_t count = macroblock_positions.size();
+    if (count == 0) {
+        return;
+    }
+    LOGT_MDEC(std::format("Decoding {:d} macroblocks", count));
+
+    // Decompress and combine blocks into macroblocks, each one is written to its own slot of the output
+    uint32_t halfwords = halfwords_per_macroblock();
+    uint16_t *out = reserve_output(count * halfwords);
+
+    bool parallel = count >= MDEC_PARALLEL_MACROBLOCKS && !logPack.mdecT.isEnabled();
+#ifdef MDEC_TRACE
+    parallel = false;
+#endif
+    if (parallel && !workers) {
+        uint32_t threads = std::clamp<uint32_t>(std::thread::hardware_concurrency(), 1, MDEC_MAX_THREADS);
+        workers = std::make_unique<WorkerPool>(threads - 1);
+        worker_blocks.resize(workers->get_worker_count());
+    }
 
-            y.clear();
+    auto decode = [&](uint32_t i, uint32_t worker) {
+        decode_macroblock_at(macroblock_positions[i], worker_blocks[worker], out + i * halfwords);
+    };
+    if (parallel) {
+        workers->run(count, decode);
+    } else {
+        for (uint32_t i = 0; i < count; ++i) {
+            decode(i, 0);
         }
+    }
 
-    } else { // Colored
-        std::vector<int16_t> cr, cb, y1, y2, y3, y4;
-        std::vector<uint8_t> macroblock_r, macroblock_g, macroblock_b;
-
-        while (true) {
-            LOGT_MDEC(std::format("Decoding and uncompressing block Cr"));
-            std::vector<int32_t> cr_uncomp, cb_uncomp, y1_uncomp, y2_uncomp, y3_uncomp, y4_uncomp;
-            if (!decode_next_block_stepwise(color_quantization_table, cr)) {
-                break;
-            }
-            idct(cr_uncomp, cr);
+    // Only the macroblock that is being received is left in the input
+    drop_input(scan_macroblock_position - input_read_position);
+    macroblock_positions.clear();
+}
 
-            LOGT_MDEC(std::format("Decoding and uncompressing block Cb"));
-            if (!decode_next_block_stepwise(color_quantization_table, cb)) {
-                LOGW_MDEC(std::format("Not enough RLE-encoded blocks to decode next macroblock"));
-                break;
-            }
-            idct(cb_uncomp, cb);
+void MacroblockDecoder::finish_decoding() {
+    decode_pending_macroblocks();
 
-            LOGT_MDEC(std::format("Decoding and uncompressing block Y1"));
-            if (!decode_next_block_stepwise(luminance_quantization_table, y1)) {
-                LOGW_MDEC(std::format("Not enough RLE-encoded blocks to decode next macroblock"));
-                break;
-            }
-            idct(y1_uncomp, y1);
+    // Anything but end-of-block padding after the last complete macroblock is dropped
+    if (scan_in_block || scan_blocks > 0) {
+        LOGW_MDEC(std::format("Not enough RLE-encoded blocks to decode next macroblock"));
+    }
+    drop_input(input_size);
+    scan_in_block = false;
+    scan_blocks = 0;
+    scan_macroblock_position = input_read_position;
+}
 
-            LOGT_MDEC(std::format("Decoding and uncompressing block Y2"));
-            if (!decode_next_block_stepwise(luminance_quantization_table, y2)) {
-                LOGW_MDEC(std::format("Not enough RLE-encoded blocks to decode next macroblock"));
-                break;
-            }
-            idct(y2_uncomp, y2);
+uint32_t MacroblockDecoder::blocks_per_macroblock() const {
+    assert(data_output_depth <= 3); // 0 = 4bit, 1 = 8bit, 2 = 24bit, 3 = 15bit
+    return data_output_depth <= 1 ? 1 : 6;
+}
 
-            LOGT_MDEC(std::format("Decoding and uncompressing block Y3"));
-            if (!decode_next_block_stepwise(luminance_quantization_table, y3)) {
-                LOGW_MDEC(std::format("Not enough RLE-encoded blocks to decode next macroblock"));
-                break;
-            }
-            idct(y3_uncomp, y3);
+uint32_t MacroblockDecoder::halfwords_per_macroblock() const {
+    switch (data_output_depth) {
+        case 0: // 4bit: 8 * 8 * 4 bit values
+            return 16;
+        case 1: // 8bit: 8 * 8 * 8 bit values
+            return 32;
+        case 2: // 24bit: 16 * 16 * 24 bit values
+            return 384;
+        default: // 15bit: 16 * 16 * 16 bit values
+            return 256;
+    }
+}
 
-            LOGT_MDEC(std::format("Decoding and uncompressing block Y4"));
-            if (!decode_next_block_stepwise(luminance_quantization_table, y4)) {
-                LOGW_MDEC(std::format("Not enough RLE-encoded blocks to decode next macroblock"));
-                break;
-            }
-            idct(y4_uncomp, y4);
-
-            yuv_to_rgb(macroblock_r, macroblock_g, macroblock_b,
-                       cr_uncomp, cb_uncomp, y1_uncomp, 0, 0);
-            yuv_to_rgb(macroblock_r, macroblock_g, macroblock_b,
-                       cr_uncomp, cb_uncomp, y2_uncomp, 8, 0);
-            yuv_to_rgb(macroblock_r, macroblock_g, macroblock_b,
-                       cr_uncomp, cb_uncomp, y3_uncomp, 0, 8);
-            yuv_to_rgb(macroblock_r, macroblock_g, macroblock_b,
-                       cr_uncomp, cb_uncomp, y4_uncomp, 8, 8);
-
-            if (data_output_depth == 2) { // 24 bit: 16 * 16 * 24 bit values = 384 halfwords
-
-                LOGT_MDEC(std::format("Writing macroblock as 24 bit colors"));
-                std::vector<uint8_t> macroblock;
-                assert(macroblock_r.size() == 256);
-                assert(macroblock_g.size() == 256);
-                assert(macroblock_b.size() == 256);
-                for (uint32_t i = 0; i < 256; ++i) {
-                    macroblock.push_back(macroblock_r[i]);
-                    macroblock.push_back(macroblock_g[i]);
-                    macroblock.push_back(macroblock_b[i]);
-                }
-                for (uint32_t i = 0; i < macroblock.size(); i += 2) {
-                    data_output_queue.push_back((static_cast<uint16_t>(macroblock[i + 1]) << 8) | static_cast<uint16_t>(macroblock[i]));
-                }
+void MacroblockDecoder::decode_macroblock_at(uint32_t position, MacroblockBlocks &blocks, uint16_t *out) const {
+    if (blocks_per_macroblock() == 1) { // Monochrome
+        decode_block(luminance_quantization_table, blocks.y[0], position);
+        idct(blocks.y[0]);
+        write_monochrome_block(blocks.y[0], out);
+        return;
+    }
 
-            } else { // 15 bit: 16 * 16 * 16 bit values = 256 halfwords
-                LOGT_MDEC(std::format("Writing macroblock as 15 bit colors"));
-                std::vector<uint8_t> macroblock;
-                assert(macroblock_r.size() == 256);
-                assert(macroblock_g.size() == 256);
-                assert(macroblock_b.size() == 256);
-                for (uint32_t i = 0; i < 256; ++i) {
-                    data_output_queue.push_back((static_cast<uint16_t>(macroblock_b[i] >> 3) << 10)
-                                                | (static_cast<uint16_t>(macroblock_g[i] >> 3) << 5)
-                                                | (static_cast<uint16_t>(macroblock_r[i] >> 3)));
-                }
-            }
+    // Colored
+    LOGT_MDEC(std::format("Decoding and uncompressing block Cr"));
+    position = decode_block(color_quantization_table, blocks.cr, position);
+    idct(blocks.cr);
 
-            cr.clear();
-            cb.clear();
-            y1.clear();
-            y2.clear();
-            y3.clear();
-            y4.clear();
-        }
+    LOGT_MDEC(std::format("Decoding and uncompressing block Cb"));
+    position = decode_block(color_quantization_table, blocks.cb, position);
+    idct(blocks.cb);
 
+    for (uint32_t i = 0; i < blocks.y.size(); ++i) {
+        LOGT_MDEC(std::format("Decoding and uncompressing block Y{:d}", i + 1));
+        position = decode_block(luminance_quantization_table, blocks.y[i], position);
+        idct(blocks.y[i]);
     }
+
+    write_colored_macroblock(blocks, out);
 }
 
 int16_t MacroblockDecoder::sign_extend(uint16_t value) {
@@ -295,43 +692,30 @@ int16_t MacroblockDecoder::clamp(int32_t value) {
     return clamped;
 }
 
-bool MacroblockDecoder::read_next_block(std::vector<uint16_t>& block) {
+#ifdef MDEC_TRACE
+uint32_t MacroblockDecoder::read_next_block(uint32_t position, std::vector<uint16_t>& block) const {
     LOGT_MDEC(std::format("Reading RLE-encoded block"));
     assert(block.empty());
 
-    // Read the next block from the input queue. Do not decode.
-    while (!data_input_queue.empty() && data_input_queue.front() == MDEC_END_OF_BLOCK) {
-        data_input_queue.pop_front();
-    }
-
-    if (data_input_queue.empty()) {
-        // No block left
-        return false;
-    }
-
-    while (!data_input_queue.empty() && data_input_queue.front() != MDEC_END_OF_BLOCK) {
-        block.push_back(data_input_queue.front());
-        data_input_queue.pop_front();
+    // Read the block at the input position. Do not decode.
+    while (input_at(position) == MDEC_END_OF_BLOCK) {
+        ++position;
     }
-
-    if (data_input_queue.empty()) {
-        // We did not end with an end-of-block marker. This is wrong!
-        LOGW_MDEC(std::format("RLE-encoded block ended unexpectedly"));
-        return false;
+    while (input_at(position) != MDEC_END_OF_BLOCK) {
+        block.push_back(input_at(position++));
     }
 
     // End-of-block marker
-    block.push_back(data_input_queue.front());
-    data_input_queue.pop_front();
+    block.push_back(input_at(position++));
 
     // Trace for debugging purposes
     LOGT_MDEC(std::format("Read RLE-encoded block:"));
     trace_values_as_table(block.cbegin(), block.cend());
 
-    return true;
+    return position;
 }
 
-void MacroblockDecoder::rle_decode_block(std::vector<int16_t>& decoded_block, const std::vector<uint16_t>& encoded_block) {
+void MacroblockDecoder::rle_decode_block(std::vector<int16_t>& decoded_block, const std::vector<uint16_t>& encoded_block) const {
     LOGT_MDEC(std::format("RLE-decoding block"));
     assert(decoded_block.empty());
     assert(!encoded_block.empty());
@@ -361,6 +745,12 @@ void MacroblockDecoder::rle_decode_block(std::vector<int16_t>& decoded_block, co
     assert(it != encoded_block.cend() && *it == MDEC_END_OF_BLOCK);
     assert(++it == encoded_block.cend());
 
+    // Coefficients beyond the block are ignored
+    if (decoded_block.size() > 64) {
+        LOGW_MDEC(std::format("RLE-encoded block has {:d} coefficients", decoded_block.size()));
+        decoded_block.resize(64);
+    }
+
     // EOB: pad rest of block with 0
     while (decoded_block.size() < 64) {
         decoded_block.push_back(0U);
@@ -374,7 +764,7 @@ void MacroblockDecoder::rle_decode_block(std::vector<int16_t>& decoded_block, co
     trace_values_as_table(decoded_block.cbegin(), decoded_block.cend());
 }
 
-void MacroblockDecoder::zagzig_block(std::vector<int16_t>& zagzig_block, const std::vector<int16_t>& zigzag_block) {
+void MacroblockDecoder::zagzig_block(std::vector<int16_t>& zagzig_block, const std::vector<int16_t>& zigzag_block) const {
     LOGT_MDEC(std::format("Zagzigging block"));
     assert(zagzig_block.empty());
     assert(zigzag_block.size() == 64 + 1);
@@ -397,7 +787,7 @@ void MacroblockDecoder::zagzig_block(std::vector<int16_t>& zagzig_block, const s
     trace_values_as_table(zagzig_block.cbegin(), zagzig_block.cend());
 }
 
-void MacroblockDecoder::dequantize_block(const std::vector<uint8_t>& q_table, std::vector<int16_t>& dequantized_block, const std::vector<int16_t>& quantized_block) {
+void MacroblockDecoder::dequantize_block(const std::array<uint8_t, 64>& q_table, std::vector<int16_t>& dequantized_block, const std::vector<int16_t>& quantized_block) const {
     LOGT_MDEC(std::format("De-quantizing block"));
     assert(dequantized_block.empty());
     assert(quantized_block.size() == 64 + 1);
@@ -409,9 +799,10 @@ void MacroblockDecoder::dequantize_block(const std::vector<uint8_t>& q_table, st
             dequantized_block.push_back(clamp(static_cast<int32_t>(quantized_block[i]) * 2));
         }
     } else {
+        // The quantization table is in zigzag order
         dequantized_block.push_back(clamp(quantized_block[0] * q_table[0]));
         for (uint32_t i = 1; i < 64; ++i) {
-            dequantized_block.push_back(clamp((static_cast<int32_t>(quantized_block[i]) * q_table[i] * quantization_factor + 4) / 8));
+            dequantized_block.push_back(clamp((static_cast<int32_t>(quantized_block[i]) * q_table[zigzag[i]] * quantization_factor + 4) / 8));
         }
     }
 
@@ -420,180 +811,142 @@ void MacroblockDecoder::dequantize_block(const std::vector<uint8_t>& q_table, st
     trace_values_as_table(dequantized_block.cbegin(), dequantized_block.cend());
 }
 
-bool MacroblockDecoder::decode_next_block_stepwise(const std::vector<uint8_t>& q_table, std::vector<int16_t>& block) {
+uint32_t MacroblockDecoder::decode_next_block_stepwise(const std::array<uint8_t, 64>& q_table, Block& block, uint32_t position) const {
     LOGT_MDEC(std::format("Decoding RLE-encoded block step by step"));
-    assert(block.empty());
 
     std::vector<uint16_t> next_block;
-    if (!read_next_block(next_block)) {
-        return false;
-    }
+    position = read_next_block(position, next_block);
     std::vector<int16_t> rle_decoded_block;
     rle_decode_block(rle_decoded_block, next_block);
     std::vector<int16_t> zagzigged_block;
     zagzig_block(zagzigged_block, rle_decoded_block);
-    dequantize_block(q_table, block, zagzigged_block);
+    std::vector<int16_t> dequantized_block;
+    dequantize_block(q_table, dequantized_block, zagzigged_block);
+    std::copy(dequantized_block.cbegin(), dequantized_block.cend(), block.begin());
 
-    return true;
+    return position;
 }
+#endif
 
-bool MacroblockDecoder::decode_next_block(const std::vector<uint8_t>& quant, std::vector<int16_t>& buffer) {
+uint32_t MacroblockDecoder::decode_next_block(const std::array<uint8_t, 64>& quant, Block& block, uint32_t position) const {
     // RLE-decoded, zagzig, and de-quantize
-    while (!data_input_queue.empty() && data_input_queue.front() == MDEC_END_OF_BLOCK) {
-        data_input_queue.pop_front();
+    while (input_at(position) == MDEC_END_OF_BLOCK) {
+        ++position;
     }
-    if (data_input_queue.empty()) {
-        // No block left
-        return false;
-    }
-
-    LOGT_MDEC(std::format("Decoding RLE-encoded block"));
-    buffer.resize(64);
 
     // DCT halfword
-    uint16_t dct = data_input_queue.front();
-    data_input_queue.pop_front();
+    uint16_t dct = input_at(position++);
     uint16_t quantization_factor = dct >> 10; // 6 bits, unsigned
     int16_t dc = sign_extend(dct & 0x03FF); // 10 bits, signed
 
+    block.fill(0);
     if (quantization_factor == 0) {
-        buffer[0] = clamp(dc * 2);
+        block[0] = clamp(dc * 2);
     } else {
-        buffer[0] = clamp(dc * quant[0]);
+        block[0] = clamp(dc * quant[0]);
     }
 
-    // 0 to 63 RLE halfwords
-    uint8_t pos = 1;
-    while (!data_input_queue.empty() && data_input_queue.front() != MDEC_END_OF_BLOCK) {
-        uint16_t rle = data_input_queue.front();
-        data_input_queue.pop_front();
-
-        uint16_t len = rle >> 10; // 6 bits, unsigned
+    // 0 to 63 RLE halfwords, the skipped coefficients are zero
+    uint32_t pos = 0;
+    for (uint16_t rle = input_at(position++); rle != MDEC_END_OF_BLOCK; rle = input_at(position++)) {
+        pos += (rle >> 10) + 1; // 6 bits, unsigned
         int16_t ac = sign_extend(rle & 0x03FF); // 10 bits, signed
-        for (uint16_t i = 0; i < len; ++i) {
-            assert(pos < 64);
-            if (quantization_factor == 0) {
-                buffer[pos++] = 0;
-            } else {
-                buffer[zagzig[pos++]] = 0;
-            }
-        }
-        assert(pos < 64);
-        if (quantization_factor == 0) {
-            buffer[pos++] = clamp(ac * 2);
-        } else {
-            buffer[zagzig[pos++]] = clamp((ac * quant[pos] * quantization_factor + 4) / 8);
+        if (pos >= 64) {
+            // Coefficients beyond the block are ignored
+            continue;
         }
-    }
 
-    if (data_input_queue.empty()) {
-        // We did not end with an end-of-block marker. This is wrong!
-        LOGW_MDEC(std::format("RLE-encoded block ended unexpectedly"));
-        return false;
-    }
-
-    // EOB: pad rest of block with 0
-    data_input_queue.pop_front();
-    while (pos < 64) {
         if (quantization_factor == 0) {
-            buffer[pos++] = 0;
+            block[pos] = clamp(ac * 2);
         } else {
-            buffer[zagzig[pos++]] = 0;
+            block[zagzig[pos]] = clamp((ac * quant[pos] * quantization_factor + 4) / 8);
         }
     }
 
-    // Trace for debugging purposes
-    LOGT_MDEC(std::format("Decoded block (quantization_factor = 0x{:04X}):", quantization_factor));
-    trace_values_as_table(++buffer.cbegin(), buffer.cend());
-
-    return true;
+    return position;
 }
 
-void MacroblockDecoder::idct(std::vector<int32_t>& result, std::vector<int16_t>& block) {
-    // Computes IDCT^T * B * IDCT, where IDCT is the IDCT matrix and B the block
-    LOGT_MDEC(std::format("Performing IDCT"));
-
-    assert(block.size() == 64);
-    result.resize(64);
-
-    std::vector<int32_t> temp;
-    temp.resize(64);
+uint32_t MacroblockDecoder::decode_block(const std::array<uint8_t, 64>& quant, Block& block, uint32_t position) const {
+#ifdef MDEC_TRACE
+    return decode_next_block_stepwise(quant, block, position);
+#else
+    return decode_next_block(quant, block, position);
+#endif
+}
 
-    // IDCT^T * B
+void MacroblockDecoder::update_idct_matrix() {
     for (uint8_t i = 0; i < 8; ++i) {
         for (uint8_t j = 0; j < 8; ++j) {
-            int32_t sum = 0;
-            for (uint8_t k = 0; k < 8; ++k) {
-                sum += (scale_table[index(k, i)] / 8) * static_cast<int32_t>(block[index(k, j)]);
-            }
-            temp[index(i, j)] = (sum + 0x0FFF) / 0x2000;
+            idct_matrix[index(i, j)] = scale_table[index(i, j)] / 8;
+            idct_matrix_transposed[index(j, i)] = idct_matrix[index(i, j)];
         }
     }
+}
 
-    // block * IDCT
-    for (uint8_t i = 0; i < 8; ++i) {
-        for (uint8_t j = 0; j < 8; ++j) {
-            int32_t sum = 0;
-            for (uint8_t k = 0; k < 8; ++k) {
-                sum += static_cast<int32_t>(temp[index(i, k)]) * (scale_table[index(k, j)] / 8);
+void MacroblockDecoder::idct(Block& block) const {
+    // Computes IDCT^T * B * IDCT, where IDCT is the IDCT matrix and B the block.
+    // Coefficients are at most 10 bits and the matrix entries 13 bits, so that
+    // the sums fit into 32 bits and the results of both passes into 16 bits.
+    LOGT_MDEC(std::format("Performing IDCT"));
+
+    if (std::all_of(block.cbegin() + 1, block.cend(), [](int16_t coefficient) { return coefficient == 0; })) {
+        // Only the first column of IDCT^T * B is non-zero (0x0FFF / 0x2000 is zero)
+        int32_t column[8];
+        for (uint8_t i = 0; i < 8; ++i) {
+            column[i] = (idct_matrix[index(0, i)] * block[0] + 0x0FFF) / 0x2000;
+        }
+        for (uint8_t i = 0; i < 8; ++i) {
+            for (uint8_t j = 0; j < 8; ++j) {
+                block[index(i, j)] = (column[i] * idct_matrix[index(0, j)] + 0x0FFF) / 0x2000;
             }
-            result[index(i, j)] = (sum + 0x0FFF) / 0x2000;
         }
+
+    } else {
+        Block temp;
+        kernels().idct_pass(idct_matrix_transposed.data(), block.data(), temp.data());
+        kernels().idct_pass(temp.data(), idct_matrix.data(), block.data());
     }
 
+#ifdef MDEC_TRACE
     // Trace for debugging purposes
     LOGT_MDEC(std::format("Performed IDCT:"));
-    trace_values_as_table(result.cbegin(), result.cend());
+    trace_values_as_table(block.cbegin(), block.cend());
+#endif
 }
 
-int16_t MacroblockDecoder::clamp_color(int32_t value) {
-    int32_t clamped = std::min(static_cast<int32_t>(127), value);
-    clamped = std::max(static_cast<int32_t>(-128), clamped);
-    return clamped;
-}
+void MacroblockDecoder::write_colored_macroblock(const MacroblockBlocks &blocks, uint16_t *out) const {
+    ChromaTerms chroma;
+    compute_chroma_terms(blocks.cr.data(), blocks.cb.data(), chroma);
+    const int16_t *const luminance[4] = {blocks.y[0].data(), blocks.y[1].data(), blocks.y[2].data(), blocks.y[3].data()};
+    uint16_t bit15 = data_output_bit15 ? 0x8000 : 0;
 
-void MacroblockDecoder::yuv_to_rgb(std::vector<uint8_t>& r, std::vector<uint8_t>& g, std::vector<uint8_t>& b,
-                                   const std::vector<int32_t>& cr, const std::vector<int32_t>& cb, const std::vector<int32_t>& y_block,
-                                   uint8_t x_offset, uint8_t y_offset) {
-    LOGT_MDEC(std::format("Converting YUV blocks to (part of) RGB macroblock (offset {:d}, {:d})", x_offset, y_offset));
-    r.resize(16 * 16);
-    g.resize(16 * 16);
-    b.resize(16 * 16);
-
-    for (uint32_t y = 0; y < 8; ++y) {
-        for (uint32_t x = 0; x < 8; ++x) {
-            float r_fl = cr[(x_offset + x) / 2 + ((y_offset + y) / 2) * 8];
-            float b_fl = cb[(x_offset + x) / 2 + ((y_offset + y) / 2) * 8];
-            float g_fl = -0.3437 * b_fl - 0.7143 * r_fl;
-            r_fl = 1.402 * r_fl;
-            b_fl = 1.772 * b_fl;
-
-            int32_t y_value = y_block[x + y * 8];
-            int16_t r_value = clamp_color(y_value + static_cast<int32_t>(r_fl));
-            int16_t g_value = clamp_color(y_value + static_cast<int32_t>(g_fl));
-            int16_t b_value = clamp_color(y_value + static_cast<int32_t>(b_fl));
-
-            if (!data_output_signed) {
-                r_value += 128;
-                g_value += 128;
-                b_value += 128;
-            }
+    if (data_output_depth == 2) {
+        LOGT_MDEC(std::format("Writing macroblock as 24 bit colors"));
+        kernels().convert_24_bit(luminance, chroma, data_output_signed, bit15, out);
+    } else {
+        LOGT_MDEC(std::format("Writing macroblock as 15 bit colors"));
+        kernels().convert_15_bit(luminance, chroma, data_output_signed, bit15, out);
+    }
 
-            uint32_t coord = x_offset + x + (y_offset + y) * 16;
-            assert(coord < 256);
-            r[coord] = r_value;
-            g[coord] = g_value;
-            b[coord] = b_value;
-        }
+#ifdef MDEC_TRACE
+    LOGT_MDEC(std::format("Macroblock:"));
+    trace_values_as_table(out, out + halfwords_per_macroblock(), 16);
+#endif
+}
+
+void MacroblockDecoder::write_monochrome_block(const Block &block, uint16_t *out) const {
+    if (data_output_depth == 0) {
+        LOGT_MDEC(std::format("Writing block as 4 bit monochrome"));
+        kernels().monochrome_4_bit(block.data(), data_output_signed, out);
+    } else {
+        LOGT_MDEC(std::format("Writing block as 8 bit monochrome"));
+        kernels().monochrome_8_bit(block.data(), data_output_signed, out);
     }
 
-    LOGT_MDEC(std::format("Converted YUV blocks to (part of) RGB macroblock:"));
-    LOGT_MDEC("Macroblock (red):");
-    trace_values_as_table(r.cbegin(), r.cend(), 16);
-    LOGT_MDEC("Macroblock (green):");
-    trace_values_as_table(g.cbegin(), g.cend(), 16);
-    LOGT_MDEC("Macroblock (blue):");
-    trace_values_as_table(b.cbegin(), b.cend(), 16);
+#ifdef MDEC_TRACE
+    LOGT_MDEC(std::format("Block:"));
+    trace_values_as_table(out, out + halfwords_per_macroblock(), 16);
+#endif
 }
 
 MacroblockDecoder::MacroblockDecoder(Bus *bus) {
@@ -603,18 +956,30 @@ MacroblockDecoder::MacroblockDecoder(Bus *bus) {
         zagzig[zigzag[i]] = i;
     }
 
+    data_input.resize(MDEC_INPUT_CAPACITY);
+    // Blocks of the calling thread, the worker pool adds its own
+    worker_blocks.resize(1);
+
     reset();
 }
 
 void MacroblockDecoder::reset() {
     state = State::IDLE;
 
-    luminance_quantization_table.clear();
-    color_quantization_table.clear();
-    scale_table.clear();
-
-    data_input_queue.clear();
-    data_output_queue.clear();
+    luminance_quantization_table.fill(0);
+    color_quantization_table.fill(0);
+    scale_table.fill(0);
+    update_idct_matrix();
+    table_entries = 0;
+
+    input_read_position = 0;
+    input_size = 0;
+    scan_in_block = false;
+    scan_blocks = 0;
+    scan_macroblock_position = 0;
+    macroblock_positions.clear();
+    data_output.clear();
+    output_read_position = 0;
 
     received_all_parameters = false;
     remaining_parameter_words = 0;
@@ -634,7 +999,7 @@ bool MacroblockDecoder::data_in_request() const {
 }
 
 bool MacroblockDecoder::data_out_request() const {
-    return data_out_enabled && !data_output_queue.empty();
+    return data_out_enabled && output_available();
 }
 
 void MacroblockDecoder::process(uint32_t value) {
@@ -661,28 +1026,32 @@ void MacroblockDecoder::process(uint32_t value) {
         switch (state) {
             case State::CMD_DECODE_MACROBLOCK:
                 LOGT_MDEC(std::format("Received macroblock value 0x{:08X}", value));
-                data_input_queue.push_back(value & 0xFFFF);
-                data_input_queue.push_back((value >> 16) & 0xFFFF);
+                push_input(value & 0xFFFF);
+                push_input((value >> 16) & 0xFFFF);
+                if (macroblock_positions.size() >= MDEC_PENDING_MACROBLOCKS) {
+                    decode_pending_macroblocks();
+                }
 
                 break;
             case State::CMD_SET_IQTAB:
                 LOGT_MDEC(std::format("Received iqtab value 0x{:08X}", value));
-                if (luminance_quantization_table.size() < 64) {
-                    luminance_quantization_table.push_back(value & 0xFF);
-                    luminance_quantization_table.push_back((value >> 8) & 0xFF);
-                    luminance_quantization_table.push_back((value >> 16) & 0xFF);
-                    luminance_quantization_table.push_back((value >> 24) & 0xFF);
-                } else {
-                    color_quantization_table.push_back(value & 0xFF);
-                    color_quantization_table.push_back((value >> 8) & 0xFF);
-                    color_quantization_table.push_back((value >> 16) & 0xFF);
-                    color_quantization_table.push_back((value >> 24) & 0xFF);
+                for (uint32_t i = 0; i < 4 && table_entries < 128; ++i, ++table_entries) {
+                    uint8_t entry = (value >> (8 * i)) & 0xFF;
+                    if (table_entries < 64) {
+                        luminance_quantization_table[table_entries] = entry;
+                    } else {
+                        color_quantization_table[table_entries - 64] = entry;
+                    }
                 }
                 break;
             case State::CMD_SET_SCALE:
                 LOGT_MDEC(std::format("Received scale value 0x{:08X}", value));
-                scale_table.push_back(value & 0xFFFF);
-                scale_table.push_back((value >> 16) & 0xFFFF);
+                for (uint32_t i = 0; i < 2 && table_entries < 64; ++i, ++table_entries) {
+                    scale_table[table_entries] = (value >> (16 * i)) & 0xFFFF;
+                }
+                if (table_entries == 64) {
+                    update_idct_matrix();
+                }
                 break;
             case State::IDLE: // Not reachable
                 break;
@@ -692,7 +1061,7 @@ void MacroblockDecoder::process(uint32_t value) {
         if (remaining_parameter_words == 0xFFFF) { // The stored value is minus one
             LOGT_MDEC(std::format("Received last parameter word"));
             if (state == State::CMD_DECODE_MACROBLOCK) {
-                decode_collected_blocks();
+                finish_decoding();
             }
             state = State::IDLE;
             received_all_parameters = true;
@@ -701,10 +1070,18 @@ void MacroblockDecoder::process(uint32_t value) {
 }
 
 uint16_t MacroblockDecoder::read() {
+    if (output_empty()) {
+        // Macroblocks are decoded as late as possible, so that they can be decoded together
+        decode_pending_macroblocks();
+    }
+
     uint16_t value = 0;
-    if (!data_output_queue.empty()) {
-        value = data_output_queue.front();
-        data_output_queue.pop_front();
+    if (!output_empty()) {
+        value = data_output[output_read_position++];
+        if (output_empty()) {
+            data_output.clear();
+            output_read_position = 0;
+        }
     } else {
         LOGW_MDEC("Read from MDEC, but output queue is empty!");
     }
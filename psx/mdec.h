@@ -1,13 +1,16 @@
 #ifndef PSX_MDEC_H
 #define PSX_MDEC_H
 
+#include <array>
 #include <cstdint>
-#include <deque>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "util/workerpool.h"
+
 namespace PSX {
 
 // 0x1F80'1820 Write: MDEC Command/Parameter Register
@@ -47,6 +50,16 @@ namespace PSX {
 
 #define MDEC_END_OF_BLOCK 0xFE00
 
+// Halfwords the input ring holds, enough for the largest decode_macroblock command (0xFFFF words) so input is never dropped
+// (has to be a power of two)
+#define MDEC_INPUT_CAPACITY 0x20000
+// Complete macroblocks are decoded once this many have been received (or once their output is needed)
+#define MDEC_PENDING_MACROBLOCKS 32
+// Batches with fewer macroblocks are decoded on the calling thread only
+#define MDEC_PARALLEL_MACROBLOCKS 16
+// Upper limit of threads decoding a batch, including the calling thread
+#define MDEC_MAX_THREADS 8
+
 class Bus;
 
 class MacroblockDecoder {
@@ -64,14 +77,41 @@ private:
     };
     State state;
 
-    std::vector<uint8_t> luminance_quantization_table;
-    std::vector<uint8_t> color_quantization_table;
-    std::vector<int16_t> scale_table;
-
-    // Stores the incoming, RLE-coded blocks
-    std::deque<uint16_t> data_input_queue;
-    // Stores the outgoing, decompressed macroblocks
-    std::deque<uint16_t> data_output_queue;
+    std::array<uint8_t, 64> luminance_quantization_table;
+    std::array<uint8_t, 64> color_quantization_table;
+    std::array<int16_t, 64> scale_table;
+    // The IDCT matrix (scale table divided by 8) and its transpose
+    std::array<int16_t, 64> idct_matrix;
+    std::array<int16_t, 64> idct_matrix_transposed;
+    // Table entries received so far by set_iqtab or set_scale
+    uint32_t table_entries;
+
+    // Stores the incoming, RLE-coded blocks: a ring of MDEC_INPUT_CAPACITY halfwords.
+    // Input positions only ever increase (modulo 2^32), the slot of position p is p % MDEC_INPUT_CAPACITY.
+    std::vector<uint16_t> data_input;
+    uint32_t input_read_position;
+    uint32_t input_size;
+    // Where the incoming halfwords are in the macroblock that is being received
+    bool scan_in_block; // inside an RLE-coded block, its end-of-block marker has not arrived yet
+    uint32_t scan_blocks; // complete blocks of the macroblock
+    uint32_t scan_macroblock_position; // input position of the macroblock
+    // Stores the outgoing, decompressed macroblocks, the halfwords before the read position have been read already.
+    // It is emptied once everything has been read, its capacity is kept.
+    std::vector<uint16_t> data_output;
+    uint32_t output_read_position;
+
+    // Coefficients, then samples, of the blocks of a macroblock (monochrome uses the first Y block only)
+    typedef std::array<int16_t, 64> Block;
+    struct MacroblockBlocks {
+        Block cr, cb;
+        std::array<Block, 4> y;
+    };
+    // Decodes the macroblocks of large batches in parallel, created on first use
+    std::unique_ptr<util::WorkerPool> workers;
+    // Blocks of each worker
+    std::vector<MacroblockBlocks> worker_blocks;
+    // Input positions of the complete macroblocks that have not been decoded yet
+    std::vector<uint32_t> macroblock_positions;
 
     bool received_all_parameters;
     uint16_t remaining_parameter_words;
@@ -97,30 +137,55 @@ private:
     void set_scale(uint32_t command); // 3
     void no_function(uint32_t command); // 0, 4...7
 
+    // Appends to the input and keeps track of the macroblock boundaries
+    void push_input(uint16_t value);
+    void scan_input(uint16_t value, uint32_t position);
+    uint16_t input_at(uint32_t position) const;
+    void drop_input(uint32_t halfwords);
+    bool output_empty() const;
+    // Decoded or complete macroblocks are waiting to be read
+    bool output_available() const;
+    // Appends halfwords to the output, returns where to write them
+    uint16_t* reserve_output(uint32_t halfwords);
+
     template<std::input_iterator ITER, std::sentinel_for<ITER> SENT>
     static void trace_values_as_table(ITER begin, SENT end, uint32_t width = 8);
-    void decode_collected_blocks();
+    // Decodes the complete macroblocks received so far and appends them to the output
+    void decode_pending_macroblocks();
+    // After the last parameter word of decode_macroblock
+    void finish_decoding();
+
+    uint32_t blocks_per_macroblock() const;
+    // Size of a decoded (macro)block in the data output format
+    uint32_t halfwords_per_macroblock() const;
+    // Decodes the complete macroblock at the input position into out, the blocks are scratch memory
+    void decode_macroblock_at(uint32_t position, MacroblockBlocks &blocks, uint16_t *out) const;
 
     static int16_t sign_extend(uint16_t value);
     static int16_t clamp(int32_t value);
-    // Reads the next block from the input queue into the provided buffer
-    bool read_next_block(std::vector<uint16_t>& block);
+    // The stepwise functions are debugging aids, they are only compiled in with MDEC_TRACE
+    // Reads the block at the input position into the provided buffer, returns the position after it
+    uint32_t read_next_block(uint32_t position, std::vector<uint16_t>& block) const;
     // Decode the RLE-encoded block
-    void rle_decode_block(std::vector<int16_t>& decoded_block, const std::vector<uint16_t>& encoded_block);
+    void rle_decode_block(std::vector<int16_t>& decoded_block, const std::vector<uint16_t>& encoded_block) const;
     // Undo zigzag order
-    void zagzig_block(std::vector<int16_t>& zagzig_blck, const std::vector<int16_t>& zigzag_block);
+    void zagzig_block(std::vector<int16_t>& zagzig_blck, const std::vector<int16_t>& zigzag_block) const;
     // De-quantize block
-    void dequantize_block(const std::vector<uint8_t>& q_table, std::vector<int16_t>& dequantized_block, const std::vector<int16_t>& quantized_block);
-    // Reads, RLE-decodes, zagzigs, and de-quantizes the next block from the input queue with debug output after every step
-    bool decode_next_block_stepwise(const std::vector<uint8_t>& q_table, std::vector<int16_t>& block);
-    // Reads, RLE-decodes, zagzigs, and de-quantizes the next block from the input queue
-    bool decode_next_block(const std::vector<uint8_t>& quant, std::vector<int16_t>& buffer);
+    void dequantize_block(const std::array<uint8_t, 64>& q_table, std::vector<int16_t>& dequantized_block, const std::vector<int16_t>& quantized_block) const;
+    // Reads, RLE-decodes, zagzigs, and de-quantizes the block at the input position with debug output after every step
+    uint32_t decode_next_block_stepwise(const std::array<uint8_t, 64>& q_table, Block& block, uint32_t position) const;
+    // Reads, RLE-decodes, zagzigs, and de-quantizes the block at the input position, returns the position after it.
+    // The block has to be complete (see scan_input()).
+    uint32_t decode_next_block(const std::array<uint8_t, 64>& quant, Block& block, uint32_t position) const;
+    // One of the above, depending on MDEC_TRACE
+    uint32_t decode_block(const std::array<uint8_t, 64>& quant, Block& block, uint32_t position) const;
     static uint8_t index(uint8_t i, uint8_t j) { return i * 8 + j; }
-    void idct(std::vector<int32_t>& result, std::vector<int16_t>& block);
-    static int16_t clamp_color(int32_t value);
-    void yuv_to_rgb(std::vector<uint8_t>& r, std::vector<uint8_t>& g, std::vector<uint8_t>& b,
-                    const std::vector<int32_t>& cr, const std::vector<int32_t>& cb, const std::vector<int32_t>& y,
-                    uint8_t x_offset, uint8_t y_offset);
+    void update_idct_matrix();
+    // In place, the coefficients are replaced by the samples
+    void idct(Block& block) const;
+    // Convert the decoded blocks to the data output format
+    void write_colored_macroblock(const MacroblockBlocks &blocks, uint16_t *out) const;
+    void write_monochrome_block(const Block &block, uint16_t *out) const;
 
 public:
     MacroblockDecoder(Bus *bus);
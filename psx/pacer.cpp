@@ -0,0 +1,167 @@
+#include "pacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <format>
+#include <thread>
+
+#include "spu.h"
+#include "util/log.h"
+
+using namespace util;
+
+namespace PSX {
+
+FramePacer::FramePacer()
+    : enabled(true),
+      clock(Clock::HOST) {
+    reset();
+}
+
+void FramePacer::reset() {
+    has_deadline = false;
+    has_last_frame = false;
+
+    period_frames = 0;
+    period_sum = 0.0;
+    period_sum_of_squares = 0.0;
+    period_max_deviation = 0.0;
+
+    std::lock_guard<std::mutex> lock(statistics_mutex);
+    statistics = {};
+}
+
+void FramePacer::setEnabled(bool enabled) {
+    this->enabled.store(enabled);
+}
+
+bool FramePacer::isEnabled() const {
+    return enabled.load();
+}
+
+void FramePacer::setClock(Clock clock) {
+    this->clock.store(clock);
+}
+
+FramePacer::Clock FramePacer::getClock() const {
+    return clock.load();
+}
+
+double FramePacer::frameRateOfVideoMode(bool pal) {
+    return pal ? PACER_PAL_FRAME_RATE : PACER_NTSC_FRAME_RATE;
+}
+
+void FramePacer::throttle(double frameRate, SPU &spu) {
+    if (!enabled.load()) {
+        has_deadline = false;
+        return;
+    }
+
+    if (clock.load() == Clock::AUDIO && throttle_to_audio_clock(spu)) {
+        // Resynchronize the host clock when switching back to it
+        has_deadline = false;
+        return;
+    }
+
+    throttle_to_host_clock(frameRate);
+}
+
+void FramePacer::throttle_to_host_clock(double frame_rate) {
+    std::chrono::steady_clock::duration frame_duration =
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / frame_rate));
+    TimePoint now = std::chrono::steady_clock::now();
+
+    if (!has_deadline || now > next_deadline + PACER_MAX_FRAMES_BEHIND * frame_duration) {
+        // Do not try to catch up after pauses or slow sections
+        next_deadline = now;
+        has_deadline = true;
+        return;
+    }
+
+    // Advance the deadline by exactly one frame to avoid accumulating drift
+    next_deadline += frame_duration;
+    sleep_then_spin(next_deadline);
+}
+
+bool FramePacer::throttle_to_audio_clock(SPU &spu) {
+    double queued = spu.get_queued_audio_duration();
+    if (queued <= 0.0) {
+        // No audio output or nothing produced yet
+        return false;
+    }
+
+    // Dynamic rate control: slightly adjust the playback rate to keep the queue at the target latency
+    double error = std::clamp((queued - PACER_AUDIO_TARGET_LATENCY) / PACER_AUDIO_TARGET_LATENCY, -1.0, 1.0);
+    spu.set_audio_frequency_ratio(1.0 + PACER_AUDIO_MAX_RATE_DEVIATION * error);
+
+    // The audio device consumes samples in real time, wait until the queue has drained to the target
+    if (queued > PACER_AUDIO_TARGET_LATENCY) {
+        std::chrono::steady_clock::duration excess =
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(queued - PACER_AUDIO_TARGET_LATENCY));
+        sleep_then_spin(std::chrono::steady_clock::now() + excess);
+    }
+
+    return true;
+}
+
+void FramePacer::sleep_then_spin(TimePoint deadline) {
+    // The OS scheduler can oversleep by more than a millisecond,
+    // so we only sleep for the coarse part and spin for the rest
+    TimePoint sleep_until = deadline - PACER_SPIN_DURATION;
+    if (std::chrono::steady_clock::now() < sleep_until) {
+        std::this_thread::sleep_until(sleep_until);
+    }
+
+    while (std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
+
+void FramePacer::recordFrame(double frameRate) {
+    TimePoint now = std::chrono::steady_clock::now();
+
+    if (!has_last_frame) {
+        last_frame = now;
+        has_last_frame = true;
+        return;
+    }
+
+    double frame_time = std::chrono::duration<double, std::milli>(now - last_frame).count();
+    double target_frame_time = 1000.0 / frameRate;
+    last_frame = now;
+
+    ++period_frames;
+    period_sum += frame_time;
+    period_sum_of_squares += frame_time * frame_time;
+    period_max_deviation = std::max(period_max_deviation, std::abs(frame_time - target_frame_time));
+
+    if (period_frames >= std::lround(frameRate)) {
+        Statistics period;
+        period.frames = period_frames;
+        period.average_frame_time = period_sum / period_frames;
+        period.jitter = std::sqrt(std::max(0.0, period_sum_of_squares / period_frames
+                                                - period.average_frame_time * period.average_frame_time));
+        period.max_deviation = period_max_deviation;
+        period.speed = target_frame_time / period.average_frame_time;
+
+        LOGV_MISC(std::format("Speed {:.1f}%, frame time {:.3f} ms, jitter {:.3f} ms, max deviation {:.3f} ms",
+                              period.speed * 100.0, period.average_frame_time, period.jitter, period.max_deviation));
+
+        {
+            std::lock_guard<std::mutex> lock(statistics_mutex);
+            statistics = period;
+        }
+
+        period_frames = 0;
+        period_sum = 0.0;
+        period_sum_of_squares = 0.0;
+        period_max_deviation = 0.0;
+    }
+}
+
+FramePacer::Statistics FramePacer::getStatistics() const {
+    std::lock_guard<std::mutex> lock(statistics_mutex);
+    return statistics;
+}
+
+}
@@ -0,0 +1,86 @@
+#ifndef PSX_PACER_H
+#define PSX_PACER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+namespace PSX {
+
+// Nominal frame rates of the video modes in GPUSTAT_VIDEO_MODE
+#define PACER_NTSC_FRAME_RATE 59.94
+#define PACER_PAL_FRAME_RATE 50.0
+
+// Sleep until this long before the deadline, then spin
+#define PACER_SPIN_DURATION std::chrono::microseconds(1500)
+// Resynchronize instead of catching up when falling behind by more frames than this
+#define PACER_MAX_FRAMES_BEHIND 4
+
+// Audio-clocked throttling: keep this much audio queued
+#define PACER_AUDIO_TARGET_LATENCY 0.05 // in seconds
+// Maximum deviation of the audio playback rate due to dynamic rate control
+#define PACER_AUDIO_MAX_RATE_DEVIATION 0.005
+
+class SPU;
+
+class FramePacer {
+public:
+    enum class Clock {
+        HOST,
+        AUDIO
+    };
+
+    struct Statistics {
+        double speed; // emulated frames per host second relative to the nominal frame rate
+        double average_frame_time; // in milliseconds
+        double jitter; // standard deviation of the frame time in milliseconds
+        double max_deviation; // maximum deviation from the target frame time in milliseconds
+        uint32_t frames;
+    };
+
+private:
+    std::atomic<bool> enabled;
+    std::atomic<Clock> clock;
+
+    using TimePoint = std::chrono::steady_clock::time_point;
+    TimePoint next_deadline;
+    bool has_deadline;
+    TimePoint last_frame;
+    bool has_last_frame;
+
+    // Statistics over the current reporting period
+    uint32_t period_frames;
+    double period_sum;
+    double period_sum_of_squares;
+    double period_max_deviation;
+    mutable std::mutex statistics_mutex;
+    Statistics statistics;
+
+public:
+    FramePacer();
+    void reset();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    void setClock(Clock clock);
+    Clock getClock() const;
+
+    static double frameRateOfVideoMode(bool pal);
+
+    // Block until the frame that was just emulated is due
+    void throttle(double frameRate, SPU &spu);
+    // Account for a finished frame in the statistics, throttled or not
+    void recordFrame(double frameRate);
+    // Statistics of the last completed reporting period (about one second of frames)
+    Statistics getStatistics() const;
+
+private:
+    void throttle_to_host_clock(double frame_rate);
+    bool throttle_to_audio_clock(SPU &spu);
+    static void sleep_then_spin(TimePoint deadline);
+};
+
+}
+
+#endif
@@ -0,0 +1,230 @@
+#include "displayconverter.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DISPLAY_CONVERTER_X86
+#include <immintrin.h>
+#endif
+
+namespace PSX {
+
+namespace {
+
+// VRAM line in halfwords and bytes
+const uint32_t LINE_HALFWORDS = 1024;
+const uint32_t LINE_BYTES = 2048;
+
+inline uint32_t convert_15_bit_pixel(uint16_t color) {
+    uint32_t r = color & 0x1F;
+    uint32_t g = (color >> 5) & 0x1F;
+    uint32_t b = (color >> 10) & 0x1F;
+    // expand 5 to 8 bits by replicating the upper bits
+    r = (r << 3) | (r >> 2);
+    g = (g << 3) | (g >> 2);
+    b = (b << 3) | (b >> 2);
+    return r | (g << 8) | (b << 16) | 0xFF000000;
+}
+
+// The kernels convert up to count pixels and return how many they have converted.
+// The 24-bit kernels may read up to 4 bytes past the last pixel.
+typedef uint32_t (*Convert15BitKernel)(const uint16_t *in, uint32_t count, uint32_t *out);
+typedef uint32_t (*Convert24BitKernel)(const uint8_t *in, uint32_t count, uint32_t *out);
+
+uint32_t convert_15_bit_scalar(const uint16_t *in, uint32_t count, uint32_t *out) {
+    for (uint32_t i = 0; i < count; ++i) {
+        out[i] = convert_15_bit_pixel(in[i]);
+    }
+    return count;
+}
+
+uint32_t convert_24_bit_scalar(const uint8_t *in, uint32_t count, uint32_t *out) {
+    for (uint32_t i = 0; i < count; ++i) {
+        out[i] = in[3 * i] | (in[3 * i + 1] << 8) | (in[3 * i + 2] << 16) | 0xFF000000;
+    }
+    return count;
+}
+
+#ifdef DISPLAY_CONVERTER_X86
+// Converts eight 15-bit pixels in 16-bit lanes into r | g << 8 and b | 0xFF << 8
+__attribute__((target("sse2")))
+inline void expand_15_bit_sse2(__m128i c, __m128i &rg, __m128i &ba) {
+    const __m128i mask_low5 = _mm_set1_epi16(0x1F);
+    const __m128i mask_high5 = _mm_set1_epi16(0xF8);
+    const __m128i mask_low3 = _mm_set1_epi16(0x07);
+
+    __m128i r = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(c, mask_low5), 3),
+                             _mm_and_si128(_mm_srli_epi16(c, 2), mask_low3));
+    __m128i g = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(c, 2), mask_high5),
+                             _mm_and_si128(_mm_srli_epi16(c, 7), mask_low3));
+    __m128i b = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(c, 7), mask_high5),
+                             _mm_and_si128(_mm_srli_epi16(c, 12), mask_low3));
+
+    rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+    ba = _mm_or_si128(b, _mm_set1_epi16((short)0xFF00));
+}
+
+__attribute__((target("sse2")))
+uint32_t convert_15_bit_sse2(const uint16_t *in, uint32_t count, uint32_t *out) {
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i rg, ba;
+        expand_15_bit_sse2(_mm_loadu_si128((const __m128i*)(in + i)), rg, ba);
+
+        _mm_storeu_si128((__m128i*)(out + i), _mm_unpacklo_epi16(rg, ba));
+        _mm_storeu_si128((__m128i*)(out + i + 4), _mm_unpackhi_epi16(rg, ba));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+uint32_t convert_15_bit_avx2(const uint16_t *in, uint32_t count, uint32_t *out) {
+    const __m256i mask_low5 = _mm256_set1_epi16(0x1F);
+    const __m256i mask_high5 = _mm256_set1_epi16(0xF8);
+    const __m256i mask_low3 = _mm256_set1_epi16(0x07);
+    const __m256i alpha = _mm256_set1_epi16((short)0xFF00);
+
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i c = _mm256_loadu_si256((const __m256i*)(in + i));
+
+        __m256i r = _mm256_or_si256(_mm256_slli_epi16(_mm256_and_si256(c, mask_low5), 3),
+                                    _mm256_and_si256(_mm256_srli_epi16(c, 2), mask_low3));
+        __m256i g = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(c, 2), mask_high5),
+                                    _mm256_and_si256(_mm256_srli_epi16(c, 7), mask_low3));
+        __m256i b = _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi16(c, 7), mask_high5),
+                                    _mm256_and_si256(_mm256_srli_epi16(c, 12), mask_low3));
+
+        __m256i rg = _mm256_or_si256(r, _mm256_slli_epi16(g, 8));
+        __m256i ba = _mm256_or_si256(b, alpha);
+
+        // Unpacking works within 128-bit lanes: lo holds pixels 0-3 and 8-11, hi holds 4-7 and 12-15
+        __m256i lo = _mm256_unpacklo_epi16(rg, ba);
+        __m256i hi = _mm256_unpackhi_epi16(rg, ba);
+
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i*)(out + i + 8), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+
+    return i + convert_15_bit_sse2(in + i, count - i, out + i);
+}
+
+__attribute__((target("ssse3")))
+uint32_t convert_24_bit_ssse3(const uint8_t *in, uint32_t count, uint32_t *out) {
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32(0xFF000000);
+
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        // Reads 16 bytes of which the first 12 are four RGB pixels
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(in + 3 * i));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_or_si128(_mm_shuffle_epi8(bytes, shuffle), alpha));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+uint32_t convert_24_bit_avx2(const uint8_t *in, uint32_t count, uint32_t *out) {
+    const __m256i shuffle = _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+                                             0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m256i alpha = _mm256_set1_epi32(0xFF000000);
+
+    uint32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // Four pixels per 128-bit lane since shuffles cannot cross lanes
+        __m128i first = _mm_loadu_si128((const __m128i*)(in + 3 * i));
+        __m128i second = _mm_loadu_si128((const __m128i*)(in + 3 * i + 12));
+        __m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_or_si256(_mm256_shuffle_epi8(bytes, shuffle), alpha));
+    }
+
+    return i + convert_24_bit_ssse3(in + 3 * i, count - i, out + i);
+}
+#endif
+
+struct Kernels {
+    Convert15BitKernel convert_15_bit;
+    Convert24BitKernel convert_24_bit;
+
+    Kernels()
+        : convert_15_bit(convert_15_bit_scalar),
+          convert_24_bit(convert_24_bit_scalar) {
+#ifdef DISPLAY_CONVERTER_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            convert_15_bit = convert_15_bit_avx2;
+            convert_24_bit = convert_24_bit_avx2;
+        } else {
+            convert_15_bit = convert_15_bit_sse2;
+            if (__builtin_cpu_supports("ssse3")) {
+                convert_24_bit = convert_24_bit_ssse3;
+            }
+        }
+#endif
+    }
+};
+
+const Kernels& kernels() {
+    static const Kernels selected;
+    return selected;
+}
+
+}
+
+uint32_t DisplayConverter::get_output_height(const DisplayArea &area, Field field) {
+    if (field == Field::BOTH) {
+        return area.height;
+    }
+
+    return area.height / 2;
+}
+
+void DisplayConverter::convert(const uint8_t *vram, const DisplayArea &area, Field field, uint32_t *out, uint32_t pitch) {
+    uint32_t height = get_output_height(area, field);
+    uint32_t first_line = field == Field::ODD ? 1 : 0;
+    uint32_t line_step = field == Field::BOTH ? 1 : 2;
+
+    for (uint32_t y = 0; y < height; ++y) {
+        uint32_t line = (area.y + first_line + y * line_step) % 512;
+
+        if (area.color_24_bit) {
+            convert_line_24_bit(&vram[line * LINE_BYTES], area.x, area.width, &out[y * pitch]);
+        } else {
+            convert_line_15_bit((const uint16_t*)&vram[line * LINE_BYTES], area.x, area.width, &out[y * pitch]);
+        }
+    }
+}
+
+void DisplayConverter::convert_line_15_bit(const uint16_t *line, uint32_t x, uint32_t width, uint32_t *out) {
+    uint32_t done = 0;
+
+    while (done < width) {
+        // Convert the contiguous part up to the end of the VRAM line, then wrap around
+        uint32_t start = (x + done) % LINE_HALFWORDS;
+        uint32_t count = std::min(width - done, LINE_HALFWORDS - start);
+
+        uint32_t converted = kernels().convert_15_bit(&line[start], count, &out[done]);
+        convert_15_bit_scalar(&line[start + converted], count - converted, &out[done + converted]);
+        done += count;
+    }
+}
+
+void DisplayConverter::convert_line_24_bit(const uint8_t *line, uint32_t x, uint32_t width, uint32_t *out) {
+    // 24-bit pixels are stored as consecutive RGB bytes, starting at halfword x
+    uint32_t offset = (x * 2) % LINE_BYTES;
+
+    // The vector kernels must not read past the end of the VRAM line
+    uint32_t available_bytes = LINE_BYTES - offset;
+    uint32_t vector_count = available_bytes >= 4 ? std::min(width, (available_bytes - 4) / 3) : 0;
+    uint32_t done = kernels().convert_24_bit(&line[offset], vector_count, out);
+
+    for (; done < width; ++done) {
+        uint32_t byte = offset + 3 * done;
+        uint32_t r = line[byte % LINE_BYTES];
+        uint32_t g = line[(byte + 1) % LINE_BYTES];
+        uint32_t b = line[(byte + 2) % LINE_BYTES];
+        out[done] = r | (g << 8) | (b << 16) | 0xFF000000;
+    }
+}
+
+}
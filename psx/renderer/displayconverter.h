@@ -0,0 +1,40 @@
+#ifndef PSX_RENDERER_DISPLAYCONVERTER_H
+#define PSX_RENDERER_DISPLAYCONVERTER_H
+
+#include <cstdint>
+
+namespace PSX {
+
+// Extracts the display area from VRAM and converts it to RGBA8 (R in the lowest byte).
+// Independent of any graphics API, so it can be used for presentation, screenshots and capture.
+class DisplayConverter {
+public:
+    struct DisplayArea {
+        uint32_t x; // in halfwords
+        uint32_t y; // in lines
+        uint32_t width; // in pixels
+        uint32_t height; // in lines
+        bool color_24_bit;
+    };
+
+    // Which lines of an interlaced display area to output
+    enum class Field {
+        BOTH, // weave both fields
+        EVEN,
+        ODD
+    };
+
+    // Number of lines convert() produces
+    static uint32_t get_output_height(const DisplayArea &area, Field field);
+
+    // vram points to 1024x512 halfwords, out receives get_output_height() lines of area.width pixels,
+    // consecutive lines are pitch pixels apart
+    static void convert(const uint8_t *vram, const DisplayArea &area, Field field, uint32_t *out, uint32_t pitch);
+
+    static void convert_line_15_bit(const uint16_t *line, uint32_t x, uint32_t width, uint32_t *out);
+    static void convert_line_24_bit(const uint8_t *line, uint32_t x, uint32_t width, uint32_t *out);
+};
+
+}
+
+#endif
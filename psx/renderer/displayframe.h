@@ -0,0 +1,28 @@
+#ifndef PSX_RENDERER_DISPLAYFRAME_H
+#define PSX_RENDERER_DISPLAYFRAME_H
+
+#include <cstdint>
+#include <vector>
+
+namespace PSX {
+
+#define DISPLAY_FRAME_MAX_WIDTH 1024
+#define DISPLAY_FRAME_MAX_HEIGHT 512
+
+// A finished frame as it appears on screen, i.e., the display area of VRAM
+// converted to RGBA8 (R in the lowest byte), top line first
+struct DisplayFrame {
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint32_t> pixels;
+
+    DisplayFrame()
+        : width(0),
+          height(0),
+          pixels(DISPLAY_FRAME_MAX_WIDTH * DISPLAY_FRAME_MAX_HEIGHT) {
+    }
+};
+
+}
+
+#endif
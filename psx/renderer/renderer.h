@@ -109,6 +109,8 @@ public:
     virtual void set_drawing_offset(int32_t x, int32_t y) = 0;
     virtual void set_display_area(uint32_t x, uint32_t y, uint32_t width, uint32_t height) = 0;
     virtual void set_display_area_color_depth(bool enable_24_bit) = 0;
+    // Polygons are dropped while rasterization is disabled, VRAM transfers and fills are still performed
+    virtual void set_rasterization_enabled(bool enabled) = 0;
 };
 
 }
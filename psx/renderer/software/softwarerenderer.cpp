@@ -6,6 +6,7 @@
 #include <format>
 #include <iostream>
 
+#include "renderer/displayconverter.h"
 #include "renderer/screen.h"
 #include "util/log.h"
 #include "gl.h"
@@ -15,7 +16,8 @@ using namespace util;
 namespace PSX {
 
 SoftwareRenderer::SoftwareRenderer(Screen *screen, Screen *vramViewer)
-    : screen(screen), vramViewer(vramViewer) {
+    : screen(screen), vramViewer(vramViewer),
+      vram_snapshots(std::vector<uint8_t>(VRAM_SIZE)) {
 
     vram = new uint8_t[VRAM_SIZE];
     reset();
@@ -49,10 +51,10 @@ void SoftwareRenderer::initialize() {
 
     glCheckError();
 
-    // texture attachment
+    // texture attachment, holds converted display frames
     glGenTextures(1, &screenTexture);
     glBindTexture(GL_TEXTURE_2D, screenTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1024, 512, 0, GL_RGBA,  GL_UNSIGNED_SHORT_1_5_5_5_REV, nullptr);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, DISPLAY_FRAME_MAX_WIDTH, DISPLAY_FRAME_MAX_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, screenTexture, 0);
@@ -92,6 +94,8 @@ void SoftwareRenderer::reset() {
     display_area_width = 640;
     display_area_height = 480;
     display_area_24_bit = false;
+
+    rasterization_enabled = true;
 }
 
 void SoftwareRenderer::clear() {
@@ -133,40 +137,62 @@ void SoftwareRenderer::computeVRAMViewport() {
 }
 
 void SoftwareRenderer::swapBuffers() {
-    // upload vram to texture
-    glBindTexture(GL_TEXTURE_2D, screenTexture);
-    if (display_area_24_bit) {
-    //if (true) {
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 682, 512, GL_RGB,  GL_UNSIGNED_BYTE, vram);
-    } else {
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1024, 512, GL_RGBA,  GL_UNSIGNED_SHORT_1_5_5_5_REV, vram);
+    // Hand the display area over to the presentation thread
+    convert_display_area(display_frames.write_buffer());
+    display_frames.publish();
+
+    if (vramViewer && vramViewer->isVisible()) {
+        std::memcpy(vram_snapshots.write_buffer().data(), vram, VRAM_SIZE);
+        vram_snapshots.publish();
     }
+}
 
-    // compute viewport coordinates from window size
-    computeViewport();
+uint32_t SoftwareRenderer::getFrameSequence() const {
+    return display_frames.get_sequence();
+}
 
-    // screen window
-    screen->makeContextCurrent();
+void SoftwareRenderer::waitForFrame(uint32_t seenSequence) const {
+    display_frames.wait(seenSequence);
+}
 
-    // set new viewport
-    glViewport(viewportX, viewportY, viewportWidth, viewportHeight);
+void SoftwareRenderer::wakeUpPresentation() {
+    display_frames.wake_up();
+}
 
-    // blit screen framebuffer to default framebuffer
-    glBindFramebuffer(GL_READ_FRAMEBUFFER, screenFramebuffer);
-    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
-    //glBlitFramebuffer(0, 0, 1024, 512,
-    glBlitFramebuffer(display_area_top_left_x, display_area_top_left_y, display_area_top_left_x + display_area_width, display_area_top_left_y + display_area_height,
-                      //viewportX, viewportY, viewportX + viewportWidth, viewportY + viewportHeight,
-                      viewportX, viewportY + viewportHeight, viewportX + viewportWidth, viewportY, // flip texture along y-axis
-                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
-    glCheckError();
+void SoftwareRenderer::presentFrame() {
+    if (display_frames.acquire()) {
+        const DisplayFrame &frame = display_frames.read_buffer();
 
-    // swap buffers
-    screen->swapBuffers();
+        if (frame.width > 0 && frame.height > 0) {
+            // upload frame to texture
+            glBindTexture(GL_TEXTURE_2D, screenTexture);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, frame.width, frame.height, GL_RGBA, GL_UNSIGNED_BYTE, frame.pixels.data());
 
-    if (vramViewer && vramViewer->isVisible()) {
+            // compute viewport coordinates from window size
+            computeViewport();
+
+            // screen window
+            screen->makeContextCurrent();
+
+            // set new viewport
+            glViewport(viewportX, viewportY, viewportWidth, viewportHeight);
+
+            // blit screen framebuffer to default framebuffer
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, screenFramebuffer);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+            glBlitFramebuffer(0, 0, frame.width, frame.height,
+                              viewportX, viewportY + viewportHeight, viewportX + viewportWidth, viewportY, // flip texture along y-axis
+                              GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            glCheckError();
+
+            // swap buffers
+            screen->swapBuffers();
+        }
+    }
+
+    if (vramViewer && vramViewer->isVisible() && vram_snapshots.acquire()) {
         glBindTexture(GL_TEXTURE_2D, vramTexture);
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1024, 512, GL_RGBA,  GL_UNSIGNED_SHORT_1_5_5_5_REV, vram);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1024, 512, GL_RGBA,  GL_UNSIGNED_SHORT_1_5_5_5_REV, vram_snapshots.read_buffer().data());
         glCheckError();
 
         computeVRAMViewport();
@@ -181,8 +207,6 @@ void SoftwareRenderer::swapBuffers() {
         glBindFramebuffer(GL_READ_FRAMEBUFFER, vramFramebuffer);
         glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
         glBlitFramebuffer(0, 0, 1024, 512,
-                          //viewportX, viewportY, viewportX + viewportWidth, viewportY + viewportHeight,
-                          //0, 512, 1024, 0, // flip texture along y-axis
                           vramViewportX, vramViewportY + vramViewportHeight, vramViewportX + vramViewportWidth, vramViewportY, // flip texture along y-axis
                           GL_COLOR_BUFFER_BIT, GL_NEAREST);
 
@@ -193,6 +217,21 @@ void SoftwareRenderer::swapBuffers() {
     }
 }
 
+void SoftwareRenderer::convert_display_area(DisplayFrame &frame) const {
+    DisplayConverter::DisplayArea area = {
+        display_area_top_left_x,
+        display_area_top_left_y,
+        std::min(display_area_width, (uint32_t)DISPLAY_FRAME_MAX_WIDTH),
+        std::min(display_area_height, (uint32_t)DISPLAY_FRAME_MAX_HEIGHT),
+        display_area_24_bit
+    };
+
+    // Interlaced frames are presented with both fields woven together
+    frame.width = area.width;
+    frame.height = DisplayConverter::get_output_height(area, DisplayConverter::Field::BOTH);
+    DisplayConverter::convert(vram, area, DisplayConverter::Field::BOTH, frame.pixels.data(), frame.width);
+}
+
 void SoftwareRenderer::writeToVRAM(uint32_t x, uint32_t y, uint16_t value) {
     //LOGT_REND(std::format("VRAM write 0x{:04X} -> line {:d}, position {:d}",
     //                          value, line, pos));
@@ -246,8 +285,16 @@ void SoftwareRenderer::set_display_area_color_depth(bool enable_24_bit) {
     display_area_24_bit = enable_24_bit;
 }
 
+void SoftwareRenderer::set_rasterization_enabled(bool enabled) {
+    rasterization_enabled = enabled;
+}
+
 void SoftwareRenderer::drawTriangle(const Triangle &triangle) {
     LOGT_REND(std::format("drawTriangle({},{},{})", triangle.v1, triangle.v2, triangle.v3));
+    if (!rasterization_enabled) {
+        return;
+    }
+
     ColoredPoint a = {
         triangle.v1.x + drawing_offset_x, triangle.v1.y + drawing_offset_y,
         { triangle.c1.r, triangle.c1.g, triangle.c1.b }
@@ -267,6 +314,10 @@ void SoftwareRenderer::drawTriangle(const Triangle &triangle) {
 
 void SoftwareRenderer::drawTexturedTriangle(const TexturedTriangle &triangle) {
     LOGT_REND(std::format("drawTexturedTriangle({},{},{})", triangle.v1, triangle.v2, triangle.v3));
+    if (!rasterization_enabled) {
+        return;
+    }
+
     TexturedPoint a = {
         triangle.v1.x + drawing_offset_x, triangle.v1.y + drawing_offset_y,
         { triangle.tc1.x, triangle.tc1.y }
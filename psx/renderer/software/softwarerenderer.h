@@ -1,10 +1,13 @@
 #ifndef PSX_RENDERER_SOFTWARERENDERER_H
 #define PSX_RENDERER_SOFTWARERENDERER_H
 
+#include <atomic>
 #include <cstdint>
 #include <vector>
 
+#include "renderer/displayframe.h"
 #include "renderer/renderer.h"
+#include "util/triplebuffer.h"
 
 namespace PSX {
 
@@ -17,6 +20,7 @@ public:
     SoftwareRenderer(Screen *screen, Screen *vramViewer);
     virtual ~SoftwareRenderer();
 
+    // Called by the presentation thread, which owns the OpenGL context
     void initialize();
 
     void installVRAMViewer(Screen *vramViewer);
@@ -25,8 +29,15 @@ public:
     void clear() override;
     void computeViewport();
     void computeVRAMViewport();
+    // Hands the finished frame over to the presentation thread, never blocks
     void swapBuffers() override;
 
+    // Presentation thread
+    uint32_t getFrameSequence() const;
+    void waitForFrame(uint32_t seenSequence) const;
+    void wakeUpPresentation();
+    void presentFrame();
+
     void writeToVRAM(uint32_t line, uint32_t pos, uint16_t value) override;
     uint16_t readFromVRAM(uint32_t line, uint32_t pos) override;
     void fillRectangleInVRAM(const PSX::Color &c, uint32_t x, uint32_t y, uint32_t width, uint32_t height) override;
@@ -35,6 +46,7 @@ public:
     void set_drawing_offset(int32_t x, int32_t y) override;
     void set_display_area(uint32_t x, uint32_t y, uint32_t width, uint32_t height) override;
     void set_display_area_color_depth(bool enable_24_bit) override;
+    void set_rasterization_enabled(bool enabled) override;
 
     void drawTriangle(const Triangle &triangle) override;
     void drawTexturedTriangle(const TexturedTriangle &triangle) override;
@@ -132,11 +144,17 @@ private:
         }
     }
 
+    void convert_display_area(DisplayFrame &frame) const;
+
 private:
     Screen *screen;
     Screen *vramViewer;
     uint8_t *vram;
 
+    // Frames produced by the emulation thread and consumed by the presentation thread
+    util::TripleBuffer<DisplayFrame> display_frames;
+    util::TripleBuffer<std::vector<uint8_t>> vram_snapshots;
+
     unsigned int vramFramebuffer;
     unsigned int vramTexture;
 
@@ -161,6 +179,8 @@ private:
     uint32_t display_area_width;
     uint32_t display_area_height;
     bool display_area_24_bit;
+
+    bool rasterization_enabled;
 };
 
 }
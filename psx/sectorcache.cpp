@@ -0,0 +1,130 @@
+#include "sectorcache.h"
+
+#include <format>
+
+#include "util/log.h"
+
+using namespace util;
+
+namespace PSX {
+
+SectorCache::SectorCache(ReadFunction read, uint32_t window)
+    : read(std::move(read)),
+      window(window),
+      capacity(window * SECTOR_CACHE_WINDOWS),
+      statistics{},
+      pending_request(false),
+      request_lba(0),
+      stopping(false) {
+    worker = std::thread(&SectorCache::run, this);
+}
+
+SectorCache::~SectorCache() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_one();
+    worker.join();
+}
+
+std::shared_ptr<const SectorCache::SectorData> SectorCache::get(uint32_t lba) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = entry_of_lba.find(lba);
+        if (it != entry_of_lba.end()) {
+            ++statistics.hits;
+            entries.splice(entries.begin(), entries, it->second);
+            return it->second->data;
+        }
+        ++statistics.misses;
+    }
+
+    // Do not block the worker while reading
+    std::shared_ptr<SectorData> data = std::make_shared<SectorData>();
+    if (!read(lba, data->data())) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    insert(lba, data);
+    return data;
+}
+
+void SectorCache::prefetch(uint32_t lba) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending_request = true;
+        request_lba = lba;
+    }
+    condition.notify_one();
+}
+
+uint32_t SectorCache::get_window() const {
+    return window;
+}
+
+SectorCache::Statistics SectorCache::get_statistics() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return statistics;
+}
+
+void SectorCache::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true) {
+        condition.wait(lock, [this] { return stopping || pending_request; });
+        if (stopping) {
+            return;
+        }
+
+        uint32_t first = request_lba;
+        pending_request = false;
+
+        for (uint32_t lba = first; lba < first + window; ++lba) {
+            if (stopping || pending_request) {
+                // Superseded by a newer request
+                break;
+            }
+
+            if (entry_of_lba.contains(lba)) {
+                continue;
+            }
+
+            lock.unlock();
+            std::shared_ptr<SectorData> data = std::make_shared<SectorData>();
+            bool exists = read(lba, data->data());
+            lock.lock();
+
+            if (!exists) {
+                // End of disc
+                break;
+            }
+
+            if (!entry_of_lba.contains(lba)) {
+                ++statistics.prefetched;
+                insert(lba, std::move(data));
+            }
+        }
+    }
+}
+
+void SectorCache::insert(uint32_t lba, std::shared_ptr<const SectorData> data) {
+    auto it = entry_of_lba.find(lba);
+    if (it != entry_of_lba.end()) {
+        // Read concurrently by the worker and on a miss
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+
+    entries.push_front(Entry{lba, std::move(data)});
+    entry_of_lba[lba] = entries.begin();
+
+    while (entries.size() > capacity) {
+        entry_of_lba.erase(entries.back().lba);
+        entries.pop_back();
+        ++statistics.evicted;
+    }
+}
+
+}
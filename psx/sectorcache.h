@@ -0,0 +1,84 @@
+#ifndef PSX_SECTORCACHE_H
+#define PSX_SECTORCACHE_H
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace PSX {
+
+// The cache holds this many prefetch windows
+#define SECTOR_CACHE_WINDOWS 4
+
+// Bounded LRU cache of disc sectors keyed by absolute sector number (LBA).
+// A worker thread speculatively reads the sectors following a prefetch position,
+// so that slow storage (e.g., network file systems) does not stall emulation.
+class SectorCache {
+public:
+    static const uint32_t SECTOR_SIZE = 2352;
+    using SectorData = std::array<uint8_t, SECTOR_SIZE>;
+
+    // Reads the sector at the given LBA into the buffer, returns false if there is no such sector.
+    // Called from the worker thread as well as from the thread calling get(), has to be thread-safe.
+    using ReadFunction = std::function<bool(uint32_t lba, uint8_t *buffer)>;
+
+    struct Statistics {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t prefetched;
+        uint64_t evicted;
+    };
+
+private:
+    ReadFunction read;
+    const uint32_t window;
+    const uint32_t capacity;
+
+    struct Entry {
+        uint32_t lba;
+        std::shared_ptr<const SectorData> data;
+    };
+    // Most recently used first
+    std::list<Entry> entries;
+    std::unordered_map<uint32_t, std::list<Entry>::iterator> entry_of_lba;
+
+    Statistics statistics;
+
+    // Prefetch request for the worker, a newer request supersedes an older one
+    bool pending_request;
+    uint32_t request_lba;
+    bool stopping;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::thread worker;
+
+public:
+    SectorCache(ReadFunction read, uint32_t window);
+    SectorCache(const SectorCache&) = delete;
+    ~SectorCache();
+
+    // Returns the sector, reading it on the calling thread on a miss (nullptr if it does not exist).
+    // The returned data stays valid as long as the caller holds on to it, even if evicted.
+    std::shared_ptr<const SectorData> get(uint32_t lba);
+    // Read the window of sectors starting at lba in the background
+    void prefetch(uint32_t lba);
+
+    uint32_t get_window() const;
+    Statistics get_statistics();
+
+private:
+    void run();
+    // Expects the mutex to be held
+    void insert(uint32_t lba, std::shared_ptr<const SectorData> data);
+};
+
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include "spu.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
 #include <cstring>
 #include <format>
@@ -16,6 +18,26 @@ using namespace util;
 
 namespace PSX {
 
+namespace {
+
+// The voice flags are split into halfwords: voices 0 to 15 and voices 16 to 23
+uint32_t replace_voice_flags(uint32_t flags, uint16_t value, bool upper) {
+    if (upper) {
+        return (flags & 0x0000'FFFF) | ((value & 0xFF) << 16);
+    }
+    return (flags & 0xFFFF'0000) | value;
+}
+
+uint16_t get_voice_flags(uint32_t flags, bool upper) {
+    return upper ? flags >> 16 : flags & 0xFFFF;
+}
+
+int16_t clamp(int32_t sample) {
+    return std::clamp(sample, -0x8000, 0x7FFF);
+}
+
+}
+
 std::string SPU::get_control_register_explanation(uint16_t reg) {
     std::stringstream ss;
 
@@ -54,10 +76,11 @@ std::string SPU::get_status_register_explanation(uint16_t reg) {
 
 SPU::SPU(Bus *bus)
     : bus(bus),
-      ram(std::make_unique<uint8_t[]>(SPU_RAM_SIZE)) {
+      ram(std::make_unique<uint8_t[]>(SPU_RAM_SIZE)),
+      voices(ram.get()) {
     SDL_SetHint(SDL_HINT_NO_SIGNAL_HANDLERS, "1");
     SDL_Init(SDL_INIT_AUDIO);
-    audio_spec.format = SDL_AUDIO_U8;
+    audio_spec.format = SDL_AUDIO_S16;
     audio_spec.channels = 2;
     audio_spec.freq = 44100;
     audio_stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &audio_spec, nullptr, nullptr);
@@ -92,6 +115,15 @@ SPU::~SPU() {
 void SPU::reset() {
     std::memset(ram.get(), 0, SPU_RAM_SIZE);
 
+    voices.reset();
+    pending_cycles = 0;
+    main_volume_left.write(0, main_level_left);
+    main_volume_right.write(0, main_level_right);
+    reverb_output_volume_left = 0;
+    reverb_output_volume_right = 0;
+    key_on_register = 0;
+    key_off_register = 0;
+
     irq_address_register = 0;
     data_transfer_address_register = 0;
     data_transfer_address = 0;
@@ -99,6 +131,106 @@ void SPU::reset() {
     control_register = 0;
     data_transfer_control_register = 0;
     status_register = 0;
+    cd_input_volume_left = 0;
+    cd_input_volume_right = 0;
+    cd_input.clear();
+    cd_input_position = 0;
+}
+
+void SPU::catchUpToCPU(uint32_t cycles) {
+    pending_cycles += cycles;
+    while (pending_cycles >= SPU_BATCH_FRAMES * SPU_CYCLES_PER_SAMPLE) {
+        pending_cycles -= SPU_BATCH_FRAMES * SPU_CYCLES_PER_SAMPLE;
+        generate_batch();
+    }
+}
+
+void SPU::generate_batch() {
+    std::array<int32_t, SPU_BATCH_FRAMES> left;
+    std::array<int32_t, SPU_BATCH_FRAMES> right;
+    if (Bit::getBit(control_register, SPU_CONTROL_ENABLE)) {
+        voices.render(SPU_BATCH_FRAMES, control_register, left.data(), right.data());
+    } else {
+        left.fill(0);
+        right.fill(0);
+    }
+    bool muted = !Bit::getBit(control_register, SPU_CONTROL_MUTE);
+
+    // The CD input has been scaled by its volume already, missing frames are silence
+    size_t cd_frames = std::min<size_t>((cd_input.size() - cd_input_position) / 2, SPU_BATCH_FRAMES);
+    const int16_t *cd = cd_input.data() + cd_input_position;
+
+    std::array<int16_t, 2 * SPU_BATCH_FRAMES> output;
+    for (uint32_t i = 0; i < SPU_BATCH_FRAMES; ++i) {
+        int32_t mixed_left = muted ? 0 : clamp(left[i]);
+        int32_t mixed_right = muted ? 0 : clamp(right[i]);
+        if (i < cd_frames) {
+            mixed_left += cd[2 * i];
+            mixed_right += cd[2 * i + 1];
+        }
+        output[2 * i] = (clamp(mixed_left) * main_level_left) >> 15;
+        output[2 * i + 1] = (clamp(mixed_right) * main_level_right) >> 15;
+
+        if (main_volume_left.is_sweeping()) {
+            main_volume_left.tick(main_level_left);
+        }
+        if (main_volume_right.is_sweeping()) {
+            main_volume_right.tick(main_level_right);
+        }
+    }
+
+    cd_input_position += 2 * cd_frames;
+    if (cd_input_position == cd_input.size()) {
+        cd_input.clear();
+        cd_input_position = 0;
+    }
+
+    if (audio_stream && !SDL_PutAudioStreamData(audio_stream, output.data(), output.size() * sizeof(int16_t))) {
+        LOGW_SPU(std::format("Error writing data to audio stream: {:s}", SDL_GetError()));
+    }
+}
+
+void SPU::mix_cd_audio(std::span<const int16_t> samples) {
+    bool enabled = Bit::getBit(control_register, SPU_CONTROL_ENABLE)
+        && Bit::getBit(control_register, SPU_CONTROL_MUTE)
+        && Bit::getBit(control_register, SPU_CONTROL_CD_AUDIO_ENABLE);
+    int32_t volume_left = enabled ? cd_input_volume_left : 0;
+    int32_t volume_right = enabled ? cd_input_volume_right : 0;
+
+    // Drop the mixed samples, and the oldest ones if the drive delivers faster than the voices are generated
+    size_t excess = cd_input.size() - cd_input_position + samples.size();
+    excess -= std::min<size_t>(excess, 2 * SPU_CD_INPUT_CAPACITY);
+    if (excess > 0) {
+        LOGT_SPU(std::format("Dropping {:d} frames of CD input", excess / 2));
+    }
+    size_t drop = std::min(cd_input.size(), cd_input_position + excess);
+    cd_input.erase(cd_input.begin(), cd_input.begin() + drop);
+    cd_input_position = 0;
+
+    for (size_t i = 0; i + 1 < samples.size(); i += 2) {
+        cd_input.push_back((samples[i] * volume_left) >> 15);
+        cd_input.push_back((samples[i + 1] * volume_right) >> 15);
+    }
+}
+
+double SPU::get_queued_audio_duration() const {
+    if (!audio_stream) {
+        return 0.0;
+    }
+
+    int queued = SDL_GetAudioStreamQueued(audio_stream);
+    if (queued <= 0) {
+        return 0.0;
+    }
+
+    uint32_t bytes_per_second = audio_spec.freq * audio_spec.channels * SDL_AUDIO_BYTESIZE(audio_spec.format);
+    return (double)queued / bytes_per_second;
+}
+
+void SPU::set_audio_frequency_ratio(double ratio) {
+    if (audio_stream) {
+        SDL_SetAudioStreamFrequencyRatio(audio_stream, (float)ratio);
+    }
 }
 
 bool SPU::dma_write_to_spu_requested() const {
@@ -121,6 +253,7 @@ void SPU::start_dma_transfer() {
 void SPU::write_to_ram(uint16_t value) {
     LOGT_SPU(std::format("Write 0x{:04X} to SPU RAM @0x{:05X}", value, data_transfer_address));
     *((uint16_t*)(ram.get() + data_transfer_address)) = value;
+    voices.invalidate(data_transfer_address);
     data_transfer_address += 2;
 }
 
@@ -145,32 +278,25 @@ void SPU::handle_voice_write(uint32_t address, uint16_t value) {
     uint32_t offset = address & 0x0000'000F;
     if (offset == 0x0) {
         LOGV_SPU(std::format("Write to Voice {:d} Volume (Left): 0x{:04X}", voice_number, value));
-        // TODO Handle
     } else if (offset == 0x2) {
         LOGV_SPU(std::format("Write to Voice {:d} Volume (Right): 0x{:04X}", voice_number, value));
-        // TODO Handle
     } else if (offset == 0x4) {
         LOGV_SPU(std::format("Write to Voice {:d} ADPCM Sample Rate (VxPitch): 0x{:04X}", voice_number, value));
-        // TODO Handle
     } else if (offset == 0x6) {
         LOGV_SPU(std::format("Write to Voice {:d} ADPCM Start Address: 0x{:04X}", voice_number, value));
-        // TODO Handle
     } else if (offset == 0x8) {
         LOGV_SPU(std::format("Write to Voice {:d} ADSR (Lower): 0x{:04X}", voice_number, value));
-        // TODO Handle
     } else if (offset == 0xA) {
-        LOGV_SPU(std::format("Write to Voice {:d} ADSR (Lower): 0x{:04X}", voice_number, value));
-        // TODO Handle
+        LOGV_SPU(std::format("Write to Voice {:d} ADSR (Upper): 0x{:04X}", voice_number, value));
     } else if (offset == 0xC) {
         LOGV_SPU(std::format("Write to Voice {:d} ADSR Current Volume: 0x{:04X}", voice_number, value));
-        // TODO Handle
     } else if (offset == 0xE) {
         LOGV_SPU(std::format("Write to Voice {:d} ADPCM Repeat Address: 0x{:04X}", voice_number, value));
-        // TODO Handle
     } else {
         // Should not be reachable
         assert(false);
     }
+    voices.write_voice_register(voice_number, offset, value);
 }
 
 void SPU::handle_volume_write(uint32_t address, uint16_t value) {
@@ -180,16 +306,18 @@ void SPU::handle_volume_write(uint32_t address, uint16_t value) {
     uint32_t offset = address & 0x0000'00FF;
     if (offset == 0x80) {
         LOGV_SPU(std::format("Write to Main Volume (Left): 0x{:04X}", value));
-        // TODO Handle
+        main_volume_left.write(value, main_level_left);
     } else if (offset == 0x82) {
         LOGV_SPU(std::format("Write to Main Volume (Right): 0x{:04X}", value));
-        // TODO Handle
+        main_volume_right.write(value, main_level_right);
     } else if (offset == 0x84) {
         LOGV_SPU(std::format("Write to Reverb Output Volume (Left): 0x{:04X}", value));
-        // TODO Handle
+        reverb_output_volume_left = value;
+        // TODO Reverb
     } else if (offset == 0x86) {
         LOGV_SPU(std::format("Write to Reverb Output Volume (Right): 0x{:04X}", value));
-        // TODO Handle
+        reverb_output_volume_right = value;
+        // TODO Reverb
     } else {
         // Should not be reachable
         assert(false);
@@ -201,40 +329,37 @@ void SPU::handle_voice_flags_write(uint32_t address, uint16_t value) {
     assert((address & 1) == 0);
 
     uint32_t offset = address & 0x0000'00FF;
+    bool upper = offset & 0x2;
     if (offset == 0x88) {
         LOGV_SPU(std::format("Write to Key On (KON) (Voices 0...15): 0x{:04X}", value));
-        // TODO Handle: Start Attack, Decay, Sustain
+        key_on_register = replace_voice_flags(key_on_register, value, upper);
+        voices.key_on(value);
     } else if (offset == 0x8A) {
         LOGV_SPU(std::format("Write to Key On (KON) (Voices 16...23): 0x{:04X}", value));
-        // TODO Handle: Switch to Release
+        key_on_register = replace_voice_flags(key_on_register, value, upper);
+        voices.key_on((value & 0xFF) << 16);
     } else if (offset == 0x8C) {
         LOGV_SPU(std::format("Write to Key Off (KOFF) (Voices 0...15): 0x{:04X}", value));
-        // TODO Handle
+        key_off_register = replace_voice_flags(key_off_register, value, upper);
+        voices.key_off(value);
     } else if (offset == 0x8E) {
         LOGV_SPU(std::format("Write to Key Off (KOFF) (Voices 16...23): 0x{:04X}", value));
-        // TODO Handle
-    } else if (offset == 0x90) {
-        LOGV_SPU(std::format("Write to Pitch Modulation Enable (PMON) (Voices 1...15): 0x{:04X}", value));
-        // TODO Handle
-    } else if (offset == 0x92) {
-        LOGV_SPU(std::format("Write to Pitch Modulation Enable (PMON) (Voices 16...23): 0x{:04X}", value));
-        // TODO Handle
-    } else if (offset == 0x94) {
-        LOGV_SPU(std::format("Write to Noise Enable (NON) (Voices 0...15): 0x{:04X}", value));
-        // TODO Handle
-    } else if (offset == 0x96) {
-        LOGV_SPU(std::format("Write to Noise Enable (NON) (Voices 16...23): 0x{:04X}", value));
-        // TODO Handle
-    } else if (offset == 0x98) {
-        LOGV_SPU(std::format("Write to Reverb On (EON) (Voices 0...15): 0x{:04X}", value));
-        // TODO Handle
-    } else if (offset == 0x9A) {
-        LOGV_SPU(std::format("Write to Reverb On (EON) (Voices 16...23): 0x{:04X}", value));
-        // TODO Handle
+        key_off_register = replace_voice_flags(key_off_register, value, upper);
+        voices.key_off((value & 0xFF) << 16);
+    } else if (offset == 0x90 || offset == 0x92) {
+        LOGV_SPU(std::format("Write to Pitch Modulation Enable (PMON) (Voices {:s}): 0x{:04X}", upper ? "16...23" : "1...15", value));
+        voices.set_pitch_modulation(replace_voice_flags(voices.get_pitch_modulation(), value, upper));
+    } else if (offset == 0x94 || offset == 0x96) {
+        LOGV_SPU(std::format("Write to Noise Enable (NON) (Voices {:s}): 0x{:04X}", upper ? "16...23" : "0...15", value));
+        voices.set_noise_enable(replace_voice_flags(voices.get_noise_enable(), value, upper));
+    } else if (offset == 0x98 || offset == 0x9A) {
+        LOGV_SPU(std::format("Write to Reverb On (EON) (Voices {:s}): 0x{:04X}", upper ? "16...23" : "0...15", value));
+        voices.set_reverb_enable(replace_voice_flags(voices.get_reverb_enable(), value, upper));
+        // TODO Reverb
     } else if (offset == 0x9C) {
-        LOGW_SPU(std::format("Write to read-only register: Key On/Off Status (Voices 0...15): 0x{:04X}", value));
+        LOGW_SPU(std::format("Write to read-only register: Voice Status (ENDX) (Voices 0...15): 0x{:04X}", value));
     } else if (offset == 0x9E) {
-        LOGW_SPU(std::format("Write to read-only register: Key On/Off Status (Voices 16...23): 0x{:04X}", value));
+        LOGW_SPU(std::format("Write to read-only register: Voice Status (ENDX) (Voices 16...23): 0x{:04X}", value));
     } else {
         // Should not be reachable
         assert(false);
@@ -319,10 +444,10 @@ void SPU::handle_control_write(uint32_t address, uint16_t value) {
         LOGW_SPU(std::format("Attempted write to read-only SPU Status Register @0x{:08X}", address));
     } else if (offset == 0xB0) {
         LOGV_SPU(std::format("Write to CD Audio Input Volume (Left): 0x{:04X}", value));
-        // TODO
+        cd_input_volume_left = value;
     } else if (offset == 0xB2) {
         LOGV_SPU(std::format("Write to CD Audio Input Volume (Right): 0x{:04X}", value));
-        // TODO
+        cd_input_volume_right = value;
     } else if (offset == 0xB4) {
         LOGV_SPU(std::format("Write to External Audio Input Volume (Left): 0x{:04X}", value));
         // TODO
@@ -470,6 +595,43 @@ void SPU::handle_unused_write(uint32_t address, uint16_t value) {
     LOGW_SPU(std::format("Unimplemented write to unused register @0x{:08X}", address));
 }
 
+uint16_t SPU::handle_volume_read(uint32_t address) {
+    assert(address >= 0x1F80'1D80 && address < 0x1F80'1D87);
+    assert((address & 1) == 0);
+
+    uint32_t offset = address & 0x0000'00FF;
+    if (offset == 0x80) {
+        return main_volume_left.get_register();
+    } else if (offset == 0x82) {
+        return main_volume_right.get_register();
+    } else if (offset == 0x84) {
+        return reverb_output_volume_left;
+    }
+    return reverb_output_volume_right;
+}
+
+uint16_t SPU::handle_voice_flags_read(uint32_t address) {
+    assert(address >= 0x1F80'1D88 && address < 0x1F80'1D9F);
+    assert((address & 1) == 0);
+
+    uint32_t offset = address & 0x0000'00FF;
+    bool upper = offset & 0x2;
+    if (offset == 0x88 || offset == 0x8A) {
+        return get_voice_flags(key_on_register, upper);
+    } else if (offset == 0x8C || offset == 0x8E) {
+        return get_voice_flags(key_off_register, upper);
+    } else if (offset == 0x90 || offset == 0x92) {
+        return get_voice_flags(voices.get_pitch_modulation(), upper);
+    } else if (offset == 0x94 || offset == 0x96) {
+        return get_voice_flags(voices.get_noise_enable(), upper);
+    } else if (offset == 0x98 || offset == 0x9A) {
+        return get_voice_flags(voices.get_reverb_enable(), upper);
+    }
+    uint16_t value = get_voice_flags(voices.get_end_flags(), upper);
+    LOGT_SPU(std::format("Read from Voice Status (ENDX): 0x{:04X}", value));
+    return value;
+}
+
 uint16_t SPU::handle_control_read(uint32_t address) {
     assert(address >= 0x1F80'1DA0 && address < 0x1F80'1DBF);
     assert((address & 1) == 0);
@@ -493,6 +655,18 @@ uint16_t SPU::handle_control_read(uint32_t address) {
     } else if (offset == 0xAE) {
         value = status_register;
         LOGV_SPU(std::format("Read from SPU status register:\n{:s}", get_status_register_explanation(value)));
+    } else if (offset == 0xB0) {
+        value = cd_input_volume_left;
+        LOGV_SPU(std::format("Read from CD Audio Input Volume (Left): 0x{:04X}", value));
+    } else if (offset == 0xB2) {
+        value = cd_input_volume_right;
+        LOGV_SPU(std::format("Read from CD Audio Input Volume (Right): 0x{:04X}", value));
+    } else if (offset == 0xB8) {
+        value = main_level_left;
+        LOGV_SPU(std::format("Read from Current Main Volume (Left): 0x{:04X}", value));
+    } else if (offset == 0xBA) {
+        value = main_level_right;
+        LOGV_SPU(std::format("Read from Current Main Volume (Right): 0x{:04X}", value));
     } else {
         LOGW_SPU(std::format("Read from unknown control register @0x{:08X}", address));
     }
@@ -553,17 +727,21 @@ uint16_t SPU::read(uint32_t address) {
     uint16_t value = 0;
     uint32_t offset = address & 0x0000'FFFF;
     if (offset < 0x1D7F) {
-        LOGW_SPU(std::format("Unimplemented read from voice register @0x{:08X}", address));
+        value = voices.read_voice_register((address & 0x0000'01F0) >> 4, address & 0x0000'000F);
     } else if (offset < 0x1D87) {
-        LOGW_SPU(std::format("Unimplemented read from volume register @0x{:08X}", address));
+        value = handle_volume_read(address);
     } else if (offset < 0x1D9F) {
-        LOGW_SPU(std::format("Unimplemented read from voice flags @0x{:08X}", address));
+        value = handle_voice_flags_read(address);
     } else if (offset < 0x1DBF) {
         value = handle_control_read(address);
     } else if (offset < 0x1DFF) {
         LOGW_SPU(std::format("Unimplemented read from reverb configuration area @0x{:08X}", address));
     } else if (offset < 0x1E5F) {
-        LOGW_SPU(std::format("Unimplemented read from internal voice registers @0x{:08X}", address));
+        // 0x1F80'1E00 + N * 4: Voice Current Volume (Left/Right)
+        uint32_t voice = (offset - 0x1E00) / 4;
+        if (voice < SPU_VOICES) {
+            value = voices.get_current_volume(voice, offset & 0x2);
+        }
     } else if (offset < 0x1FFF) {
         LOGW_SPU(std::format("Unimplemented read from unknown area @0x{:08X}", address));
     }
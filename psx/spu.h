@@ -3,12 +3,19 @@
 
 #include <cstdint>
 #include <memory>
+#include <span>
+#include <vector>
 
 #include <SDL3/SDL_audio.h>
 
+#include "spuvoices.h"
 #include "util/queue.h"
 
 #define SPU_RAM_SIZE (512 * 1024)
+// The voices are generated in batches of this many frames (at 44.1 kHz), register writes take effect with the next batch
+#define SPU_BATCH_FRAMES 64
+// Frames of CD input that are buffered until the voices are mixed with them, the oldest ones are dropped beyond that
+#define SPU_CD_INPUT_CAPACITY 11025
 
 #define SPU_CONTROL_ENABLE 15 // 0 = off, 1 = on
 #define SPU_CONTROL_MUTE 14 // 0 = mute, 1 = unmute
@@ -53,6 +60,22 @@ private:
 
     std::unique_ptr<uint8_t[]> ram;
 
+    SPUVoices voices;
+    // CPU cycles that have not been turned into samples yet
+    uint32_t pending_cycles;
+
+    // 0x1F80'1D80 and 0x1F80'1D82: Main Volume (Left/Right), 0x1F80'1DB8 and 0x1F80'1DBA: Current Main Volume
+    SPUVolume main_volume_left;
+    SPUVolume main_volume_right;
+    int32_t main_level_left;
+    int32_t main_level_right;
+    // 0x1F80'1D84 and 0x1F80'1D86: Reverb Output Volume (Left/Right), stored only
+    uint16_t reverb_output_volume_left;
+    uint16_t reverb_output_volume_right;
+    // 0x1F80'1D88 to 0x1F80'1D8E: Key On and Key Off, as last written
+    uint32_t key_on_register;
+    uint32_t key_off_register;
+
     // 0x1F80'1DA4: SPU RAM IRQ Address (halfword)
     uint16_t irq_address_register;
     // 0x1F80'1DA6: SPU RAM Data Transfer Address (divided by 8, halfword)
@@ -66,6 +89,12 @@ private:
     uint16_t data_transfer_control_register;
     // 0x1F80'1DAE: SPU Status Register (SPUSTAT)
     uint16_t status_register;
+    // 0x1F80'1DB0 and 0x1F80'1DB2: CD Audio Input Volume (Left/Right)
+    int16_t cd_input_volume_left;
+    int16_t cd_input_volume_right;
+    // Interleaved stereo samples from the CD-ROM drive (after the input volume), the ones before the read position have been mixed
+    std::vector<int16_t> cd_input;
+    size_t cd_input_position;
 
     static std::string get_control_register_explanation(uint16_t reg);
     static std::string get_status_register_explanation(uint16_t reg);
@@ -100,8 +129,24 @@ public:
     // 0x1F80'1E80 to 0x1F80'1FFF
     void handle_unused_write(uint32_t address, uint16_t value);
 
+    // 0x1F80'1D80 to 0x1F80'1D87
+    uint16_t handle_volume_read(uint32_t address);
+    // 0x1F80'1D88 to 0x1F80'1D9F
+    uint16_t handle_voice_flags_read(uint32_t address);
+    // 0x1F80'1DA2 to 0x1F80'1DBF
     uint16_t handle_control_read(uint32_t address);
 
+    // Generates the samples of the elapsed time in batches of SPU_BATCH_FRAMES and queues them for playback
+    void catchUpToCPU(uint32_t cycles);
+
+    // Interleaved 16-bit stereo samples at 44.1 kHz from the CD-ROM drive, mixed with the voices as they are generated
+    void mix_cd_audio(std::span<const int16_t> samples);
+
+    // Duration (in seconds) of the audio that is queued but has not been played yet, 0 without audio output
+    double get_queued_audio_duration() const;
+    // Playback rate relative to the nominal sample rate, used for dynamic rate control
+    void set_audio_frequency_ratio(double ratio);
+
     template <typename T>
     void write(uint32_t address, T value);
 
@@ -109,6 +154,8 @@ public:
     T read(uint32_t address);
 
 private:
+    // Mixes the next SPU_BATCH_FRAMES of the voices and the CD input
+    void generate_batch();
     void perform_manual_transfer();
     void issue_interrupt_if_enabled();
 };
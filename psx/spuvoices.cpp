@@ -0,0 +1,627 @@
+#include "spuvoices.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <format>
+
+#include "spu.h"
+#include "util/bit.h"
+#include "util/log.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SPUVOICES_X86
+#include <immintrin.h>
+#endif
+
+using namespace util;
+
+namespace PSX {
+
+static_assert(SPU_VOICES % 8 == 0);
+
+namespace {
+
+// Weights of the four-point interpolation as in the hardware's table: entry k weights a sample (511 - k) / 256 samples away from the interpolated position
+constexpr std::array<int32_t, 512> gauss = {
+    -0x001, -0x001, -0x001, -0x001, -0x001, -0x001, -0x001, -0x001,
+    -0x001, -0x001, -0x001, -0x001, -0x001, -0x001, -0x001, -0x001,
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0001,
+    0x0001, 0x0001, 0x0001, 0x0002, 0x0002, 0x0002, 0x0003, 0x0003,
+    0x0003, 0x0004, 0x0004, 0x0005, 0x0005, 0x0006, 0x0007, 0x0007,
+    0x0008, 0x0009, 0x0009, 0x000A, 0x000B, 0x000C, 0x000D, 0x000E,
+    0x000F, 0x0010, 0x0011, 0x0012, 0x0013, 0x0015, 0x0016, 0x0018,
+    0x0019, 0x001B, 0x001C, 0x001E, 0x0020, 0x0021, 0x0023, 0x0025,
+    0x0027, 0x0029, 0x002C, 0x002E, 0x0030, 0x0033, 0x0035, 0x0038,
+    0x003A, 0x003D, 0x0040, 0x0043, 0x0046, 0x0049, 0x004D, 0x0050,
+    0x0054, 0x0057, 0x005B, 0x005F, 0x0063, 0x0067, 0x006B, 0x006F,
+    0x0074, 0x0078, 0x007D, 0x0082, 0x0087, 0x008C, 0x0091, 0x0096,
+    0x009C, 0x00A1, 0x00A7, 0x00AD, 0x00B3, 0x00BA, 0x00C0, 0x00C7,
+    0x00CD, 0x00D4, 0x00DB, 0x00E3, 0x00EA, 0x00F2, 0x00FA, 0x0101,
+    0x010A, 0x0112, 0x011B, 0x0123, 0x012C, 0x0135, 0x013F, 0x0148,
+    0x0152, 0x015C, 0x0166, 0x0171, 0x017B, 0x0186, 0x0191, 0x019C,
+    0x01A8, 0x01B4, 0x01C0, 0x01CC, 0x01D9, 0x01E5, 0x01F2, 0x0200,
+    0x020D, 0x021B, 0x0229, 0x0237, 0x0246, 0x0255, 0x0264, 0x0273,
+    0x0283, 0x0293, 0x02A3, 0x02B4, 0x02C4, 0x02D6, 0x02E7, 0x02F9,
+    0x030B, 0x031D, 0x0330, 0x0343, 0x0356, 0x036A, 0x037E, 0x0392,
+    0x03A7, 0x03BC, 0x03D1, 0x03E7, 0x03FC, 0x0413, 0x042A, 0x0441,
+    0x0458, 0x0470, 0x0488, 0x04A0, 0x04B9, 0x04D2, 0x04EC, 0x0506,
+    0x0520, 0x053B, 0x0556, 0x0572, 0x058E, 0x05AA, 0x05C7, 0x05E4,
+    0x0601, 0x061F, 0x063E, 0x065C, 0x067C, 0x069B, 0x06BB, 0x06DC,
+    0x06FD, 0x071E, 0x0740, 0x0762, 0x0784, 0x07A7, 0x07CB, 0x07EF,
+    0x0813, 0x0838, 0x085D, 0x0883, 0x08A9, 0x08D0, 0x08F7, 0x091E,
+    0x0946, 0x096F, 0x0998, 0x09C1, 0x09EB, 0x0A16, 0x0A40, 0x0A6C,
+    0x0A98, 0x0AC4, 0x0AF1, 0x0B1E, 0x0B4C, 0x0B7A, 0x0BA9, 0x0BD8,
+    0x0C07, 0x0C38, 0x0C68, 0x0C99, 0x0CCB, 0x0CFD, 0x0D30, 0x0D63,
+    0x0D97, 0x0DCB, 0x0E00, 0x0E35, 0x0E6B, 0x0EA1, 0x0ED7, 0x0F0F,
+    0x0F46, 0x0F7F, 0x0FB7, 0x0FF1, 0x102A, 0x1065, 0x109F, 0x10DB,
+    0x1116, 0x1153, 0x118F, 0x11CD, 0x120B, 0x1249, 0x1288, 0x12C7,
+    0x1307, 0x1347, 0x1388, 0x13C9, 0x140B, 0x144D, 0x1490, 0x14D4,
+    0x1517, 0x155C, 0x15A0, 0x15E6, 0x162C, 0x1672, 0x16B9, 0x1700,
+    0x1747, 0x1790, 0x17D8, 0x1821, 0x186B, 0x18B5, 0x1900, 0x194B,
+    0x1996, 0x19E2, 0x1A2E, 0x1A7B, 0x1AC8, 0x1B16, 0x1B64, 0x1BB3,
+    0x1C02, 0x1C51, 0x1CA1, 0x1CF1, 0x1D42, 0x1D93, 0x1DE5, 0x1E37,
+    0x1E89, 0x1EDC, 0x1F2F, 0x1F82, 0x1FD6, 0x202A, 0x207F, 0x20D4,
+    0x2129, 0x217F, 0x21D5, 0x222C, 0x2282, 0x22DA, 0x2331, 0x2389,
+    0x23E1, 0x2439, 0x2492, 0x24EB, 0x2545, 0x259E, 0x25F8, 0x2653,
+    0x26AD, 0x2708, 0x2763, 0x27BE, 0x281A, 0x2876, 0x28D2, 0x292E,
+    0x298B, 0x29E7, 0x2A44, 0x2AA1, 0x2AFF, 0x2B5C, 0x2BBA, 0x2C18,
+    0x2C76, 0x2CD4, 0x2D33, 0x2D91, 0x2DF0, 0x2E4F, 0x2EAE, 0x2F0D,
+    0x2F6C, 0x2FCC, 0x302B, 0x308B, 0x30EA, 0x314A, 0x31AA, 0x3209,
+    0x3269, 0x32C9, 0x3329, 0x3389, 0x33E9, 0x3449, 0x34A9, 0x3509,
+    0x3569, 0x35C9, 0x3629, 0x3689, 0x36E8, 0x3748, 0x37A8, 0x3807,
+    0x3867, 0x38C6, 0x3926, 0x3985, 0x39E4, 0x3A43, 0x3AA2, 0x3B00,
+    0x3B5F, 0x3BBD, 0x3C1B, 0x3C79, 0x3CD7, 0x3D35, 0x3D92, 0x3DEF,
+    0x3E4C, 0x3EA9, 0x3F05, 0x3F62, 0x3FBD, 0x4019, 0x4074, 0x40D0,
+    0x412A, 0x4185, 0x41DF, 0x4239, 0x4292, 0x42EB, 0x4344, 0x439C,
+    0x43F4, 0x444C, 0x44A3, 0x44FA, 0x4550, 0x45A6, 0x45FC, 0x4651,
+    0x46A6, 0x46FA, 0x474E, 0x47A1, 0x47F4, 0x4846, 0x4898, 0x48E9,
+    0x493A, 0x498A, 0x49D9, 0x4A29, 0x4A77, 0x4AC5, 0x4B13, 0x4B5F,
+    0x4BAC, 0x4BF7, 0x4C42, 0x4C8D, 0x4CD7, 0x4D20, 0x4D68, 0x4DB0,
+    0x4DF7, 0x4E3E, 0x4E84, 0x4EC9, 0x4F0E, 0x4F52, 0x4F95, 0x4FD7,
+    0x5019, 0x505A, 0x509A, 0x50DA, 0x5118, 0x5156, 0x5194, 0x51D0,
+    0x520C, 0x5247, 0x5281, 0x52BA, 0x52F3, 0x532A, 0x5361, 0x5397,
+    0x53CC, 0x5401, 0x5434, 0x5467, 0x5499, 0x54CA, 0x54FA, 0x5529,
+    0x5558, 0x5585, 0x55B2, 0x55DE, 0x5609, 0x5632, 0x565B, 0x5684,
+    0x56AB, 0x56D1, 0x56F6, 0x571B, 0x573E, 0x5761, 0x5782, 0x57A3,
+    0x57C3, 0x57E2, 0x57FF, 0x581C, 0x5838, 0x5853, 0x586D, 0x5886,
+    0x589E, 0x58B5, 0x58CB, 0x58E0, 0x58F4, 0x5907, 0x5919, 0x592A,
+    0x593A, 0x5949, 0x5958, 0x5965, 0x5971, 0x597C, 0x5986, 0x598F,
+    0x5997, 0x599E, 0x59A4, 0x59A9, 0x59AD, 0x59B0, 0x59B2, 0x59B3
+};
+
+// ADPCM prediction filters, applied to the last and second to last sample (in 1/64)
+const int32_t filter_old[5] = {0, 60, 115, 98, 122};
+const int32_t filter_older[5] = {0, 0, -52, -55, -60};
+
+typedef void (*MixKernel)(SPUVoices::MixState &mix, int32_t noise, int32_t &left, int32_t &right);
+
+void mix_scalar(SPUVoices::MixState &mix, int32_t noise, int32_t &left, int32_t &right) {
+    for (uint32_t v = 0; v < SPU_VOICES; ++v) {
+        int32_t i = mix.interpolation_index[v];
+        int32_t sample = ((gauss[0x0FF - i] * mix.taps[0][v]) >> 15)
+            + ((gauss[0x1FF - i] * mix.taps[1][v]) >> 15)
+            + ((gauss[0x100 + i] * mix.taps[2][v]) >> 15)
+            + ((gauss[0x000 + i] * mix.taps[3][v]) >> 15);
+        sample = (sample & ~mix.noise[v]) | (noise & mix.noise[v]);
+
+        int32_t output = (sample * mix.envelope[v]) >> 15;
+        mix.output[v] = output;
+        left += (output * mix.volume_left[v]) >> 15;
+        right += (output * mix.volume_right[v]) >> 15;
+    }
+}
+
+#ifdef SPUVOICES_X86
+__attribute__((target("avx2")))
+inline __m256i weigh_avx2(__m256i index, const int32_t *taps) {
+    __m256i weight = _mm256_i32gather_epi32(gauss.data(), index, 4);
+    return _mm256_srai_epi32(_mm256_mullo_epi32(weight, _mm256_loadu_si256((const __m256i*)taps)), 15);
+}
+
+__attribute__((target("avx2")))
+int32_t horizontal_sum_avx2(__m256i v) {
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(sum);
+}
+
+// Eight voices per iteration, the gathers fetch the interpolation weights of every voice's own position
+__attribute__((target("avx2")))
+void mix_avx2(SPUVoices::MixState &mix, int32_t noise, int32_t &left, int32_t &right) {
+    const __m256i noise_level = _mm256_set1_epi32(noise);
+    __m256i sum_left = _mm256_setzero_si256();
+    __m256i sum_right = _mm256_setzero_si256();
+
+    for (uint32_t v = 0; v < SPU_VOICES; v += 8) {
+        __m256i i = _mm256_loadu_si256((const __m256i*)&mix.interpolation_index[v]);
+        __m256i sample = weigh_avx2(_mm256_sub_epi32(_mm256_set1_epi32(0x0FF), i), &mix.taps[0][v]);
+        sample = _mm256_add_epi32(sample, weigh_avx2(_mm256_sub_epi32(_mm256_set1_epi32(0x1FF), i), &mix.taps[1][v]));
+        sample = _mm256_add_epi32(sample, weigh_avx2(_mm256_add_epi32(_mm256_set1_epi32(0x100), i), &mix.taps[2][v]));
+        sample = _mm256_add_epi32(sample, weigh_avx2(i, &mix.taps[3][v]));
+        sample = _mm256_blendv_epi8(sample, noise_level, _mm256_loadu_si256((const __m256i*)&mix.noise[v]));
+
+        __m256i envelope = _mm256_loadu_si256((const __m256i*)&mix.envelope[v]);
+        __m256i output = _mm256_srai_epi32(_mm256_mullo_epi32(sample, envelope), 15);
+        _mm256_storeu_si256((__m256i*)&mix.output[v], output);
+
+        __m256i volume_left = _mm256_loadu_si256((const __m256i*)&mix.volume_left[v]);
+        __m256i volume_right = _mm256_loadu_si256((const __m256i*)&mix.volume_right[v]);
+        sum_left = _mm256_add_epi32(sum_left, _mm256_srai_epi32(_mm256_mullo_epi32(output, volume_left), 15));
+        sum_right = _mm256_add_epi32(sum_right, _mm256_srai_epi32(_mm256_mullo_epi32(output, volume_right), 15));
+    }
+
+    left += horizontal_sum_avx2(sum_left);
+    right += horizontal_sum_avx2(sum_right);
+}
+#endif
+
+struct Kernels {
+    MixKernel mix;
+
+    Kernels()
+        : mix(mix_scalar) {
+#ifdef SPUVOICES_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            mix = mix_avx2;
+        }
+#endif
+    }
+};
+
+const Kernels& kernels() {
+    static const Kernels selected;
+    return selected;
+}
+
+}
+
+SPUEnvelope::SPUEnvelope() {
+    reset(0, false, false);
+}
+
+void SPUEnvelope::reset(uint8_t rate, bool decrease, bool exponential) {
+    this->rate = rate;
+    this->decrease = decrease;
+    this->exponential = exponential;
+    counter = 0;
+    counter_increment = 0x8000;
+
+    // Steps of +7...+4 or -8...-5, slow rates step less often instead of by less
+    int32_t base_step = 7 - (rate & 3);
+    step = decrease ? ~base_step : base_step;
+    if (rate < 44) {
+        step <<= 11 - (rate >> 2);
+    } else if (rate >= 48) {
+        counter_increment >>= (rate >> 2) - 11;
+    }
+}
+
+int32_t SPUEnvelope::tick(int32_t level) {
+    int32_t this_step = step;
+    uint32_t this_increment = counter_increment;
+    if (exponential) {
+        if (decrease) {
+            this_step = (this_step * level) >> 15;
+        } else if (level >= 0x6000) {
+            // Four times slower above 0x6000
+            if (rate < 40) {
+                this_step >>= 2;
+            } else if (rate >= 44) {
+                this_increment >>= 2;
+            } else {
+                this_step >>= 1;
+                this_increment >>= 1;
+            }
+        }
+    }
+
+    counter += this_increment;
+    if (!(counter & 0x8000)) {
+        return level;
+    }
+    counter = 0;
+    return std::clamp(level + this_step, 0, 0x7FFF);
+}
+
+SPUVolume::SPUVolume()
+    : reg(0) {
+}
+
+uint16_t SPUVolume::get_register() const {
+    return reg;
+}
+
+void SPUVolume::write(uint16_t value, int32_t &level) {
+    reg = value;
+    if (is_sweeping()) {
+        envelope.reset(Bit::getBits<7>(value, SPU_VOLUME_SWEEP_RATE),
+            Bit::getBit(value, SPU_VOLUME_SWEEP_DECREASE), Bit::getBit(value, SPU_VOLUME_SWEEP_EXPONENTIAL));
+    } else {
+        level = (int16_t)(value << 1);
+    }
+}
+
+bool SPUVolume::is_sweeping() const {
+    return Bit::getBit(reg, SPU_VOLUME_SWEEP);
+}
+
+void SPUVolume::tick(int32_t &level) {
+    // Sweeps the magnitude, the sign is chosen by the register
+    int32_t magnitude = envelope.tick(std::min(std::abs(level), 0x7FFF));
+    level = Bit::getBit(reg, SPU_VOLUME_SWEEP_NEGATIVE) ? -magnitude : magnitude;
+}
+
+SPUVoices::SPUVoices(const uint8_t *ram)
+    : ram(ram),
+      cache(SPU_ADPCM_CACHE_BLOCKS) {
+    reset();
+}
+
+void SPUVoices::reset() {
+    volume_left.fill(SPUVolume());
+    volume_right.fill(SPUVolume());
+    pitch.fill(0);
+    start_address.fill(0);
+    adsr.fill(0);
+    repeat_address.fill(0);
+
+    pitch_modulation = 0;
+    noise_enable = 0;
+    reverb_enable = 0;
+    end_flags = 0;
+
+    current_address.fill(0);
+    counter.fill(0);
+    phase.fill(Phase::OFF);
+    adsr_envelope.fill(SPUEnvelope());
+    adsr_target.fill(0);
+    ignore_loop_start.fill(false);
+    for (auto &voice_samples : samples) {
+        voice_samples.fill(0);
+    }
+
+    noise_timer = 0;
+    noise_level = 1;
+
+    for (auto &tap : mix.taps) {
+        tap.fill(0);
+    }
+    mix.interpolation_index.fill(0);
+    mix.noise.fill(0);
+    mix.envelope.fill(0);
+    mix.volume_left.fill(0);
+    mix.volume_right.fill(0);
+    mix.output.fill(0);
+
+    for (CachedBlock &block : cache) {
+        block.address = SPU_RAM_SIZE;
+    }
+}
+
+void SPUVoices::write_voice_register(uint32_t voice, uint32_t offset, uint16_t value) {
+    switch (offset) {
+        case 0x0:
+            volume_left[voice].write(value, mix.volume_left[voice]);
+            break;
+        case 0x2:
+            volume_right[voice].write(value, mix.volume_right[voice]);
+            break;
+        case 0x4:
+            pitch[voice] = value;
+            break;
+        case 0x6:
+            start_address[voice] = value;
+            break;
+        case 0x8:
+            adsr[voice] = (adsr[voice] & 0xFFFF'0000) | value;
+            break;
+        case 0xA:
+            adsr[voice] = (adsr[voice] & 0x0000'FFFF) | (value << 16);
+            break;
+        case 0xC:
+            mix.envelope[voice] = std::clamp<int32_t>((int16_t)value, 0, 0x7FFF);
+            break;
+        case 0xE:
+            repeat_address[voice] = (value * 8) & (SPU_RAM_SIZE - 1);
+            ignore_loop_start[voice] = true;
+            break;
+    }
+}
+
+uint16_t SPUVoices::read_voice_register(uint32_t voice, uint32_t offset) const {
+    switch (offset) {
+        case 0x0:
+            return volume_left[voice].get_register();
+        case 0x2:
+            return volume_right[voice].get_register();
+        case 0x4:
+            return pitch[voice];
+        case 0x6:
+            return start_address[voice];
+        case 0x8:
+            return adsr[voice] & 0xFFFF;
+        case 0xA:
+            return adsr[voice] >> 16;
+        case 0xC:
+            return mix.envelope[voice];
+        case 0xE:
+            return repeat_address[voice] / 8;
+    }
+    return 0;
+}
+
+int16_t SPUVoices::get_current_volume(uint32_t voice, bool right) const {
+    return right ? mix.volume_right[voice] : mix.volume_left[voice];
+}
+
+void SPUVoices::key_on(uint32_t voices) {
+    for (uint32_t v = 0; v < SPU_VOICES; ++v) {
+        if (!Bit::getBit(voices, v)) {
+            continue;
+        }
+
+        current_address[v] = (start_address[v] * 8) & (SPU_RAM_SIZE - 1);
+        counter[v] = 0;
+        ignore_loop_start[v] = false;
+        Bit::clearBit(end_flags, v);
+        samples[v].fill(0);
+        mix.envelope[v] = 0;
+        set_phase(v, Phase::ATTACK);
+
+        load_block(v);
+        update_taps(v);
+    }
+}
+
+void SPUVoices::key_off(uint32_t voices) {
+    for (uint32_t v = 0; v < SPU_VOICES; ++v) {
+        if (Bit::getBit(voices, v) && phase[v] != Phase::OFF) {
+            set_phase(v, Phase::RELEASE);
+        }
+    }
+}
+
+void SPUVoices::set_pitch_modulation(uint32_t voices) {
+    // Voice 0 has no previous voice to be modulated by
+    pitch_modulation = voices & 0xFF'FFFE;
+}
+
+uint32_t SPUVoices::get_pitch_modulation() const {
+    return pitch_modulation;
+}
+
+void SPUVoices::set_noise_enable(uint32_t voices) {
+    noise_enable = voices & 0xFF'FFFF;
+    for (uint32_t v = 0; v < SPU_VOICES; ++v) {
+        mix.noise[v] = Bit::getBit(noise_enable, v) ? ~0 : 0;
+    }
+}
+
+uint32_t SPUVoices::get_noise_enable() const {
+    return noise_enable;
+}
+
+void SPUVoices::set_reverb_enable(uint32_t voices) {
+    reverb_enable = voices & 0xFF'FFFF;
+}
+
+uint32_t SPUVoices::get_reverb_enable() const {
+    return reverb_enable;
+}
+
+uint32_t SPUVoices::get_end_flags() const {
+    return end_flags;
+}
+
+void SPUVoices::render(uint32_t frames, uint16_t control_register, int32_t *left, int32_t *right) {
+    const Kernels &selected = kernels();
+
+    for (uint32_t frame = 0; frame < frames; ++frame) {
+        update_noise(control_register);
+
+        int32_t sum_left = 0;
+        int32_t sum_right = 0;
+        selected.mix(mix, (int16_t)noise_level, sum_left, sum_right);
+        left[frame] = sum_left;
+        right[frame] = sum_right;
+
+        // In voice order, pitch modulation reads the output of the previous voice
+        for (uint32_t v = 0; v < SPU_VOICES; ++v) {
+            if (volume_left[v].is_sweeping()) {
+                volume_left[v].tick(mix.volume_left[v]);
+            }
+            if (volume_right[v].is_sweeping()) {
+                volume_right[v].tick(mix.volume_right[v]);
+            }
+            if (phase[v] == Phase::OFF) {
+                continue;
+            }
+
+            tick_envelope(v);
+            advance(v);
+        }
+    }
+}
+
+void SPUVoices::invalidate(uint32_t address) {
+    // Blocks start at multiples of 8 (the unit of the start and repeat addresses), so two of them contain the address:
+    // the one starting in the same 8 bytes and the one starting 8 bytes before (which may wrap around the end of SPU RAM)
+    uint32_t first = address & ~7u;
+    for (uint32_t start : {first - 8, first}) {
+        start &= SPU_RAM_SIZE - 1;
+        CachedBlock &block = cache[(start / SPU_ADPCM_BLOCK_SIZE) & (SPU_ADPCM_CACHE_BLOCKS - 1)];
+        if (block.address == start) {
+            block.address = SPU_RAM_SIZE;
+        }
+    }
+}
+
+void SPUVoices::set_phase(uint32_t voice, Phase new_phase) {
+    phase[voice] = new_phase;
+
+    uint32_t value = adsr[voice];
+    switch (new_phase) {
+        case Phase::OFF:
+            mix.envelope[voice] = 0;
+            break;
+        case Phase::ATTACK:
+            adsr_target[voice] = 0x7FFF;
+            adsr_envelope[voice].reset(Bit::getBits<7>(value, SPU_ADSR_ATTACK_RATE),
+                false, Bit::getBit(value, SPU_ADSR_ATTACK_EXPONENTIAL));
+            break;
+        case Phase::DECAY:
+            adsr_target[voice] = std::min<int32_t>((Bit::getBits<4>(value, SPU_ADSR_SUSTAIN_LEVEL) + 1) * 0x800, 0x7FFF);
+            adsr_envelope[voice].reset(Bit::getBits<4>(value, SPU_ADSR_DECAY_SHIFT) << 2, true, true);
+            break;
+        case Phase::SUSTAIN:
+            adsr_target[voice] = 0;
+            adsr_envelope[voice].reset(Bit::getBits<7>(value, SPU_ADSR_SUSTAIN_RATE),
+                Bit::getBit(value, SPU_ADSR_SUSTAIN_DECREASE), Bit::getBit(value, SPU_ADSR_SUSTAIN_EXPONENTIAL));
+            break;
+        case Phase::RELEASE:
+            adsr_target[voice] = 0;
+            adsr_envelope[voice].reset(Bit::getBits<5>(value, SPU_ADSR_RELEASE_SHIFT) << 2,
+                true, Bit::getBit(value, SPU_ADSR_RELEASE_EXPONENTIAL));
+            break;
+    }
+}
+
+void SPUVoices::tick_envelope(uint32_t voice) {
+    int32_t level = adsr_envelope[voice].tick(mix.envelope[voice]);
+    mix.envelope[voice] = level;
+
+    switch (phase[voice]) {
+        case Phase::ATTACK:
+            if (level >= adsr_target[voice]) {
+                set_phase(voice, Phase::DECAY);
+            }
+            break;
+        case Phase::DECAY:
+            if (level <= adsr_target[voice]) {
+                set_phase(voice, Phase::SUSTAIN);
+            }
+            break;
+        case Phase::RELEASE:
+            if (level <= 0) {
+                set_phase(voice, Phase::OFF);
+            }
+            break;
+        default:
+            // Sustain lasts until key off
+            break;
+    }
+}
+
+void SPUVoices::advance(uint32_t voice) {
+    uint32_t step = pitch[voice];
+    if (Bit::getBit(pitch_modulation, voice)) {
+        // The previous voice's output scales the step by 0...1.99, pitches above 0x7FFF are treated as negative
+        int32_t factor = mix.output[voice - 1] + 0x8000;
+        step = (((int32_t)(int16_t)step * factor) >> 15) & 0xFFFF;
+    }
+    counter[voice] += std::min<uint32_t>(step, 0x4000);
+
+    if ((counter[voice] >> 12) >= SPU_ADPCM_BLOCK_SAMPLES) {
+        counter[voice] -= SPU_ADPCM_BLOCK_SAMPLES << 12;
+        next_block(voice);
+    }
+    update_taps(voice);
+}
+
+void SPUVoices::next_block(uint32_t voice) {
+    auto &voice_samples = samples[voice];
+    std::copy(voice_samples.end() - 3, voice_samples.end(), voice_samples.begin());
+
+    uint8_t flags = ram[current_address[voice] + 1];
+    if (Bit::getBit(flags, SPU_ADPCM_FLAG_LOOP_END)) {
+        Bit::setBit(end_flags, voice);
+        current_address[voice] = repeat_address[voice];
+        // Noise keeps playing, the samples are still decoded
+        if (!Bit::getBit(flags, SPU_ADPCM_FLAG_LOOP_REPEAT) && !Bit::getBit(noise_enable, voice)) {
+            LOGT_SPU(std::format("Voice {:d} reached the end of its samples", voice));
+            set_phase(voice, Phase::OFF);
+        }
+    } else {
+        current_address[voice] = (current_address[voice] + SPU_ADPCM_BLOCK_SIZE) & (SPU_RAM_SIZE - 1);
+    }
+
+    load_block(voice);
+}
+
+void SPUVoices::load_block(uint32_t voice) {
+    uint32_t address = current_address[voice];
+    if (Bit::getBit(ram[address + 1], SPU_ADPCM_FLAG_LOOP_START) && !ignore_loop_start[voice]) {
+        repeat_address[voice] = address;
+    }
+
+    auto &voice_samples = samples[voice];
+    const int16_t *decoded = decode_block(address, voice_samples[2], voice_samples[1]);
+    std::copy(decoded, decoded + SPU_ADPCM_BLOCK_SAMPLES, voice_samples.begin() + 3);
+}
+
+const int16_t* SPUVoices::decode_block(uint32_t address, int16_t old, int16_t older) {
+    CachedBlock &block = cache[(address / SPU_ADPCM_BLOCK_SIZE) & (SPU_ADPCM_CACHE_BLOCKS - 1)];
+    if (block.address == address && block.old == old && block.older == older) {
+        return block.samples.data();
+    }
+
+    block.address = address;
+    block.old = old;
+    block.older = older;
+
+    // A block that starts 8 bytes before the end of SPU RAM continues at its start
+    std::array<uint8_t, SPU_ADPCM_BLOCK_SIZE> data;
+    for (uint32_t i = 0; i < SPU_ADPCM_BLOCK_SIZE; ++i) {
+        data[i] = ram[(address + i) & (SPU_RAM_SIZE - 1)];
+    }
+    // Shifts 13 to 15 act like 9
+    uint32_t shift = data[0] & 0xF;
+    if (shift > 12) {
+        shift = 9;
+    }
+    uint32_t filter = std::min((data[0] >> 4) & 0x7, 4);
+
+    int32_t previous = old;
+    int32_t before_previous = older;
+    for (uint32_t i = 0; i < SPU_ADPCM_BLOCK_SAMPLES; ++i) {
+        uint8_t nibble = (data[2 + i / 2] >> ((i & 1) * 4)) & 0xF;
+        int32_t sample = (int16_t)(nibble << 12) >> shift;
+        sample += (previous * filter_old[filter] + before_previous * filter_older[filter] + 32) >> 6;
+        sample = std::clamp(sample, -0x8000, 0x7FFF);
+
+        block.samples[i] = sample;
+        before_previous = previous;
+        previous = sample;
+    }
+    return block.samples.data();
+}
+
+void SPUVoices::update_taps(uint32_t voice) {
+    // The newest tap is the sample the counter points at, the three before it may be from the previous block
+    uint32_t position = counter[voice] >> 12;
+    for (uint32_t tap = 0; tap < 4; ++tap) {
+        mix.taps[tap][voice] = samples[voice][position + tap];
+    }
+    mix.interpolation_index[voice] = (counter[voice] >> 4) & 0xFF;
+}
+
+void SPUVoices::update_noise(uint16_t control_register) {
+    uint32_t shift = Bit::getBits<4>(control_register, SPU_CONTROL_NOISE_FREQUENCY_SHIFT0);
+    int32_t step = Bit::getBits<2>(control_register, SPU_CONTROL_NOISE_FREQUENCY_STEP0) + 4;
+
+    noise_timer -= step;
+    if (noise_timer >= 0) {
+        return;
+    }
+
+    uint32_t parity = ((noise_level >> 15) ^ (noise_level >> 12) ^ (noise_level >> 11) ^ (noise_level >> 10) ^ 1) & 1;
+    noise_level = (noise_level << 1) | parity;
+    noise_timer += 0x20000 >> shift;
+    if (noise_timer < 0) {
+        noise_timer += 0x20000 >> shift;
+    }
+}
+
+}
@@ -0,0 +1,182 @@
+#ifndef PSX_SPUVOICES_H
+#define PSX_SPUVOICES_H
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace PSX {
+
+#define SPU_VOICES 24
+// One sample (per voice) every 768 CPU cycles, i.e., 44.1 kHz
+#define SPU_CYCLES_PER_SAMPLE 768
+
+// ADPCM blocks: shift/filter byte, flags byte, then 28 4-bit samples
+#define SPU_ADPCM_BLOCK_SIZE 16
+#define SPU_ADPCM_BLOCK_SAMPLES 28
+#define SPU_ADPCM_FLAG_LOOP_END 0 // continue at the repeat address after this block
+#define SPU_ADPCM_FLAG_LOOP_REPEAT 1 // at the loop end: 0 = stop the voice, 1 = keep playing
+#define SPU_ADPCM_FLAG_LOOP_START 2 // this block becomes the repeat address
+// Decoded blocks that are kept, direct-mapped by their address (has to be a power of two)
+#define SPU_ADPCM_CACHE_BLOCKS 1024
+
+// 0x1F80'1C08 (lower halfword) and 0x1F80'1C0A (upper halfword): Voice ADSR
+#define SPU_ADSR_SUSTAIN_EXPONENTIAL 31 // 0 = linear, 1 = exponential
+#define SPU_ADSR_SUSTAIN_DECREASE 30 // 0 = increase, 1 = decrease
+#define SPU_ADSR_SUSTAIN_RATE 22 // 7 bits: shift (5 bits) and step (2 bits)
+#define SPU_ADSR_RELEASE_EXPONENTIAL 21 // 0 = linear, 1 = exponential
+#define SPU_ADSR_RELEASE_SHIFT 16 // 5 bits
+#define SPU_ADSR_ATTACK_EXPONENTIAL 15 // 0 = linear, 1 = exponential
+#define SPU_ADSR_ATTACK_RATE 8 // 7 bits: shift (5 bits) and step (2 bits)
+#define SPU_ADSR_DECAY_SHIFT 4 // 4 bits
+#define SPU_ADSR_SUSTAIN_LEVEL 0 // 4 bits, level is (N + 1) * 0x800
+
+// Volume registers: the volume divided by 2 (15 bits, signed) or a sweep
+#define SPU_VOLUME_SWEEP 15 // 0 = fixed volume, 1 = sweep
+#define SPU_VOLUME_SWEEP_EXPONENTIAL 14 // 0 = linear, 1 = exponential
+#define SPU_VOLUME_SWEEP_DECREASE 13 // 0 = increase, 1 = decrease
+#define SPU_VOLUME_SWEEP_NEGATIVE 12 // 0 = positive, 1 = negative
+#define SPU_VOLUME_SWEEP_RATE 0 // 7 bits: shift (5 bits) and step (2 bits)
+
+// Level ramp of an ADSR phase or of a volume sweep, ticked once per sample
+class SPUEnvelope {
+private:
+    int32_t step;
+    uint32_t counter_increment;
+    uint32_t counter;
+    uint8_t rate;
+    bool decrease;
+    bool exponential;
+
+public:
+    SPUEnvelope();
+    void reset(uint8_t rate, bool decrease, bool exponential);
+    // Returns the next level, within 0...0x7FFF
+    int32_t tick(int32_t level);
+};
+
+// Volume register that holds either a fixed volume or a sweep of the current level
+class SPUVolume {
+private:
+    uint16_t reg;
+    SPUEnvelope envelope;
+
+public:
+    SPUVolume();
+    uint16_t get_register() const;
+    void write(uint16_t value, int32_t &level);
+    bool is_sweeping() const;
+    void tick(int32_t &level);
+};
+
+// The 24 voices of the SPU: ADPCM decoding, pitch counters, Gaussian interpolation, ADSR envelopes, noise and pitch modulation.
+// Everything the mixer reads is stored in one array per field across all voices, so it mixes 8 voices at a time with AVX2.
+class SPUVoices {
+public:
+    enum class Phase : uint8_t {
+        OFF,
+        ATTACK,
+        DECAY,
+        SUSTAIN,
+        RELEASE
+    };
+
+    struct MixState {
+        // The four samples around each pitch counter, taps[0] is the oldest
+        alignas(32) std::array<std::array<int32_t, SPU_VOICES>, 4> taps;
+        // Fraction of the pitch counter, (counter >> 4) & 0xFF
+        alignas(32) std::array<int32_t, SPU_VOICES> interpolation_index;
+        // All bits set for voices that play the noise generator instead of their samples
+        alignas(32) std::array<int32_t, SPU_VOICES> noise;
+        // Current ADSR levels (0...0x7FFF)
+        alignas(32) std::array<int32_t, SPU_VOICES> envelope;
+        alignas(32) std::array<int32_t, SPU_VOICES> volume_left;
+        alignas(32) std::array<int32_t, SPU_VOICES> volume_right;
+        // Written by the mixer: the samples after the ADSR levels (VxOUT), read by pitch modulation
+        alignas(32) std::array<int32_t, SPU_VOICES> output;
+    };
+
+private:
+    const uint8_t *ram;
+
+    // 0x1F80'1C00 + N * 0x10: Voice Registers
+    std::array<SPUVolume, SPU_VOICES> volume_left;
+    std::array<SPUVolume, SPU_VOICES> volume_right;
+    std::array<uint16_t, SPU_VOICES> pitch;
+    std::array<uint16_t, SPU_VOICES> start_address; // divided by 8
+    std::array<uint32_t, SPU_VOICES> adsr;
+    std::array<uint32_t, SPU_VOICES> repeat_address; // in bytes
+
+    // Voice flags, bit N is voice N
+    uint32_t pitch_modulation;
+    uint32_t noise_enable;
+    uint32_t reverb_enable; // stored only, there is no reverb yet
+    uint32_t end_flags; // ENDX: the voice reached a block with the loop end flag
+
+    // Playback state of every voice
+    std::array<uint32_t, SPU_VOICES> current_address; // of the current block, in bytes
+    std::array<uint32_t, SPU_VOICES> counter; // sample within the block (bits 12 and up), interpolation index (bits 4 to 11)
+    std::array<Phase, SPU_VOICES> phase;
+    std::array<SPUEnvelope, SPU_VOICES> adsr_envelope;
+    std::array<int32_t, SPU_VOICES> adsr_target; // level that ends the phase
+    // Writing the repeat address overrides the loop start flags until the next key on
+    std::array<bool, SPU_VOICES> ignore_loop_start;
+    // The last three samples of the previous block followed by the current block, the ADPCM filter reads the first ones
+    std::array<std::array<int16_t, 3 + SPU_ADPCM_BLOCK_SAMPLES>, SPU_VOICES> samples;
+
+    // Noise generator
+    int32_t noise_timer;
+    uint16_t noise_level;
+
+    MixState mix;
+
+    // Decoded blocks, they depend on the filter history they were decoded with
+    struct CachedBlock {
+        uint32_t address; // SPU_RAM_SIZE = empty
+        int16_t old;
+        int16_t older;
+        std::array<int16_t, SPU_ADPCM_BLOCK_SAMPLES> samples;
+    };
+    std::vector<CachedBlock> cache;
+
+public:
+    explicit SPUVoices(const uint8_t *ram);
+    void reset();
+
+    // Offsets 0x0 to 0xE of a voice's registers
+    void write_voice_register(uint32_t voice, uint32_t offset, uint16_t value);
+    uint16_t read_voice_register(uint32_t voice, uint32_t offset) const;
+    // 0x1F80'1E00 + N * 4: Current Volume (Left/Right)
+    int16_t get_current_volume(uint32_t voice, bool right) const;
+
+    void key_on(uint32_t voices);
+    void key_off(uint32_t voices);
+    void set_pitch_modulation(uint32_t voices);
+    uint32_t get_pitch_modulation() const;
+    void set_noise_enable(uint32_t voices);
+    uint32_t get_noise_enable() const;
+    void set_reverb_enable(uint32_t voices);
+    uint32_t get_reverb_enable() const;
+    uint32_t get_end_flags() const;
+
+    // Writes the sums of the voices (before the main volume) of the next frames to left and right
+    void render(uint32_t frames, uint16_t control_register, int32_t *left, int32_t *right);
+    // Drops the decoded blocks that contain the address, called for every write to SPU RAM
+    void invalidate(uint32_t address);
+
+private:
+    void set_phase(uint32_t voice, Phase new_phase);
+    void tick_envelope(uint32_t voice);
+    // Advances the pitch counter, moves on to the next block(s) if needed
+    void advance(uint32_t voice);
+    void next_block(uint32_t voice);
+    // Decodes the current block after the kept samples, handles its loop start flag
+    void load_block(uint32_t voice);
+    const int16_t* decode_block(uint32_t address, int16_t old, int16_t older);
+    void update_taps(uint32_t voice);
+    void update_noise(uint16_t control_register);
+};
+
+}
+
+#endif
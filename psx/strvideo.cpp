@@ -0,0 +1,263 @@
+#include "strvideo.h"
+
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <string_view>
+
+#include "cd.h"
+#include "mdec.h"
+#include "xaadpcm.h"
+#include "util/bit.h"
+#include "util/log.h"
+
+using namespace util;
+
+namespace PSX {
+
+namespace {
+
+uint16_t read_u16(const uint8_t *data) {
+    return data[0] | (data[1] << 8);
+}
+
+uint32_t read_u32(const uint8_t *data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+// AC coefficients are coded like in MPEG-1 (table B.14 of ISO/IEC 11172-2), each code is followed by a sign bit
+struct ACCode {
+    std::string_view bits;
+    uint8_t run;
+    uint8_t level;
+};
+
+const ACCode AC_CODES[] = {
+    {"11", 0, 1}, {"011", 1, 1}, {"0100", 0, 2}, {"0101", 2, 1}, {"00101", 0, 3}, {"00111", 3, 1}, {"00110", 4, 1},
+    {"000110", 1, 2}, {"000111", 5, 1}, {"000101", 6, 1}, {"000100", 7, 1}, {"0000110", 0, 4}, {"0000100", 2, 2},
+    {"0000111", 8, 1}, {"0000101", 9, 1}, {"00100110", 0, 5}, {"00100001", 0, 6}, {"00100101", 1, 3}, {"00100100", 3, 2},
+    {"00100111", 10, 1}, {"00100011", 11, 1}, {"00100010", 12, 1}, {"00100000", 13, 1}, {"0000001010", 0, 7},
+    {"0000001100", 1, 4}, {"0000001011", 2, 3}, {"0000001111", 4, 2}, {"0000001001", 5, 2}, {"0000001110", 14, 1},
+    {"0000001101", 15, 1}, {"0000001000", 16, 1}, {"000000011101", 0, 8}, {"000000011000", 0, 9}, {"000000010011", 0, 10},
+    {"000000010000", 0, 11}, {"000000011011", 1, 5}, {"000000010100", 2, 4}, {"000000011100", 3, 3}, {"000000010010", 4, 3},
+    {"000000011110", 6, 2}, {"000000010101", 7, 2}, {"000000010001", 8, 2}, {"000000011111", 17, 1}, {"000000011010", 18, 1},
+    {"000000011001", 19, 1}, {"000000010111", 20, 1}, {"000000010110", 21, 1}, {"0000000011010", 0, 12},
+    {"0000000011001", 0, 13}, {"0000000011000", 0, 14}, {"0000000010111", 0, 15}, {"0000000010110", 1, 6},
+    {"0000000010101", 1, 7}, {"0000000010100", 2, 5}, {"0000000010011", 3, 4}, {"0000000010010", 5, 3},
+    {"0000000010001", 9, 2}, {"0000000010000", 10, 2}, {"0000000011111", 22, 1}, {"0000000011110", 23, 1},
+    {"0000000011101", 24, 1}, {"0000000011100", 25, 1}, {"0000000011011", 26, 1}, {"00000000011111", 0, 16},
+    {"00000000011110", 0, 17}, {"00000000011101", 0, 18}, {"00000000011100", 0, 19}, {"00000000011011", 0, 20},
+    {"00000000011010", 0, 21}, {"00000000011001", 0, 22}, {"00000000011000", 0, 23}, {"00000000010111", 0, 24},
+    {"00000000010110", 0, 25}, {"00000000010101", 0, 26}, {"00000000010100", 0, 27}, {"00000000010011", 0, 28},
+    {"00000000010010", 0, 29}, {"00000000010001", 0, 30}, {"00000000010000", 0, 31}, {"000000000011000", 0, 32},
+    {"000000000010111", 0, 33}, {"000000000010110", 0, 34}, {"000000000010101", 0, 35}, {"000000000010100", 0, 36},
+    {"000000000010011", 0, 37}, {"000000000010010", 0, 38}, {"000000000010001", 0, 39}, {"000000000010000", 0, 40},
+    {"000000000011111", 1, 8}, {"000000000011110", 1, 9}, {"000000000011101", 1, 10}, {"000000000011100", 1, 11},
+    {"000000000011011", 1, 12}, {"000000000011010", 1, 13}, {"000000000011001", 1, 14}, {"0000000000010011", 1, 15},
+    {"0000000000010010", 1, 16}, {"0000000000010001", 1, 17}, {"0000000000010000", 1, 18}, {"0000000000010100", 6, 3},
+    {"0000000000011010", 11, 2}, {"0000000000011001", 12, 2}, {"0000000000011000", 13, 2}, {"0000000000010111", 14, 2},
+    {"0000000000010110", 15, 2}, {"0000000000010101", 16, 2}, {"0000000000011111", 27, 1}, {"0000000000011110", 28, 1},
+    {"0000000000011101", 29, 1}, {"0000000000011100", 30, 1}, {"0000000000011011", 31, 1}
+};
+const std::string_view END_OF_BLOCK_CODE = "10";
+const std::string_view ESCAPE_CODE = "000001"; // followed by the MDEC halfword (6 bits run, 10 bits level)
+
+// Longest code including the sign bit
+const uint32_t LONGEST_CODE = 17;
+
+// Lookup of the next LONGEST_CODE bits of the bitstream
+struct CodeTable {
+    enum class Kind : uint8_t {
+        INVALID,
+        COEFFICIENT,
+        END_OF_BLOCK,
+        ESCAPE
+    };
+    struct Entry {
+        uint16_t halfword; // for coefficients, as MDEC input
+        uint8_t length; // including the sign bit
+        Kind kind;
+    };
+
+    std::vector<Entry> entries;
+
+    CodeTable() : entries(1 << LONGEST_CODE, Entry{0, 0, Kind::INVALID}) {
+        for (const ACCode &code : AC_CODES) {
+            for (uint32_t sign = 0; sign < 2; ++sign) {
+                uint16_t level = sign ? (-code.level & 0x3FF) : code.level;
+                add(code.bits, sign, code.bits.size() + 1, Entry{static_cast<uint16_t>((code.run << 10) | level), 0, Kind::COEFFICIENT});
+            }
+        }
+        add(END_OF_BLOCK_CODE, 0, END_OF_BLOCK_CODE.size(), Entry{MDEC_END_OF_BLOCK, 0, Kind::END_OF_BLOCK});
+        add(ESCAPE_CODE, 0, ESCAPE_CODE.size(), Entry{0, 0, Kind::ESCAPE});
+    }
+
+    // Fills all entries starting with the code (and the sign bit if length includes it)
+    void add(std::string_view bits, uint32_t sign, uint32_t length, Entry entry) {
+        uint32_t prefix = 0;
+        for (char bit : bits) {
+            prefix = (prefix << 1) | (bit == '1');
+        }
+        if (length > bits.size()) {
+            prefix = (prefix << 1) | sign;
+        }
+
+        entry.length = length;
+        uint32_t first = prefix << (LONGEST_CODE - length);
+        std::fill_n(entries.begin() + first, 1 << (LONGEST_CODE - length), entry);
+    }
+};
+
+const CodeTable& code_table() {
+    static const CodeTable table;
+    return table;
+}
+
+// The bitstream is read in little endian halfwords, most significant bit first
+class BitReader {
+private:
+    const std::vector<uint8_t> &data;
+    size_t position; // of the next halfword to be buffered
+    uint64_t buffer; // buffered bits, left-aligned
+    uint32_t buffered;
+
+public:
+    BitReader(const std::vector<uint8_t> &data, size_t position)
+        : data(data), position(position), buffer(0), buffered(0) {}
+
+    uint32_t peek(uint32_t bits) {
+        while (buffered <= 48) {
+            uint64_t halfword = position + 1 < data.size() ? read_u16(&data[position]) : 0;
+            buffer |= halfword << (48 - buffered);
+            buffered += 16;
+            position += 2;
+        }
+        return buffer >> (64 - bits);
+    }
+
+    void skip(uint32_t bits) {
+        buffer <<= bits;
+        buffered -= bits;
+    }
+
+    uint32_t read(uint32_t bits) {
+        uint32_t value = peek(bits);
+        skip(bits);
+        return value;
+    }
+
+    // Read beyond the end of the data (which reads zeroes)
+    bool overrun() const {
+        return position * 8 - buffered > data.size() * 8;
+    }
+};
+
+}
+
+STRDemuxer::STRDemuxer()
+    : chunks(0), received_chunks(0), in_frame(false) {
+    frame.number = 0;
+    frame.width = 0;
+    frame.height = 0;
+}
+
+bool STRDemuxer::is_video_sector(const uint8_t *sector) {
+    const uint8_t *header = sector + STR_HEADER_OFFSET;
+    return sector[CD_MODE2_HEADER_OFFSET + 3] == 2 // mode 2
+        && Bit::getBit(sector[XA_SUBHEADER_SUBMODE], STR_SUBMODE_VIDEO)
+        && read_u16(&header[STR_HEADER_STATUS]) == STR_STATUS
+        && read_u16(&header[STR_HEADER_TYPE]) == STR_TYPE_VIDEO;
+}
+
+bool STRDemuxer::push_sector(const uint8_t *sector) {
+    if (!is_video_sector(sector)) {
+        return false;
+    }
+
+    const uint8_t *header = sector + STR_HEADER_OFFSET;
+    uint32_t number = read_u32(&header[STR_HEADER_FRAME]);
+    uint16_t chunk = read_u16(&header[STR_HEADER_CHUNK]);
+    uint16_t chunk_count = read_u16(&header[STR_HEADER_CHUNKS]);
+    if (chunk_count == 0 || chunk_count > 32 || chunk >= chunk_count) {
+        LOGW_MDEC(std::format("STR: Invalid chunk {:d}/{:d} of frame {:d}", chunk, chunk_count, number));
+        return false;
+    }
+
+    if (!in_frame || number != frame.number) {
+        if (in_frame && received_chunks != 0) {
+            LOGW_MDEC(std::format("STR: Dropping incomplete frame {:d}", frame.number));
+        }
+        frame.number = number;
+        frame.width = read_u16(&header[STR_HEADER_WIDTH]);
+        frame.height = read_u16(&header[STR_HEADER_HEIGHT]);
+        frame.bitstream.assign(chunk_count * STR_CHUNK_SIZE, 0);
+        chunks = chunk_count;
+        received_chunks = 0;
+        in_frame = true;
+    }
+
+    std::memcpy(&frame.bitstream[chunk * STR_CHUNK_SIZE], header + STR_HEADER_SIZE, STR_CHUNK_SIZE);
+    received_chunks |= 1u << chunk;
+    if (received_chunks != (chunks == 32 ? 0xFFFF'FFFF : (1u << chunks) - 1)) {
+        return false;
+    }
+
+    // Complete, a sector of the frame showing up again starts it over
+    frame.bitstream.resize(std::min<size_t>(frame.bitstream.size(), read_u32(&header[STR_HEADER_DEMUXED_SIZE])));
+    in_frame = false;
+    return true;
+}
+
+const STRDemuxer::Frame& STRDemuxer::get_frame() const {
+    return frame;
+}
+
+bool STRBitstream::decode(const std::vector<uint8_t> &bitstream, uint32_t macroblocks, std::vector<uint16_t> &out) {
+    if (bitstream.size() < STR_BITSTREAM_HEADER_SIZE || read_u16(&bitstream[2]) != STR_BITSTREAM_MAGIC) {
+        LOGW_MDEC("STR: Not a bitstream frame");
+        return false;
+    }
+    uint16_t quantization_scale = read_u16(&bitstream[4]);
+    uint16_t version = read_u16(&bitstream[6]);
+    if (version != 1 && version != 2) {
+        // Version 3 codes the DC coefficients differentially
+        LOGW_MDEC(std::format("STR: Bitstream version {:d} is not supported", version));
+        return false;
+    }
+
+    const CodeTable &table = code_table();
+    BitReader reader(bitstream, STR_BITSTREAM_HEADER_SIZE);
+    for (uint32_t block = 0; block < 6 * macroblocks; ++block) {
+        // DC coefficient, 10 bits as is
+        out.push_back((quantization_scale << 10) | reader.read(10));
+
+        // AC coefficients up to the end of the block, a block has 63 of them
+        for (uint32_t coefficients = 0; ; ++coefficients) {
+            const CodeTable::Entry &entry = table.entries[reader.peek(LONGEST_CODE)];
+            reader.skip(entry.length);
+
+            if (entry.kind == CodeTable::Kind::END_OF_BLOCK) {
+                out.push_back(MDEC_END_OF_BLOCK);
+                break;
+            }
+            if (entry.kind == CodeTable::Kind::INVALID || coefficients == 63) {
+                LOGW_MDEC(std::format("STR: Invalid bitstream in block {:d}", block));
+                return false;
+            }
+            out.push_back(entry.kind == CodeTable::Kind::ESCAPE ? reader.read(16) : entry.halfword);
+        }
+
+        if (reader.overrun()) {
+            LOGW_MDEC(std::format("STR: Bitstream ends in block {:d}", block));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+uint32_t STRBitstream::get_macroblocks(uint16_t width, uint16_t height) {
+    return ((width + 15) / 16) * ((height + 15) / 16);
+}
+
+}
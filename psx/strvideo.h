@@ -0,0 +1,71 @@
+#ifndef PSX_STRVIDEO_H
+#define PSX_STRVIDEO_H
+
+#include <cstdint>
+#include <vector>
+
+namespace PSX {
+
+// Sub-mode byte of the sub-header of mode 2 sectors
+#define STR_SUBMODE_VIDEO 1 // video sector
+
+// Header at the start of the user data of STR video sectors (little endian)
+#define STR_HEADER_OFFSET 0x18
+#define STR_HEADER_STATUS 0x00 // 0x0160
+#define STR_HEADER_TYPE 0x02 // 0x8001 for MDEC video
+#define STR_HEADER_CHUNK 0x04 // number of this sector within the frame
+#define STR_HEADER_CHUNKS 0x06 // sectors of the frame
+#define STR_HEADER_FRAME 0x08 // frame number, starts at 1
+#define STR_HEADER_DEMUXED_SIZE 0x0C // bytes of the frame's bitstream
+#define STR_HEADER_WIDTH 0x10
+#define STR_HEADER_HEIGHT 0x12
+#define STR_HEADER_SIZE 0x20
+#define STR_STATUS 0x0160
+#define STR_TYPE_VIDEO 0x8001
+// Bitstream bytes per sector
+#define STR_CHUNK_SIZE (2048 - STR_HEADER_SIZE)
+
+// Header of a frame's bitstream: MDEC halfwords / 32 (rounded up), 0x3800, quantization scale, version
+#define STR_BITSTREAM_HEADER_SIZE 8
+#define STR_BITSTREAM_MAGIC 0x3800
+
+// Reassembles the frames of STR video from the sectors they are interleaved with (e.g., XA-ADPCM audio)
+class STRDemuxer {
+public:
+    struct Frame {
+        uint32_t number;
+        uint16_t width;
+        uint16_t height;
+        std::vector<uint8_t> bitstream;
+    };
+
+private:
+    Frame frame;
+    uint32_t chunks;
+    // One bit per chunk received so far (frames have at most 32 chunks in practice)
+    uint32_t received_chunks;
+    bool in_frame;
+
+public:
+    STRDemuxer();
+
+    static bool is_video_sector(const uint8_t *sector);
+    // Takes a raw sector, returns true if it completed a frame (see get_frame())
+    bool push_sector(const uint8_t *sector);
+    const Frame& get_frame() const;
+};
+
+// Converts the compressed bitstream of a frame into the RLE-coded blocks the MDEC decodes.
+// Supports versions 1 and 2, which only differ in what the encoder produces.
+class STRBitstream {
+public:
+    // Appends the MDEC input of the given number of macroblocks (Cr, Cb, Y1...Y4 each),
+    // returns false if the version is not supported or the bitstream ends prematurely
+    static bool decode(const std::vector<uint8_t> &bitstream, uint32_t macroblocks, std::vector<uint16_t> &out);
+    // Macroblocks of a frame, in column-major order
+    static uint32_t get_macroblocks(uint16_t width, uint16_t height);
+};
+
+}
+
+#endif
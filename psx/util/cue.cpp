@@ -1,5 +1,6 @@
 #include "cue.h"
 
+#include <algorithm>
 #include <cassert>
 #include <format>
 #include <iomanip>
@@ -175,6 +176,8 @@ void Parser::read_line() {
             break;
         }
     }
+    // Reading the previous line might have hit its end
+    line_stream.clear();
     line_stream.str(line);
     command.clear();
     line_stream >> command;
@@ -0,0 +1,128 @@
+#include "edcecc.h"
+
+#include <array>
+#include <cstring>
+
+namespace util {
+
+namespace EDCECC {
+
+namespace {
+
+struct Tables {
+    std::array<uint8_t, 256> ecc_f;
+    std::array<uint8_t, 256> ecc_b;
+    std::array<uint32_t, 256> edc;
+
+    Tables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            // Multiplication by 2 in GF(2^8) with polynomial x^8 + x^4 + x^3 + x^2 + 1
+            uint32_t j = (i << 1) ^ ((i & 0x80) ? 0x11D : 0);
+            ecc_f[i] = j;
+            ecc_b[i ^ j] = i;
+
+            // CRC with polynomial (x^16 + x^15 + x^2 + 1) * (x^16 + x^2 + x + 1), reflected
+            uint32_t crc = i;
+            for (uint32_t k = 0; k < 8; ++k) {
+                crc = (crc >> 1) ^ ((crc & 1) ? 0xD8018001 : 0);
+            }
+            edc[i] = crc;
+        }
+    }
+};
+
+const Tables& tables() {
+    static const Tables computed;
+    return computed;
+}
+
+void write_edc(const uint8_t *data, size_t length, uint8_t *destination) {
+    uint32_t edc = compute_edc(data, length);
+    destination[0] = edc;
+    destination[1] = edc >> 8;
+    destination[2] = edc >> 16;
+    destination[3] = edc >> 24;
+}
+
+// Computes one set of parity bytes (P or Q) over the 2064 bytes starting at the header
+void compute_ecc_block(const uint8_t *source, uint32_t major_count, uint32_t minor_count,
+                       uint32_t major_mult, uint32_t minor_inc, uint8_t *destination) {
+    const Tables &t = tables();
+    uint32_t size = major_count * minor_count;
+
+    for (uint32_t major = 0; major < major_count; ++major) {
+        uint32_t index = (major >> 1) * major_mult + (major & 1);
+        uint8_t ecc_a = 0;
+        uint8_t ecc_b = 0;
+
+        for (uint32_t minor = 0; minor < minor_count; ++minor) {
+            uint8_t temp = source[index];
+            index += minor_inc;
+            if (index >= size) {
+                index -= size;
+            }
+            ecc_a ^= temp;
+            ecc_b ^= temp;
+            ecc_a = t.ecc_f[ecc_a];
+        }
+
+        ecc_a = t.ecc_b[t.ecc_f[ecc_a] ^ ecc_b];
+        destination[major] = ecc_a;
+        destination[major + major_count] = ecc_a ^ ecc_b;
+    }
+}
+
+void write_ecc(uint8_t *sector, bool zero_header) {
+    // Mode 2 sectors compute the ECC as if the header were zero
+    uint8_t header[4];
+    if (zero_header) {
+        std::memcpy(header, &sector[0x00C], 4);
+        std::memset(&sector[0x00C], 0, 4);
+    }
+
+    compute_ecc_block(&sector[0x00C], 86, 24, 2, 86, &sector[0x81C]); // P
+    compute_ecc_block(&sector[0x00C], 52, 43, 86, 88, &sector[0x8C8]); // Q
+
+    if (zero_header) {
+        std::memcpy(&sector[0x00C], header, 4);
+    }
+}
+
+}
+
+void write_sync(uint8_t *sector) {
+    sector[0] = 0x00;
+    std::memset(&sector[1], 0xFF, 10);
+    sector[11] = 0x00;
+}
+
+uint32_t compute_edc(const uint8_t *data, size_t length) {
+    const Tables &t = tables();
+    uint32_t edc = 0;
+    for (size_t i = 0; i < length; ++i) {
+        edc = (edc >> 8) ^ t.edc[(edc ^ data[i]) & 0xFF];
+    }
+    return edc;
+}
+
+void write_mode1(uint8_t *sector) {
+    // EDC over sync, header and data, followed by 8 zero bytes and ECC
+    write_edc(sector, 0x810, &sector[0x810]);
+    std::memset(&sector[0x814], 0, 8);
+    write_ecc(sector, false);
+}
+
+void write_mode2_form1(uint8_t *sector) {
+    // EDC over sub-header and data
+    write_edc(&sector[0x010], 0x808, &sector[0x818]);
+    write_ecc(sector, true);
+}
+
+void write_mode2_form2(uint8_t *sector) {
+    // No ECC in form 2
+    write_edc(&sector[0x010], 0x91C, &sector[0x92C]);
+}
+
+}
+
+}
@@ -0,0 +1,23 @@
+#ifndef UTIL_EDCECC_H
+#define UTIL_EDCECC_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace util {
+
+// Regeneration of the redundant parts of raw 2352-byte CD-ROM sectors:
+// sync pattern, error detection code (EDC) and Reed-Solomon error correction code (ECC)
+namespace EDCECC {
+    void write_sync(uint8_t *sector);
+    uint32_t compute_edc(const uint8_t *data, size_t length);
+
+    // Expect sync, header (and sub-header) as well as user data to be in place
+    void write_mode1(uint8_t *sector);
+    void write_mode2_form1(uint8_t *sector);
+    void write_mode2_form2(uint8_t *sector);
+}
+
+}
+
+#endif
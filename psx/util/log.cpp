@@ -87,6 +87,7 @@ LogPack logPack;
 
 LogPack::LogPack()
     : INIT_TWL(bus, "BUS"),
+      INIT_TWL(cdimg, "CDIMG"),
       INIT_TWL(cdrom, "CDROM"),
       INIT_TWL(cp0, "CP0"),
       INIT_TWL(cpu, "CPU"),
@@ -180,6 +181,7 @@ LogPack::LogPack()
 
 void LogPack::enableAllFileLogging() {
     ENABLE_TWL_FILELOG(bus);
+    ENABLE_TWL_FILELOG(cdimg);
     ENABLE_TWL_FILELOG(cdrom);
     ENABLE_TWL_FILELOG(cp0);
     ENABLE_TWL_FILELOG(cpu);
@@ -0,0 +1,81 @@
+#ifndef UTIL_SPSCRING_H
+#define UTIL_SPSCRING_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace util {
+
+// Lock-free single-producer single-consumer ring buffer of N slots (N a power of two).
+// Slots are written and read in place, so elements are never copied by the ring itself.
+template<typename T, uint32_t N>
+class SPSCRing {
+private:
+    static_assert(N > 0 && (N & (N - 1)) == 0, "Size of SPSCRing has to be a power of two");
+
+    T slots[N];
+    // Both only ever increase (modulo 2^32), slot of a counter c is c % N
+    std::atomic<uint32_t> head; // next slot to be written, owned by the producer
+    std::atomic<uint32_t> tail; // next slot to be read, owned by the consumer
+
+public:
+    SPSCRing() : head(0), tail(0) {}
+    SPSCRing(const SPSCRing &) = delete;
+
+    // Producer side, returns nullptr if the ring is full
+    T* write_slot() {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == N) {
+            return nullptr;
+        }
+        return &slots[h % N];
+    }
+
+    // Publish the slot returned by write_slot()
+    void push() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Block while the ring is full, returns early if the consumer pops or discards
+    void wait_for_space() const {
+        uint32_t t = tail.load(std::memory_order_acquire);
+        if (head.load(std::memory_order_relaxed) - t == N) {
+            tail.wait(t, std::memory_order_acquire);
+        }
+    }
+
+    // Consumer side, returns nullptr if the ring is empty
+    const T* read_slot() const {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (head.load(std::memory_order_acquire) == t) {
+            return nullptr;
+        }
+        return &slots[t % N];
+    }
+
+    // Release the slot returned by read_slot()
+    void pop() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        tail.notify_one();
+    }
+
+    // Drop everything published so far, wakes up a waiting producer
+    void discard() {
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+        tail.notify_one();
+    }
+
+    uint32_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    // Only while neither side is active
+    void clear() {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef UTIL_TRIPLEBUFFER_H
+#define UTIL_TRIPLEBUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace util {
+
+// Lock-free single-producer single-consumer triple buffer.
+// The producer always has a buffer to write to and never waits for the consumer,
+// the consumer always reads the newest completely written buffer.
+template<typename T>
+class TripleBuffer {
+private:
+    static const uint8_t INDEX_MASK = 0x3;
+    static const uint8_t NEW_DATA = 0x4;
+
+    T buffers[3];
+    // Index of the buffer that is handed over between producer and consumer,
+    // NEW_DATA is set if it has been published but not yet acquired
+    std::atomic<uint8_t> shared;
+    uint8_t back; // owned by the producer
+    uint8_t front; // owned by the consumer
+
+    // Incremented on every publish, used to wait for new data
+    std::atomic<uint32_t> sequence;
+
+public:
+    explicit TripleBuffer(const T &initial = T())
+        : buffers{initial, initial, initial},
+          shared(1),
+          back(0),
+          front(2),
+          sequence(0) {
+    }
+
+    TripleBuffer(const TripleBuffer &) = delete;
+
+    // Producer side
+    T& write_buffer() {
+        return buffers[back];
+    }
+
+    void publish() {
+        back = shared.exchange(back | NEW_DATA, std::memory_order_acq_rel) & INDEX_MASK;
+        wake_up();
+    }
+
+    // Consumer side, returns true if a newer buffer has been acquired
+    bool acquire() {
+        if (!(shared.load(std::memory_order_relaxed) & NEW_DATA)) {
+            return false;
+        }
+
+        front = shared.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    const T& read_buffer() const {
+        return buffers[front];
+    }
+
+    uint32_t get_sequence() const {
+        return sequence.load(std::memory_order_acquire);
+    }
+
+    // Block until something was published (or wake_up was called) after seen_sequence was obtained
+    void wait(uint32_t seen_sequence) const {
+        sequence.wait(seen_sequence, std::memory_order_acquire);
+    }
+
+    void wake_up() {
+        sequence.fetch_add(1, std::memory_order_acq_rel);
+        sequence.notify_all();
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef UTIL_WORKERPOOL_H
+#define UTIL_WORKERPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+// Fixed set of threads that run the iterations of a loop in parallel.
+// The calling thread takes part in the loop as well and returns once every iteration is done.
+// A loop does not allocate, the job is only referenced while it runs.
+class WorkerPool {
+private:
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable start_condition;
+    std::condition_variable done_condition;
+    bool stopping;
+    uint32_t generation; // incremented for every loop
+    uint32_t busy_threads;
+
+    // The current loop, set under the mutex before the threads are woken up
+    void (*invoke)(const void *job, uint32_t iteration, uint32_t worker);
+    const void *job;
+    uint32_t iterations;
+    std::atomic<uint32_t> next_iteration;
+
+public:
+    explicit WorkerPool(uint32_t thread_count)
+        : stopping(false), generation(0), busy_threads(0),
+          invoke(nullptr), job(nullptr), iterations(0), next_iteration(0) {
+        for (uint32_t i = 0; i < thread_count; ++i) {
+            // Worker 0 is the calling thread
+            threads.emplace_back(&WorkerPool::run_worker, this, i + 1);
+        }
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        start_condition.notify_all();
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+
+    // Number of workers a job may be called from, including the calling thread
+    uint32_t get_worker_count() const {
+        return threads.size() + 1;
+    }
+
+    // Calls job(iteration, worker) for every iteration below count, in no particular order.
+    // Calls of the same worker never overlap, so the worker can index per-thread scratch memory.
+    template<typename Job>
+    void run(uint32_t count, const Job &f) {
+        if (threads.empty() || count < 2) {
+            for (uint32_t i = 0; i < count; ++i) {
+                f(i, 0);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            invoke = [](const void *job, uint32_t iteration, uint32_t worker) {
+                (*static_cast<const Job*>(job))(iteration, worker);
+            };
+            job = &f;
+            iterations = count;
+            next_iteration.store(0, std::memory_order_relaxed);
+            busy_threads = threads.size();
+            ++generation;
+        }
+        start_condition.notify_all();
+
+        work(0);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done_condition.wait(lock, [this] { return busy_threads == 0; });
+    }
+
+private:
+    void work(uint32_t worker) {
+        for (uint32_t i = next_iteration.fetch_add(1, std::memory_order_relaxed); i < iterations;
+             i = next_iteration.fetch_add(1, std::memory_order_relaxed)) {
+            invoke(job, i, worker);
+        }
+    }
+
+    void run_worker(uint32_t worker) {
+        uint32_t seen_generation = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                start_condition.wait(lock, [&] { return stopping || generation != seen_generation; });
+                if (stopping) {
+                    return;
+                }
+                seen_generation = generation;
+            }
+
+            work(worker);
+
+            bool last;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                last = --busy_threads == 0;
+            }
+            if (last) {
+                done_condition.notify_one();
+            }
+        }
+    }
+};
+
+}
+
+#endif
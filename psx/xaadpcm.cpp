@@ -0,0 +1,255 @@
+#include "xaadpcm.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <numbers>
+
+#include "util/bit.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define XA_ADPCM_X86
+#include <immintrin.h>
+#endif
+
+using namespace util;
+
+namespace PSX {
+
+namespace {
+
+// ADPCM prediction filters (in 1/64)
+const int32_t FILTER_OLD[4] = {0, 60, 115, 98};
+const int32_t FILTER_OLDER[4] = {0, 0, -52, -55};
+
+// Shift of a sound unit, values above 12 behave like 9
+inline uint32_t get_shift(uint8_t header) {
+    uint32_t shift = header & 0xF;
+    return shift > 12 ? 9 : shift;
+}
+
+// Polyphase low-pass filter (windowed sinc, Q15) for resampling to 44.1 kHz.
+// Phase p interpolates between taps 7 and 8 at p/7 of the way.
+struct ResamplerTable {
+    alignas(16) int16_t coefficients[XA_RESAMPLER_PHASES][XA_RESAMPLER_TAPS];
+
+    ResamplerTable() {
+        // Cut off a bit below the Nyquist frequency of the input
+        const double cutoff = 0.9;
+        const double half_width = XA_RESAMPLER_TAPS / 2;
+
+        for (uint32_t phase = 0; phase < XA_RESAMPLER_PHASES; ++phase) {
+            double taps[XA_RESAMPLER_TAPS];
+            double sum = 0.0;
+            for (uint32_t k = 0; k < XA_RESAMPLER_TAPS; ++k) {
+                double distance = k - (half_width - 1) - (double)phase / XA_RESAMPLER_PHASES;
+                double x = std::numbers::pi * cutoff * distance;
+                double sinc = distance == 0.0 ? 1.0 : std::sin(x) / x;
+                // Blackman window
+                double w = std::numbers::pi * distance / half_width;
+                double window = std::abs(distance) >= half_width ? 0.0 : 0.42 + 0.5 * std::cos(w) + 0.08 * std::cos(2 * w);
+                taps[k] = sinc * window;
+                sum += taps[k];
+            }
+
+            // Unity gain for every phase
+            for (uint32_t k = 0; k < XA_RESAMPLER_TAPS; ++k) {
+                coefficients[phase][k] = (int16_t)std::lround(taps[k] / sum * 0x8000);
+            }
+        }
+    }
+};
+
+const ResamplerTable& resampler_table() {
+    static const ResamplerTable table;
+    return table;
+}
+
+// Scales the 28 samples of all 8 sound units of a 4-bit group into scaled[sample][unit]
+typedef void (*Scale4BitKernel)(const uint8_t *group, int16_t scaled[][8]);
+// Applies the resampling filter to XA_RESAMPLER_TAPS samples
+typedef int16_t (*FilterKernel)(const int16_t *samples, const int16_t *coefficients);
+
+void scale_4_bit_scalar(const uint8_t *group, int16_t scaled[][8]) {
+    for (uint32_t unit = 0; unit < 8; ++unit) {
+        uint32_t shift = get_shift(group[4 + unit]);
+        for (uint32_t i = 0; i < XA_SAMPLES_PER_UNIT; ++i) {
+            uint8_t nibble = (group[16 + 4 * i + unit / 2] >> ((unit & 1) * 4)) & 0xF;
+            scaled[i][unit] = (int16_t)(nibble << 12) >> shift;
+        }
+    }
+}
+
+int16_t filter_scalar(const int16_t *samples, const int16_t *coefficients) {
+    int32_t sum = 0;
+    for (uint32_t k = 0; k < XA_RESAMPLER_TAPS; ++k) {
+        sum += samples[k] * coefficients[k];
+    }
+    return std::clamp<int32_t>((sum + 0x4000) >> 15, -0x8000, 0x7FFF);
+}
+
+#ifdef XA_ADPCM_X86
+// A word of sample data holds one sample of each of the 8 units, one 16-bit lane per unit.
+// Since shifts are at most 12, (nibble << 12) >> shift is the sign-extended nibble times 2^(12 - shift).
+__attribute__((target("sse2")))
+void scale_4_bit_sse2(const uint8_t *group, int16_t scaled[][8]) {
+    const __m128i nibble_mask = _mm_setr_epi16(0x000F, 0x00F0, 0x000F, 0x00F0, 0x000F, 0x00F0, 0x000F, 0x00F0);
+    const __m128i to_top = _mm_setr_epi16(0x1000, 0x0100, 0x1000, 0x0100, 0x1000, 0x0100, 0x1000, 0x0100);
+    alignas(16) int16_t factors[8];
+    for (uint32_t unit = 0; unit < 8; ++unit) {
+        factors[unit] = 1 << (12 - get_shift(group[4 + unit]));
+    }
+    const __m128i scale = _mm_load_si128((const __m128i*)factors);
+
+    for (uint32_t i = 0; i < XA_SAMPLES_PER_UNIT; ++i) {
+        uint32_t word;
+        std::memcpy(&word, &group[16 + 4 * i], sizeof(word));
+        // Each byte twice: low nibble for the even, high nibble for the odd unit
+        __m128i bytes = _mm_unpacklo_epi8(_mm_cvtsi32_si128(word), _mm_setzero_si128());
+        __m128i lanes = _mm_unpacklo_epi16(bytes, bytes);
+        __m128i top = _mm_mullo_epi16(_mm_and_si128(lanes, nibble_mask), to_top);
+        __m128i samples = _mm_mullo_epi16(_mm_srai_epi16(top, 12), scale);
+        _mm_storeu_si128((__m128i*)scaled[i], samples);
+    }
+}
+
+__attribute__((target("sse2")))
+int16_t filter_sse2(const int16_t *samples, const int16_t *coefficients) {
+    __m128i low = _mm_madd_epi16(_mm_loadu_si128((const __m128i*)samples), _mm_load_si128((const __m128i*)coefficients));
+    __m128i high = _mm_madd_epi16(_mm_loadu_si128((const __m128i*)(samples + 8)), _mm_load_si128((const __m128i*)(coefficients + 8)));
+    __m128i sum = _mm_add_epi32(low, high);
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    return std::clamp<int32_t>((_mm_cvtsi128_si32(sum) + 0x4000) >> 15, -0x8000, 0x7FFF);
+}
+#endif
+
+struct Kernels {
+    Scale4BitKernel scale_4_bit;
+    FilterKernel filter;
+
+    Kernels()
+        : scale_4_bit(scale_4_bit_scalar),
+          filter(filter_scalar) {
+#ifdef XA_ADPCM_X86
+        scale_4_bit = scale_4_bit_sse2;
+        filter = filter_sse2;
+#endif
+    }
+};
+
+const Kernels& kernels() {
+    static const Kernels selected;
+    return selected;
+}
+
+}
+
+XADecoder::XADecoder() {
+    reset();
+}
+
+void XADecoder::reset() {
+    for (Channel &channel : channels) {
+        channel.old = 0;
+        channel.older = 0;
+        channel.length = 0;
+    }
+    position = 0;
+    // Not a valid coding info
+    coding = 0xFF;
+}
+
+std::span<const int16_t> XADecoder::decode_sector(const uint8_t *sector) {
+    if (sector[XA_SUBHEADER_CODING] != coding) {
+        reset();
+        coding = sector[XA_SUBHEADER_CODING];
+    }
+
+    bool stereo = Bit::getBit(coding, XA_CODING_STEREO);
+    bool half_rate = Bit::getBit(coding, XA_CODING_HALF_RATE);
+    bool eight_bit = Bit::getBit(coding, XA_CODING_8_BIT);
+    uint32_t units = eight_bit ? 4 : 8;
+
+    // Decode each group into the channels, units alternate between left and right for stereo
+    alignas(16) int16_t scaled[XA_SAMPLES_PER_UNIT][8];
+    for (uint32_t g = 0; g < XA_GROUPS_PER_SECTOR; ++g) {
+        const uint8_t *group = sector + XA_DATA_OFFSET + g * XA_GROUP_SIZE;
+
+        if (eight_bit) {
+            for (uint32_t unit = 0; unit < units; ++unit) {
+                uint32_t shift = get_shift(group[4 + unit]);
+                for (uint32_t i = 0; i < XA_SAMPLES_PER_UNIT; ++i) {
+                    scaled[i][unit] = (int16_t)(group[16 + 4 * i + unit] << 8) >> shift;
+                }
+            }
+        } else {
+            kernels().scale_4_bit(group, scaled);
+        }
+
+        for (uint32_t unit = 0; unit < units; ++unit) {
+            decode_unit(channels[stereo ? (unit & 1) : 0], &scaled[0][unit], 8, group[4 + unit]);
+        }
+    }
+
+    // Resample to 44.1 kHz, both channels have the same number of samples
+    uint32_t step = half_rate ? 3 : 6;
+    uint32_t frames = 0;
+    if (stereo) {
+        frames = resample(channels[0], step, &output[0], 2);
+        resample(channels[1], step, &output[1], 2);
+    } else {
+        frames = resample(channels[0], step, &output[0], 2);
+        for (uint32_t i = 0; i < frames; ++i) {
+            output[2 * i + 1] = output[2 * i];
+        }
+    }
+    position += frames * step;
+    drop_consumed_samples(stereo ? 2 : 1);
+
+    return std::span<const int16_t>(output.data(), 2 * frames);
+}
+
+void XADecoder::decode_unit(Channel &channel, const int16_t *scaled, uint32_t stride, uint8_t header) {
+    uint32_t filter = (header >> 4) & 0x3;
+    int32_t k0 = FILTER_OLD[filter];
+    int32_t k1 = FILTER_OLDER[filter];
+
+    // The prediction depends on the previous samples, so this part is inherently sequential
+    assert(channel.length + XA_SAMPLES_PER_UNIT <= channel.samples.size());
+    int16_t *out = &channel.samples[channel.length];
+    for (uint32_t i = 0; i < XA_SAMPLES_PER_UNIT; ++i) {
+        int32_t sample = scaled[i * stride] + ((channel.old * k0 + channel.older * k1 + 32) >> 6);
+        sample = std::clamp<int32_t>(sample, -0x8000, 0x7FFF);
+        channel.older = channel.old;
+        channel.old = sample;
+        out[i] = sample;
+    }
+    channel.length += XA_SAMPLES_PER_UNIT;
+}
+
+uint32_t XADecoder::resample(Channel &channel, uint32_t step, int16_t *out, uint32_t stride) const {
+    const ResamplerTable &table = resampler_table();
+    FilterKernel filter = kernels().filter;
+
+    uint32_t count = 0;
+    for (uint32_t p = position; p / XA_RESAMPLER_PHASES + XA_RESAMPLER_TAPS <= channel.length; p += step) {
+        assert(count < XA_MAX_OUTPUT_FRAMES);
+        out[count * stride] = filter(&channel.samples[p / XA_RESAMPLER_PHASES], table.coefficients[p % XA_RESAMPLER_PHASES]);
+        ++count;
+    }
+    return count;
+}
+
+void XADecoder::drop_consumed_samples(uint32_t channel_count) {
+    uint32_t consumed = position / XA_RESAMPLER_PHASES;
+    for (uint32_t c = 0; c < channel_count; ++c) {
+        Channel &channel = channels[c];
+        std::copy(channel.samples.begin() + consumed, channel.samples.begin() + channel.length, channel.samples.begin());
+        channel.length -= consumed;
+    }
+    position -= consumed * XA_RESAMPLER_PHASES;
+}
+
+}
@@ -0,0 +1,75 @@
+#ifndef PSX_XAADPCM_H
+#define PSX_XAADPCM_H
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+namespace PSX {
+
+// Sub-header of a mode 2 sector in a raw sector
+#define XA_SUBHEADER_FILE 0x10
+#define XA_SUBHEADER_CHANNEL 0x11
+#define XA_SUBHEADER_SUBMODE 0x12
+#define XA_SUBHEADER_CODING 0x13
+
+// Coding info byte of the sub-header
+#define XA_CODING_STEREO 0 // 0 = mono, 1 = stereo
+#define XA_CODING_HALF_RATE 2 // 0 = 37.8 kHz, 1 = 18.9 kHz
+#define XA_CODING_8_BIT 4 // 0 = 4 bits per sample, 1 = 8 bits per sample
+
+// The audio data consists of 18 sound groups of 128 bytes: 16 header bytes, then 28 words of samples.
+// A group holds 8 (4-bit) or 4 (8-bit) sound units of 28 samples each.
+#define XA_DATA_OFFSET 0x18
+#define XA_GROUPS_PER_SECTOR 18
+#define XA_GROUP_SIZE 128
+#define XA_SAMPLES_PER_UNIT 28
+// 4-bit mono
+#define XA_MAX_SAMPLES_PER_SECTOR (XA_GROUPS_PER_SECTOR * 8 * XA_SAMPLES_PER_UNIT)
+
+// Resampling to 44.1 kHz: output samples are 6/7 (37.8 kHz) or 3/7 (18.9 kHz) input samples apart
+#define XA_RESAMPLER_PHASES 7
+#define XA_RESAMPLER_TAPS 16
+// 4-bit mono at 18.9 kHz
+#define XA_MAX_OUTPUT_FRAMES (XA_MAX_SAMPLES_PER_SECTOR * XA_RESAMPLER_PHASES / 3 + 1)
+
+// Decodes XA-ADPCM sectors into 16-bit stereo samples at 44.1 kHz.
+// All buffers are part of the decoder, decoding a sector does not allocate.
+class XADecoder {
+private:
+    struct Channel {
+        // ADPCM filter history
+        int32_t old;
+        int32_t older;
+
+        // Decoded samples not consumed by the resampler yet, the first ones are kept from the last sector
+        std::array<int16_t, XA_RESAMPLER_TAPS + XA_MAX_SAMPLES_PER_SECTOR> samples;
+        uint32_t length;
+    };
+    std::array<Channel, 2> channels;
+
+    // Position of the next output sample relative to the start of the samples, in 1/7 input samples
+    uint32_t position;
+    // Coding info of the last sector, the resampler starts over if it changes
+    uint8_t coding;
+
+    // Interleaved left and right samples
+    std::array<int16_t, 2 * XA_MAX_OUTPUT_FRAMES> output;
+
+public:
+    XADecoder();
+    void reset();
+
+    // Decodes the raw sector, returns interleaved stereo samples that stay valid until the next call
+    std::span<const int16_t> decode_sector(const uint8_t *sector);
+
+private:
+    void decode_unit(Channel &channel, const int16_t *scaled, uint32_t stride, uint8_t header);
+    // Returns the number of output samples written to every stride-th element of out
+    uint32_t resample(Channel &channel, uint32_t step, int16_t *out, uint32_t stride) const;
+    void drop_consumed_samples(uint32_t channel_count);
+};
+
+}
+
+#endif